@@ -21,3 +21,54 @@ def parse_output_from_experiments( file_path ):
             dz_vcs.append( float(fields[2]) )
 
     return z_vcs, dz_vcs
+
+
+RESULT_RECORD_FIELDS = [
+    ( 'index',        '<u4' ),
+    ( 'sample_point', '<f4' ),
+    ( 'min_gap',      '<f4' ),
+    ( 'iterations',   '<u4' ),
+    ( 'probes',       '<u4' ),
+    ( 'wall_time',    '<f8' ),
+    ( 'confidence',   '<f4' )
+]
+
+RESULT_BINARY_MAGIC       = b'ZFTR'
+RESULT_BINARY_HEADER_SIZE = 32
+
+def load_results( file_path ):
+    """Loads the records written by depth_test_batch -output <file_path>
+    as a structured array of numpy, sorted by the sample point index.
+    The format is determined by the extension: .bin, .csv or .npy."""
+
+    import numpy as np
+
+    dtype = np.dtype( RESULT_RECORD_FIELDS )
+
+    if file_path.endswith( '.npy' ):
+
+        records = np.load( file_path )
+
+    elif file_path.endswith( '.csv' ):
+
+        records = np.loadtxt( file_path, dtype = dtype, delimiter = ',', skiprows = 1, ndmin = 1 )
+
+    else:
+        with open( file_path, 'rb' ) as fh:
+
+            header = fh.read( RESULT_BINARY_HEADER_SIZE )
+
+            if header[0:4] != RESULT_BINARY_MAGIC:
+                raise ValueError( file_path + ' is not a result file' )
+
+            records = np.frombuffer( fh.read(), dtype = dtype )
+
+    return np.sort( records, order = 'index' )
+
+
+def parse_results( file_path ):
+    """Same as parse_output_from_experiments() for the files of load_results()."""
+
+    records = load_results( file_path )
+
+    return list( records['sample_point'].astype( float ) ), list( records['min_gap'].astype( float ) )
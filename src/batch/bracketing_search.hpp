@@ -0,0 +1,212 @@
+#ifndef __DEPTH_TEST_BRACKETING_SEARCH_HPP__
+#define __DEPTH_TEST_BRACKETING_SEARCH_HPP__
+
+#include <cmath>
+
+#include "search_strategy.hpp"
+
+namespace DepthTest {
+
+// Exponential bracketing from the seed, or the starting gap of GridSearch,
+// followed by the bisection in the log of the gap.
+//
+// The bracketing moves by the factors 2, 4, 16, 256, ..., down while the
+// gaps resolve, or up while they do not, until the outcome flips. The
+// bracket is then bisected at the geometric mean until its bounds give the
+// same float planes. The result is the distance between the float planes of
+// the upper bound.
+class BracketingSearch : public SearchStrategy {
+
+  public:
+
+    BracketingSearch( const float near, const float far, const float sample_point ) noexcept
+        :SearchStrategy{ near, far, sample_point }
+        ,m_lo          { 0.0f }
+        ,m_hi          { 0.0f }
+        ,m_phase       { BRACKET_DOWN }
+        ,m_step        { 0 }
+    {
+        if ( !isSamplePointInRange() ) {
+            return;
+        }
+
+        const auto limit = gapLimit();
+
+        // the first gap of GridSearch, in the limit.
+        m_hi = std::min( 0.1f * std::min( sample_point - near, far - sample_point ), 0.5f * limit );
+        m_lo = m_hi;
+
+        m_finished = !( MINIMUM_GAP < m_hi );
+    }
+
+    void seed( const float gap ) override
+    {
+        if ( m_finished || !( gap > MINIMUM_GAP ) ) {
+            return;
+        }
+
+        m_hi = std::min( gap, 0.5f * gapLimit() );
+        m_lo = m_hi;
+    }
+
+    float nextGap() const override
+    {
+        switch ( m_phase ) {
+
+          case BRACKET_DOWN:
+            return std::max( scaled( m_hi, -1 ), MINIMUM_GAP );
+
+          case BRACKET_UP:
+            return std::min( scaled( m_lo, 1 ), 0.5f * gapLimit() );
+
+          default:
+            return midGap();
+        }
+    }
+
+    void report( const bool resolved ) override
+    {
+        const auto gap = nextGap();
+
+        m_num_probes++;
+        m_num_rounds++;
+
+        switch ( m_phase ) {
+
+          case BRACKET_DOWN:
+
+            if ( resolved ) {
+
+                m_hi = gap;
+                m_step++;
+
+                if ( gap <= MINIMUM_GAP ) {
+
+                    m_finished = true; // resolved down to the bottom.
+                    return;
+                }
+            }
+            else if ( m_step == 0 ) {
+
+                // the first gap does not resolve. go up.
+                m_lo    = gap;
+                m_phase = BRACKET_UP;
+                m_step  = 1;
+            }
+            else {
+                m_lo    = gap;
+                m_phase = BISECT;
+            }
+            break;
+
+          case BRACKET_UP:
+
+            if ( resolved ) {
+
+                m_hi    = gap;
+                m_phase = BISECT;
+            }
+            else if ( gap >= 0.5f * gapLimit() ) {
+
+                m_hi       = m_far; // nothing resolves within the limit.
+                m_finished = true;
+                return;
+            }
+            else {
+                m_lo = gap;
+                m_step++;
+            }
+            break;
+
+          default:
+
+            if ( resolved ) {
+                m_hi = gap;
+            }
+            else {
+                m_lo = gap;
+            }
+            break;
+        }
+
+        updateFinished();
+    }
+
+    float result() const override
+    {
+        if ( !isSamplePointInRange() || m_hi >= m_far ) {
+            return m_far;
+        }
+        return representableGap( m_hi );
+    }
+
+    bool atRoundStart() const override
+    {
+        return true;
+    }
+
+    // m_a: lower bound, m_b: upper bound, m_phase: Phase, m_step: bracketing steps.
+    State state() const override
+    {
+        return { m_lo, m_hi, m_phase, m_step, m_num_probes, m_num_rounds };
+    }
+
+    void restore( const State& state ) override
+    {
+        m_lo         = static_cast<float>( state.m_a );
+        m_hi         = static_cast<float>( state.m_b );
+        m_phase      = static_cast<Phase>( state.m_phase );
+        m_step       = state.m_step;
+        m_num_probes = state.m_num_probes;
+        m_num_rounds = state.m_num_rounds;
+        updateFinished();
+    }
+
+  private:
+
+    typedef enum _Phase {
+        BRACKET_DOWN,
+        BRACKET_UP,
+        BISECT
+    } Phase;
+
+    // gap multiplied by 2^( 2^( m_step - 1 ) ) if direction is 1, or divided
+    // by it if -1. gap itself for m_step 0.
+    float scaled( const float gap, const int direction ) const
+    {
+        if ( m_step == 0 ) {
+            return gap;
+        }
+
+        const int exponent = 1 << std::min( m_step - 1, 8 );
+
+        return static_cast<float>( std::ldexp( static_cast<double>( gap ), direction * exponent ) );
+    }
+
+    float midGap() const
+    {
+        return static_cast<float>( std::sqrt( static_cast<double>( m_lo ) * static_cast<double>( m_hi ) ) );
+    }
+
+    void updateFinished()
+    {
+        if ( m_phase != BISECT ) {
+
+            m_finished = false;
+            return;
+        }
+
+        const auto mid = midGap();
+
+        m_finished = isSamePlanes( m_lo, m_hi ) || mid <= m_lo || m_hi <= mid;
+    }
+
+    float m_lo;   // not resolved.
+    float m_hi;   // resolved.
+    Phase m_phase;
+    int   m_step;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_BRACKETING_SEARCH_HPP__*/
@@ -0,0 +1,339 @@
+#ifndef __DEPTH_TEST_CHECKPOINT_HPP__
+#define __DEPTH_TEST_CHECKPOINT_HPP__
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+#include "search_strategy.hpp"
+#include "result_writer.hpp"
+
+namespace DepthTest {
+
+// Append-only checkpoint of a BatchTester run, so that an interrupted run
+// can be resumed without searching the completed sample points again.
+//
+// Text, one entry per line, each terminated by ';' so that a line cut
+// short by a crash is ignored:
+//     ZFTC <version> <depth type> <near> <far> <c> <num points> <num perturbed samples> <search mode> <early stop> <perturbation> <seed> <depth format> <clip convention> <stack planes> <model initial gap> ;
+//     done <index> <sample point> <min gap> <rounds> <probes> <wall time> <confidence> ;
+//     state <index> <a> <b> <phase> <step> <probes> <rounds> <wall time> <confidence> <random engine> ;
+//
+// 'state' is the SearchStrategy::State of an incomplete sample point at the
+// start of a round with the confidence so far and its random engine. The last
+// one of each sample point wins.
+// The entries are flushed at most every flush_interval seconds, and on close.
+class Checkpoint {
+
+  public:
+
+    static constexpr int    VERSION                = 6;
+    static constexpr double DEFAULT_FLUSH_INTERVAL = 10.0;
+
+    // the state of an incomplete sample point.
+    struct SearchState {
+        SearchStrategy::State m_search;
+        std::string           m_rand_gen;
+        double                m_wall_time;
+        double                m_confidence;
+    };
+
+    // resume: loads the entries of file_path if it exists, and appends to it.
+    //         Throws if it was made with different parameters.
+    //         Otherwise file_path is started over.
+    Checkpoint(
+        const std::string& file_path,
+        const bool         resume,
+        const uint32_t     depth_test_type,
+        const float        near,
+        const float        far,
+        const float        param_c,
+        const int          num_sample_points,
+        const int          num_perturbed_samples,
+        const int          search_mode,
+        const double       early_stop_confidence,
+        const int          perturbation,
+        const unsigned int seed,
+        const int          depth_format,
+        const int          clip_convention,
+        const int          stack_planes,
+        const bool         model_initial_gap,
+        const double       flush_interval = DEFAULT_FLUSH_INTERVAL
+    )
+        :m_file_path     { file_path }
+        ,m_flush_interval{ flush_interval }
+        ,m_last_flush    { std::chrono::steady_clock::now() }
+        ,m_needs_newline { false }
+    {
+        std::ostringstream header;
+
+        header << "ZFTC " << VERSION << " " << depth_test_type << " "
+               << std::setprecision(9) << near << " " << far << " " << param_c << " "
+               << num_sample_points << " " << num_perturbed_samples << " " << search_mode << " "
+               << early_stop_confidence << " " << perturbation << " " << seed << " "
+               << depth_format << " " << clip_convention << " "
+               << stack_planes << " " << ( model_initial_gap ? 1 : 0 );
+
+        const bool loaded = resume && load( header.str() );
+
+        m_os.open( file_path, loaded ? std::ios::app : std::ios::trunc );
+
+        if ( !m_os ) {
+
+            throw std::runtime_error( "cannot open " + file_path );
+        }
+
+        if ( !loaded ) {
+
+            m_os << header.str() << " ;\n";
+            m_os.flush();
+        }
+        else if ( m_needs_newline ) {
+
+            m_os << "\n"; // after the line cut short.
+        }
+    }
+
+    ~Checkpoint()
+    {
+        close();
+    }
+
+    // the records of the sample points completed in the loaded checkpoint.
+    const std::vector< ResultWriter::Record >& completedRecords() const
+    {
+        return m_completed_records;
+    }
+
+    // restores the state of the incomplete sample point at index from the
+    // loaded checkpoint. returns false if there is none.
+    bool findSearchState(
+        const int                   index,
+        SearchStrategy&             search,
+        std::default_random_engine& rand_gen,
+        double&                     wall_time,
+        double&                     confidence
+    ) const {
+        const auto it = m_search_states.find( index );
+
+        if ( it == m_search_states.end() ) {
+            return false;
+        }
+
+        std::istringstream is( it->second.m_rand_gen );
+        is >> rand_gen;
+
+        search.restore( it->second.m_search );
+        wall_time  = it->second.m_wall_time;
+        confidence = it->second.m_confidence;
+
+        return true;
+    }
+
+    void saveRecord( const ResultWriter::Record& record )
+    {
+        std::ostringstream line;
+
+        line << "done " << record.m_index << " "
+             << std::setprecision(9)  << record.m_sample_point << " " << record.m_min_gap << " "
+             << record.m_num_iterations << " " << record.m_num_probes << " "
+             << std::setprecision(17) << record.m_wall_time << " "
+             << std::setprecision(9)  << record.m_confidence << " ;\n";
+
+        append( line.str() );
+    }
+
+    // search must be at the start of a round, i.e. atRoundStart().
+    void saveSearchState(
+        const int                         index,
+        const SearchStrategy&             search,
+        const std::default_random_engine& rand_gen,
+        const double                      wall_time,
+        const double                      confidence
+    ) {
+        const auto state = search.state();
+
+        std::ostringstream line;
+
+        line << "state " << index << " "
+             << std::setprecision(17) << state.m_a << " " << state.m_b << " "
+             << state.m_phase << " " << state.m_step << " "
+             << state.m_num_probes << " " << state.m_num_rounds << " "
+             << wall_time << " " << confidence << " "
+             << rand_gen << " ;\n";
+
+        append( line.str() );
+    }
+
+    void flush()
+    {
+        std::lock_guard< std::mutex > lock( m_mutex );
+
+        m_os.flush();
+        m_last_flush = std::chrono::steady_clock::now();
+    }
+
+    void close()
+    {
+        std::lock_guard< std::mutex > lock( m_mutex );
+
+        if ( m_os.is_open() ) {
+            m_os.close();
+        }
+    }
+
+  private:
+
+    void append( const std::string& line )
+    {
+        std::lock_guard< std::mutex > lock( m_mutex );
+
+        m_os << line;
+
+        const auto now = std::chrono::steady_clock::now();
+        const std::chrono::duration< double > elapsed = now - m_last_flush;
+
+        if ( elapsed.count() >= m_flush_interval ) {
+
+            m_os.flush();
+            m_last_flush = now;
+        }
+    }
+
+    // returns false if there is nothing to resume from.
+    bool load( const std::string& header )
+    {
+        std::ifstream is( m_file_path, std::ios::binary );
+
+        if ( !is ) {
+            return false;
+        }
+
+        m_needs_newline = false;
+
+        std::string line;
+
+        if ( !readLine( is, line ) ) {
+            return false;
+        }
+
+        if ( line != header ) {
+
+            throw std::runtime_error(
+                "checkpoint " + m_file_path + " was made with different parameters: " + line );
+        }
+
+        std::map< int, ResultWriter::Record > records;
+
+        while ( readLine( is, line ) ) {
+
+            std::istringstream fields( line );
+            std::string        kind;
+
+            fields >> kind;
+
+            if ( kind == "done" ) {
+
+                ResultWriter::Record record;
+
+                if ( fields >> record.m_index >> record.m_sample_point >> record.m_min_gap
+                            >> record.m_num_iterations >> record.m_num_probes >> record.m_wall_time
+                     && readConfidence( fields, record.m_confidence ) ) {
+
+                    records[ record.m_index ] = record;
+                    m_search_states.erase( record.m_index );
+                }
+            }
+            else if ( kind == "state" ) {
+
+                int         index;
+                SearchState state;
+
+                if ( fields >> index >> state.m_search.m_a >> state.m_search.m_b
+                            >> state.m_search.m_phase >> state.m_search.m_step
+                            >> state.m_search.m_num_probes >> state.m_search.m_num_rounds
+                            >> state.m_wall_time
+                     && readConfidence( fields, state.m_confidence )
+                     && fields >> std::ws
+                     && records.find( index ) == records.end() ) {
+
+                    std::getline( fields, state.m_rand_gen );
+                    m_search_states[ index ] = state;
+                }
+            }
+        }
+
+        for ( const auto& index_and_record : records ) {
+
+            m_completed_records.push_back( index_and_record.second );
+        }
+
+        return true;
+    }
+
+    // reads the confidence, which may be "nan" that operator>>() does not take.
+    template< typename T >
+    static bool readConfidence( std::istream& is, T& confidence )
+    {
+        std::string field;
+
+        if ( !( is >> field ) ) {
+            return false;
+        }
+
+        char* end = nullptr;
+        const double value = strtod( field.c_str(), &end );
+
+        if ( end == field.c_str() || *end != '\0' ) {
+            return false;
+        }
+
+        confidence = static_cast< T >( value );
+        return true;
+    }
+
+    // reads a line terminated by " ;\n" into line without the terminator.
+    // skips the lines cut short.
+    bool readLine( std::istream& is, std::string& line )
+    {
+        while ( std::getline( is, line ) ) {
+
+            if ( is.eof() ) {
+
+                m_needs_newline = !line.empty();
+                return false;
+            }
+
+            if ( line.size() >= 2 && line.compare( line.size() - 2, 2, " ;" ) == 0 ) {
+
+                line.resize( line.size() - 2 );
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const std::string      m_file_path;
+    const double           m_flush_interval;
+    std::ofstream          m_os;
+    std::mutex             m_mutex;
+    std::chrono::steady_clock::time_point
+                           m_last_flush;
+    bool                   m_needs_newline;
+
+    std::vector< ResultWriter::Record > m_completed_records;
+    std::map< int, SearchState >        m_search_states;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_CHECKPOINT_HPP__*/
@@ -0,0 +1,240 @@
+#ifndef __DEPTH_TEST_DEPTH_CODE_SEARCH_HPP__
+#define __DEPTH_TEST_DEPTH_CODE_SEARCH_HPP__
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#include "depth_tester.hpp"
+
+namespace DepthTest {
+
+// Finds the minimum resolvable gap at the sample points from the depth
+// buffer codes, instead of rendering pairs of planes.
+//
+// Two planes at s - gap/2 and s + gap/2 are resolved in both drawing orders
+// with GL_LESS iff the nearer one gets a smaller code. With the code c of s,
+// let L' be the largest float below s with a code less than c, and H the
+// smallest float above s with a code greater than c. Then the minimum gap is
+// 2 * min( s - L', H - s ).
+//
+// L' and H are bracketed in the float bit patterns, which are in the same
+// order as the values for positive floats, and refined for all the sample
+// points at once. Each round probes PROBES_PER_BRACKET - 1 planes in each
+// bracket with one readDepthCodes(), so it takes about 5 rounds to pin
+// down the adjacent floats.
+class DepthCodeSearch {
+
+  public:
+
+    static constexpr int PROBES_PER_BRACKET = 64;
+
+    DepthCodeSearch(
+        DepthTester& tester,
+        const float  near,
+        const float  far,
+        const float  param_c
+    ) noexcept
+        :m_tester    { tester }
+        ,m_near      { near }
+        ,m_far       { far }
+        ,m_param_c   { param_c }
+        ,m_num_rounds{ 0 }
+    {
+    }
+
+    // gaps[i] is for sample_points[i]. It is far if the sample point is out
+    // of [near, far] or the planes are not resolved on either side.
+    void run( const std::vector< float >& sample_points, std::vector< float >& gaps )
+    {
+        const int num_points = static_cast<int>( sample_points.size() );
+
+        gaps.assign( num_points, m_far );
+
+        // the codes of the sample points and the limits.
+        m_planes = sample_points;
+        m_planes.push_back( m_near );
+        m_planes.push_back( m_far );
+
+        readCodes();
+
+        const uint32_t code_near = m_codes[ num_points ];
+        const uint32_t code_far  = m_codes[ num_points + 1 ];
+
+        // brackets [2i] for L' and [2i+1] for H of the sample point i.
+        m_brackets.clear();
+
+        for ( int i = 0; i < num_points; i++ ) {
+
+            const auto s = sample_points[i];
+            const auto c = m_codes[i];
+
+            Bracket lower{ i, toBits( m_near ), toBits( s ), c, code_near < c, 0, 0 };
+            Bracket upper{ i, toBits( s ), toBits( m_far ), c + 1, code_far > c, 0, 0 };
+
+            if ( s < m_near || m_far < s ) {
+
+                lower.m_valid = false;
+                upper.m_valid = false;
+            }
+
+            m_brackets.push_back( lower );
+            m_brackets.push_back( upper );
+        }
+
+        m_num_rounds = 0;
+
+        while ( refine() ) {
+            m_num_rounds++;
+        }
+
+        for ( int i = 0; i < num_points; i++ ) {
+
+            const auto  s     = sample_points[i];
+            const auto& lower = m_brackets[ 2 * i     ];
+            const auto& upper = m_brackets[ 2 * i + 1 ];
+
+            float gap = m_far;
+
+            if ( lower.m_valid ) {
+                gap = std::min( gap, 2.0f * ( s - fromBits( lower.m_lo ) ) );
+            }
+
+            if ( upper.m_valid ) {
+                gap = std::min( gap, 2.0f * ( fromBits( upper.m_hi ) - s ) );
+            }
+
+            gaps[i] = gap;
+        }
+    }
+
+    // number of refinement rounds, i.e. readDepthCodes() calls - 1, of the
+    // last run().
+    int numRounds() const
+    {
+        return m_num_rounds;
+    }
+
+    // the rounds in which the sample point i had a bracket to refine.
+    int numRounds( const int i ) const
+    {
+        return std::max( m_brackets[ 2 * i ].m_num_rounds, m_brackets[ 2 * i + 1 ].m_num_rounds );
+    }
+
+    // the planes probed for the sample point i.
+    int numProbes( const int i ) const
+    {
+        return 1 + m_brackets[ 2 * i ].m_num_probes + m_brackets[ 2 * i + 1 ].m_num_probes;
+    }
+
+  private:
+
+    // the code reaches m_threshold between m_lo and m_hi.
+    // code( m_lo ) < m_threshold <= code( m_hi ).
+    struct Bracket {
+        int      m_point;
+        uint32_t m_lo;
+        uint32_t m_hi;
+        uint32_t m_threshold;
+        bool     m_valid;
+        int      m_num_rounds;
+        int      m_num_probes;
+    };
+
+    static uint32_t toBits( const float v )
+    {
+        uint32_t bits;
+        memcpy( &bits, &v, sizeof(bits) );
+        return bits;
+    }
+
+    static float fromBits( const uint32_t bits )
+    {
+        float v;
+        memcpy( &v, &bits, sizeof(v) );
+        return v;
+    }
+
+    void readCodes()
+    {
+        m_tester.readDepthCodes( m_near, m_far, m_param_c, m_planes, m_codes );
+    }
+
+    // returns false if all the brackets are down to adjacent floats.
+    bool refine()
+    {
+        m_planes.clear();
+        m_probe_begin.assign( m_brackets.size(), 0 );
+
+        for ( size_t b = 0; b < m_brackets.size(); b++ ) {
+
+            const auto& bracket = m_brackets[b];
+
+            m_probe_begin[b] = m_planes.size();
+
+            if ( !bracket.m_valid ) {
+                continue;
+            }
+
+            const uint32_t span = bracket.m_hi - bracket.m_lo;
+
+            if ( span <= 1 ) {
+                continue;
+            }
+
+            const uint32_t num_probes = std::min( span - 1, static_cast<uint32_t>( PROBES_PER_BRACKET - 1 ) );
+
+            m_brackets[b].m_num_rounds++;
+            m_brackets[b].m_num_probes += num_probes;
+
+            for ( uint32_t k = 1; k <= num_probes; k++ ) {
+
+                const auto offset = static_cast<uint64_t>( span ) * k / ( num_probes + 1 );
+
+                m_planes.push_back( fromBits( bracket.m_lo + static_cast<uint32_t>( offset ) ) );
+            }
+        }
+
+        if ( m_planes.empty() ) {
+            return false;
+        }
+
+        readCodes();
+
+        for ( size_t b = 0; b < m_brackets.size(); b++ ) {
+
+            auto& bracket = m_brackets[b];
+
+            const size_t begin = m_probe_begin[b];
+            const size_t end   = ( b + 1 < m_brackets.size() ) ? m_probe_begin[ b + 1 ] : m_planes.size();
+
+            for ( size_t p = begin; p < end; p++ ) {
+
+                if ( m_codes[p] >= bracket.m_threshold ) {
+
+                    bracket.m_hi = toBits( m_planes[p] );
+                    break;
+                }
+                bracket.m_lo = toBits( m_planes[p] );
+            }
+        }
+
+        return true;
+    }
+
+    DepthTester& m_tester;
+    const float  m_near;
+    const float  m_far;
+    const float  m_param_c;
+    int          m_num_rounds;
+
+    std::vector< Bracket >  m_brackets;
+    std::vector< size_t >   m_probe_begin;
+    std::vector< float >    m_planes;
+    std::vector< uint32_t > m_codes;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_DEPTH_CODE_SEARCH_HPP__*/
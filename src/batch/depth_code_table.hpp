@@ -0,0 +1,446 @@
+#ifndef __DEPTH_TEST_DEPTH_CODE_TABLE_HPP__
+#define __DEPTH_TEST_DEPTH_CODE_TABLE_HPP__
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "depth_tester.hpp"
+#include "work_stealing_scheduler.hpp"
+
+namespace DepthTest {
+
+// Ground truth of the resolvable gap over [near, far], from the depth
+// codes of every float plane in the range.
+//
+// The positive floats are in the same order as their bit patterns, so the
+// planes in [near, far] are the consecutive integers from the bits of near
+// to the ones of far. They are read in blocks of BLOCK_SIZE planes with
+// readDepthCodes(), one block per item of the workers.
+//
+// A step is a run of consecutive planes with the same code, i.e. the z
+// interval that maps to the code. Where the codes increase with z, two
+// planes are resolved iff they are in different steps, so the step at z
+// bounds the gap at z from above, and DepthCodeSearch finds
+// 2 * min( s - L', H - s ) within it.
+// A step with a lower code than the one before is counted as a descent,
+// i.e. where the float evaluation of the depth is not monotonic and the
+// steps are split by the rounding noise.
+//
+// The steps are summarized into bins evenly spaced on log z, as the sample
+// points of BatchTester. The steps at near and far are cut at the range.
+class DepthCodeTable {
+
+  public:
+
+    static constexpr int BLOCK_SIZE = 65536;
+
+    struct Bin {
+        float    m_z_low;
+        float    m_z_high;
+        uint64_t m_num_steps;  // the steps that start in the bin.
+        uint64_t m_num_descents;
+        double   m_min_step;
+        double   m_max_step;
+        double   m_sum_step;
+    };
+
+    // the planes in [m_first, m_next) get m_code.
+    struct Step {
+        uint32_t m_code;
+        float    m_first;
+        float    m_next;
+    };
+
+    // testers: one per worker thread.
+    DepthCodeTable(
+        const std::vector< DepthTester* >& testers,
+        const float                        near,
+        const float                        far,
+        const float                        param_c,
+        const int                          num_bins
+    ) noexcept
+        :m_testers     { testers }
+        ,m_scheduler   { static_cast<int>( testers.size() ) }
+        ,m_near        { near }
+        ,m_far         { far }
+        ,m_param_c     { param_c }
+        ,m_num_bins    { std::max( 1, num_bins ) }
+        ,m_num_planes  { 0 }
+        ,m_num_steps   { 0 }
+        ,m_num_descents{ 0 }
+    {
+    }
+
+    // reads the codes of all the planes and fills the bins.
+    void build()
+    {
+        const uint32_t bits_near = toBits( m_near );
+        const uint32_t bits_far  = toBits( m_far );
+
+        m_num_planes = static_cast<uint64_t>( bits_far ) - bits_near + 1;
+
+        const int num_blocks = static_cast<int>( ( m_num_planes + BLOCK_SIZE - 1 ) / BLOCK_SIZE );
+
+        m_block_edges.assign( num_blocks, BlockEdges{} );
+
+        m_workers = std::vector< Worker >( m_scheduler.numWorkers() );
+
+        for ( auto& w : m_workers ) {
+            w.m_bins = emptyBins();
+        }
+
+        m_scheduler.run(
+
+            num_blocks,
+
+            [ this ]( const int worker ) {
+                m_testers[ worker ]->attachThread();
+            },
+
+            [ this ]( const int worker, const int block ) {
+                scanBlock( m_workers[ worker ], *m_testers[ worker ], block );
+            },
+
+            [ this ]( const int worker ) {
+                m_testers[ worker ]->detachThread();
+            }
+        );
+
+        m_bins      = emptyBins();
+        m_num_steps = 0;
+
+        for ( const auto& w : m_workers ) {
+
+            for ( int i = 0; i < m_num_bins; i++ ) {
+                mergeBin( m_bins[i], w.m_bins[i] );
+            }
+            m_num_steps += w.m_num_steps;
+        }
+
+        m_workers.clear();
+
+        stitchBlocks( num_blocks );
+    }
+
+    const std::vector< Bin >& bins() const
+    {
+        return m_bins;
+    }
+
+    uint64_t numPlanes() const
+    {
+        return m_num_planes;
+    }
+
+    uint64_t numSteps() const
+    {
+        return m_num_steps;
+    }
+
+    uint64_t numDescents() const
+    {
+        return m_num_descents;
+    }
+
+    // the step around z in [near, far], read on the first tester on the
+    // calling thread without build().
+    // gap: 2 * min( z - L', H - z ) with the planes L' and H just outside
+    // the step, as DepthCodeSearch, or far if the step reaches near and far.
+    Step query( const float z, float& gap )
+    {
+        const uint32_t bits_near = toBits( m_near );
+        const uint32_t bits_far  = toBits( m_far );
+        const uint32_t bits_z    = toBits( std::min( m_far, std::max( m_near, z ) ) );
+
+        DepthTester& tester = *m_testers[0];
+
+        tester.attachThread();
+
+        readCodes( tester, bits_z, bits_z + 1 );
+
+        const uint32_t code = m_codes[0];
+
+        // walk down to the first plane of the step.
+        uint32_t first       = bits_z;
+        bool     lower_found = false;
+
+        while ( first > bits_near && !lower_found ) {
+
+            const uint32_t begin = ( first - bits_near > BLOCK_SIZE ) ? first - BLOCK_SIZE : bits_near;
+
+            readCodes( tester, begin, first );
+
+            first = begin;
+
+            for ( int i = static_cast<int>( m_codes.size() ) - 1; i >= 0; i-- ) {
+
+                if ( m_codes[i] != code ) {
+
+                    first       = begin + i + 1;
+                    lower_found = true;
+                    break;
+                }
+            }
+        }
+
+        // walk up to the first plane after the step.
+        uint32_t next        = bits_z + 1;
+        bool     upper_found = false;
+
+        while ( next <= bits_far && !upper_found ) {
+
+            const uint32_t end = static_cast< uint32_t >(
+                std::min< uint64_t >( static_cast<uint64_t>( bits_far ) + 1, static_cast<uint64_t>( next ) + BLOCK_SIZE ) );
+
+            readCodes( tester, next, end );
+
+            const uint32_t begin = next;
+
+            next = end;
+
+            for ( size_t i = 0; i < m_codes.size(); i++ ) {
+
+                if ( m_codes[i] != code ) {
+
+                    next        = begin + static_cast< uint32_t >( i );
+                    upper_found = true;
+                    break;
+                }
+            }
+        }
+
+        tester.detachThread();
+
+        gap = m_far;
+
+        if ( lower_found ) {
+            gap = std::min( gap, 2.0f * ( z - fromBits( first - 1 ) ) );
+        }
+
+        if ( upper_found ) {
+            gap = std::min( gap, 2.0f * ( fromBits( next ) - z ) );
+        }
+
+        return Step{ code, fromBits( first ), fromBits( next ) };
+    }
+
+  private:
+
+    // the codes at the ends of a block, to join the steps across the blocks.
+    struct BlockEdges {
+        uint32_t m_first_code;
+        uint32_t m_last_code;
+        uint32_t m_first_step_end;   // the plane after the first step.
+        uint32_t m_last_step_begin;
+        bool     m_single_step;
+    };
+
+    struct Worker {
+        std::vector< float >    m_planes;
+        std::vector< uint32_t > m_codes;
+        std::vector< Bin >      m_bins;
+        uint64_t                m_num_steps = 0;
+    };
+
+    static uint32_t toBits( const float v )
+    {
+        uint32_t bits;
+        memcpy( &bits, &v, sizeof(bits) );
+        return bits;
+    }
+
+    static float fromBits( const uint32_t bits )
+    {
+        float v;
+        memcpy( &v, &bits, sizeof(v) );
+        return v;
+    }
+
+    std::vector< Bin > emptyBins() const
+    {
+        std::vector< Bin > bins( m_num_bins );
+
+        const double log_range = log( static_cast<double>( m_far ) / m_near );
+
+        for ( int i = 0; i < m_num_bins; i++ ) {
+
+            bins[i].m_z_low        = static_cast<float>( m_near * exp( log_range * i / m_num_bins ) );
+            bins[i].m_z_high       = static_cast<float>( m_near * exp( log_range * ( i + 1 ) / m_num_bins ) );
+            bins[i].m_num_steps    = 0;
+            bins[i].m_num_descents = 0;
+            bins[i].m_min_step     = std::numeric_limits< double >::infinity();
+            bins[i].m_max_step     = 0.0;
+            bins[i].m_sum_step     = 0.0;
+        }
+
+        return bins;
+    }
+
+    int binOf( const float z ) const
+    {
+        const double t = log( static_cast<double>( z ) / m_near ) / log( static_cast<double>( m_far ) / m_near );
+
+        return std::min( m_num_bins - 1, std::max( 0, static_cast<int>( t * m_num_bins ) ) );
+    }
+
+    static void mergeBin( Bin& bin, const Bin& other )
+    {
+        bin.m_num_steps    += other.m_num_steps;
+        bin.m_num_descents += other.m_num_descents;
+        bin.m_min_step   = std::min( bin.m_min_step, other.m_min_step );
+        bin.m_max_step   = std::max( bin.m_max_step, other.m_max_step );
+        bin.m_sum_step  += other.m_sum_step;
+    }
+
+    // the step of the planes [first, next).
+    void addStep( std::vector< Bin >& bins, uint64_t& num_steps, const uint32_t first, const uint32_t next ) const
+    {
+        const float  z    = fromBits( first );
+        const double step = static_cast<double>( fromBits( next ) ) - static_cast<double>( z );
+
+        auto& bin = bins[ binOf( z ) ];
+
+        bin.m_num_steps++;
+        bin.m_min_step  = std::min( bin.m_min_step, step );
+        bin.m_max_step  = std::max( bin.m_max_step, step );
+        bin.m_sum_step += step;
+
+        num_steps++;
+    }
+
+    // the codes of the planes [begin, end) into m_codes.
+    void readCodes( DepthTester& tester, const uint32_t begin, const uint32_t end )
+    {
+        m_planes.resize( end - begin );
+
+        for ( uint32_t i = 0; i < end - begin; i++ ) {
+            m_planes[i] = fromBits( begin + i );
+        }
+
+        tester.readDepthCodes( m_near, m_far, m_param_c, m_planes, m_codes );
+    }
+
+    // adds the steps inside the block, and records the ones at its ends.
+    void scanBlock( Worker& w, DepthTester& tester, const int block )
+    {
+        const uint32_t bits_near = toBits( m_near );
+        const uint32_t begin     = bits_near + static_cast< uint32_t >( block ) * BLOCK_SIZE;
+        const uint32_t end       = static_cast< uint32_t >(
+            std::min< uint64_t >( static_cast<uint64_t>( bits_near ) + m_num_planes, static_cast<uint64_t>( begin ) + BLOCK_SIZE ) );
+
+        w.m_planes.resize( end - begin );
+
+        for ( uint32_t i = 0; i < end - begin; i++ ) {
+            w.m_planes[i] = fromBits( begin + i );
+        }
+
+        tester.readDepthCodes( m_near, m_far, m_param_c, w.m_planes, w.m_codes );
+
+        auto& edges = m_block_edges[ block ];
+
+        edges.m_first_code     = w.m_codes.front();
+        edges.m_last_code      = w.m_codes.back();
+        edges.m_first_step_end = end;
+        edges.m_single_step    = true;
+
+        uint32_t code       = w.m_codes.front();
+        uint32_t step_begin = begin;
+
+        for ( uint32_t i = 1; i < end - begin; i++ ) {
+
+            if ( w.m_codes[i] == code ) {
+                continue;
+            }
+
+            if ( edges.m_single_step ) {
+
+                edges.m_first_step_end = begin + i;
+                edges.m_single_step    = false;
+            }
+            else {
+                addStep( w.m_bins, w.m_num_steps, step_begin, begin + i );
+            }
+
+            if ( w.m_codes[i] < code ) {
+                w.m_bins[ binOf( w.m_planes[i] ) ].m_num_descents++;
+            }
+
+            code       = w.m_codes[i];
+            step_begin = begin + i;
+        }
+
+        edges.m_last_step_begin = step_begin;
+    }
+
+    // adds the steps that cross or touch the ends of the blocks.
+    void stitchBlocks( const int num_blocks )
+    {
+        const uint32_t bits_near = toBits( m_near );
+        const uint32_t bits_far  = toBits( m_far );
+
+        uint32_t code       = m_block_edges.front().m_first_code;
+        uint32_t step_begin = bits_near;
+
+        for ( int b = 0; b < num_blocks; b++ ) {
+
+            const auto&    edges = m_block_edges[b];
+            const uint32_t begin = bits_near + static_cast< uint32_t >( b ) * BLOCK_SIZE;
+
+            if ( b > 0 && edges.m_first_code != code ) {
+
+                addStep( m_bins, m_num_steps, step_begin, begin );
+
+                if ( edges.m_first_code < code ) {
+                    m_bins[ binOf( fromBits( begin ) ) ].m_num_descents++;
+                }
+
+                code       = edges.m_first_code;
+                step_begin = begin;
+            }
+
+            if ( !edges.m_single_step ) {
+
+                addStep( m_bins, m_num_steps, step_begin, edges.m_first_step_end );
+
+                code       = edges.m_last_code;
+                step_begin = edges.m_last_step_begin;
+            }
+        }
+
+        addStep( m_bins, m_num_steps, step_begin, bits_far + 1 );
+
+        m_num_descents = 0;
+
+        for ( const auto& bin : m_bins ) {
+            m_num_descents += bin.m_num_descents;
+        }
+    }
+
+    const std::vector< DepthTester* > m_testers;
+    WorkStealingScheduler             m_scheduler;
+
+    const float                       m_near;
+    const float                       m_far;
+    const float                       m_param_c;
+    const int                         m_num_bins;
+
+    std::vector< Bin >                m_bins;
+    std::vector< BlockEdges >         m_block_edges;
+    std::vector< Worker >             m_workers;
+
+    uint64_t                          m_num_planes;
+    uint64_t                          m_num_steps;
+    uint64_t                          m_num_descents;
+
+    // for query().
+    std::vector< float >              m_planes;
+    std::vector< uint32_t >           m_codes;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_DEPTH_CODE_TABLE_HPP__*/
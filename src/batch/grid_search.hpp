@@ -0,0 +1,194 @@
+#ifndef __DEPTH_TEST_GRID_SEARCH_HPP__
+#define __DEPTH_TEST_GRID_SEARCH_HPP__
+
+#include <algorithm>
+
+#include "search_strategy.hpp"
+
+namespace DepthTest {
+
+// The original search of the tool.
+//
+// Each round probes 4 gaps on a grid from base_gap down to base_gap - 3/4 range,
+// and stops at the first failure. The grid is widened if base_gap itself
+// fails, and narrowed otherwise.
+//
+// The search ends when the planes at sample_point -/+ gap/2 round to the
+// same floats for all the gaps on the grid, as the further rounds would
+// probe the same planes. The result is then the distance between the float
+// planes of base_gap.
+class GridSearch : public SearchStrategy {
+
+  public:
+
+    GridSearch( const float near, const float far, const float sample_point ) noexcept
+        :SearchStrategy{ near, far, sample_point }
+        ,m_base_gap    { 0.0f }
+        ,m_range       { 0.0f }
+        ,m_step        { 0 }
+    {
+        if ( sample_point < near || far < sample_point ) {
+
+            m_base_gap = far;
+            return;
+        }
+
+        const auto min_gap = std::min( sample_point - near, far - sample_point );
+
+        m_base_gap = min_gap * 0.1f;
+        m_range    = m_base_gap;
+        updateFinished();
+    }
+
+    // the first grid probes 2, 1.5, 1, and 0.5 times gap.
+    void seed( const float gap ) override
+    {
+        if ( m_finished || !( gap > 0.0f ) ) {
+            return;
+        }
+
+        const auto base_gap = m_base_gap;
+        const auto range    = m_range;
+
+        m_base_gap = 2.0f * gap;
+        m_range    = m_base_gap;
+
+        if ( !isBaseGapAndRangeOK() ) {
+
+            m_base_gap = base_gap; // keep the blind start.
+            m_range    = range;
+        }
+        updateFinished();
+    }
+
+    float nextGap() const override
+    {
+        return m_base_gap - static_cast<float>(m_step) / 4.0f * m_range;
+    }
+
+    void report( const bool resolved ) override
+    {
+        m_num_probes++;
+
+        if ( resolved == false ) {
+
+            if ( m_step == 0 )  {
+
+                m_base_gap += m_range;
+                m_range = 2.0f * m_range; // widen the search
+            }
+            else if ( m_step == 1 ) {
+
+                m_range = 0.5f * m_range; // narrow the search
+            }
+            else if ( m_step == 2 ) {
+
+                m_base_gap -= ( 0.25f * m_range );
+                m_range = 0.5f * m_range; // narrow the search
+            }
+            else{ // m_step == 3
+                m_base_gap -= ( 0.5f * m_range );
+                m_range = 0.5f * m_range; // narrow the search
+            }
+            endRound();
+        }
+        else if ( m_step == 3 ) { // true until step 3
+
+            m_base_gap -= ( 0.5f * m_range );
+            m_range = 0.5f * m_range; // narrow the search
+            endRound();
+        }
+        else {
+            m_step++;
+        }
+    }
+
+    float result() const override
+    {
+        return m_base_gap;
+    }
+
+    bool atRoundStart() const override
+    {
+        return m_step == 0;
+    }
+
+    // m_a: base gap, m_b: range.
+    State state() const override
+    {
+        return { m_base_gap, m_range, 0, 0, m_num_probes, m_num_rounds };
+    }
+
+    void restore( const State& state ) override
+    {
+        m_base_gap   = static_cast<float>( state.m_a );
+        m_range      = static_cast<float>( state.m_b );
+        m_num_probes = state.m_num_probes;
+        m_num_rounds = state.m_num_rounds;
+        m_step       = 0;
+        updateFinished();
+    }
+
+  private:
+
+    void endRound()
+    {
+        m_num_rounds++;
+        m_step = 0;
+        updateFinished();
+    }
+
+    void updateFinished()
+    {
+        if ( !isBaseGapAndRangeOK() ) {
+
+            m_finished = true;
+        }
+        else if ( isSamePlanes( m_base_gap - m_range, m_base_gap ) ) {
+
+            // all the gaps on the grid give the same planes.
+            m_base_gap = representableGap( m_base_gap );
+            m_finished = true;
+        }
+        else {
+            m_finished = false;
+        }
+    }
+
+    bool isBaseGapAndRangeOK() const
+    {
+        if( m_range <= MINIMUM_GAP ) {
+
+            return false; // the gap too small in general.
+        }
+        if( m_base_gap >= MAXIMUM_GAP ) {
+
+            return false; // the gap too big in general.
+        }
+
+        if ( m_base_gap >= m_sample_point * 0.5f ) {
+
+            return false; // the gap too big for the sample point.
+        }
+
+        if ( m_sample_point + m_base_gap * 0.5f >= m_far ) {
+
+            return false; // the grid exceeds the far limit.
+        }
+
+        if ( m_sample_point - m_base_gap * 0.5f <= m_near ) {
+
+            return false; // the grid exceeds the near limit.
+        }
+
+        return true;
+    }
+
+    float m_base_gap;
+    float m_range;
+    int   m_step;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_GRID_SEARCH_HPP__*/
@@ -0,0 +1,172 @@
+#ifndef __DEPTH_TEST_LOG_BISECTION_SEARCH_HPP__
+#define __DEPTH_TEST_LOG_BISECTION_SEARCH_HPP__
+
+#include <cmath>
+
+#include "search_strategy.hpp"
+
+namespace DepthTest {
+
+// Bisection of [MINIMUM_GAP, gap limit) at the geometric mean, i.e. in the
+// log of the gap, after checking that the half of the gap limit resolves.
+// As the interval shrinks doubly exponentially, it takes only a few more
+// probes for a minimum gap of many float steps than for a single step.
+//
+// With a seed, the bracket starts as [seed / 4, seed * 4], and both bounds
+// are checked first. If either is wrong, it falls back to the wider one.
+//
+// It ends when the bounds give the same float planes, and reports the
+// distance between the float planes of the upper bound.
+class LogBisectionSearch : public SearchStrategy {
+
+  public:
+
+    static constexpr float SEED_BRACKET = 4.0f;
+
+    LogBisectionSearch( const float near, const float far, const float sample_point ) noexcept
+        :SearchStrategy{ near, far, sample_point }
+        ,m_lo          { MINIMUM_GAP }
+        ,m_hi          { 0.5f * gapLimit() }
+        ,m_hi_checked  { false }
+        ,m_lo_checked  { true }
+    {
+        m_finished = !isSamplePointInRange() || m_hi <= m_lo;
+    }
+
+    void seed( const float gap ) override
+    {
+        if ( m_finished || !( gap > 0.0f ) ) {
+            return;
+        }
+
+        const auto hi = std::min( gap * SEED_BRACKET, m_hi );
+        const auto lo = std::max( gap / SEED_BRACKET, MINIMUM_GAP );
+
+        if ( lo < hi ) {
+
+            m_lo         = lo;
+            m_hi         = hi;
+            m_lo_checked = false;
+        }
+    }
+
+    float nextGap() const override
+    {
+        if ( !m_hi_checked ) {
+            return m_hi;
+        }
+        if ( !m_lo_checked ) {
+            return m_lo;
+        }
+        return midGap();
+    }
+
+    void report( const bool resolved ) override
+    {
+        m_num_probes++;
+        m_num_rounds++;
+
+        if ( !m_hi_checked ) {
+
+            if ( resolved ) {
+
+                m_hi_checked = true;
+            }
+            else if ( m_hi >= 0.5f * gapLimit() ) {
+
+                m_hi       = m_far; // nothing resolves within the limit.
+                m_finished = true;
+                return;
+            }
+            else {
+                // the seed is too small. bisect above it.
+                m_lo         = m_hi;
+                m_lo_checked = true;
+                m_hi         = 0.5f * gapLimit();
+            }
+        }
+        else if ( !m_lo_checked ) {
+
+            m_lo_checked = true;
+
+            if ( resolved ) {
+
+                // the seed is too large. bisect below it.
+                m_hi = m_lo;
+                m_lo = MINIMUM_GAP;
+            }
+        }
+        else {
+            const auto mid = midGap();
+
+            if ( resolved ) {
+                m_hi = mid;
+            }
+            else {
+                m_lo = mid;
+            }
+        }
+
+        updateFinished();
+    }
+
+    float result() const override
+    {
+        if ( !isSamplePointInRange() || m_hi >= m_far ) {
+            return m_far;
+        }
+        return representableGap( m_hi );
+    }
+
+    bool atRoundStart() const override
+    {
+        return true;
+    }
+
+    // m_a: lower bound, m_b: upper bound,
+    // m_phase: 1 if the upper bound is checked + 2 if the lower bound is.
+    State state() const override
+    {
+        return { m_lo, m_hi, ( m_hi_checked ? 1 : 0 ) + ( m_lo_checked ? 2 : 0 ), 0, m_num_probes, m_num_rounds };
+    }
+
+    void restore( const State& state ) override
+    {
+        m_lo         = static_cast<float>( state.m_a );
+        m_hi         = static_cast<float>( state.m_b );
+        m_hi_checked = ( state.m_phase & 1 ) != 0;
+        m_lo_checked = ( state.m_phase & 2 ) != 0;
+        m_num_probes = state.m_num_probes;
+        m_num_rounds = state.m_num_rounds;
+        updateFinished();
+    }
+
+  protected:
+
+    float midGap() const
+    {
+        return static_cast<float>( std::sqrt( static_cast<double>( m_lo ) * static_cast<double>( m_hi ) ) );
+    }
+
+    void updateFinished()
+    {
+        if ( !m_hi_checked || !m_lo_checked ) {
+
+            m_finished = false;
+            return;
+        }
+
+        const auto mid = midGap();
+
+        m_finished = isSamePlanes( m_lo, m_hi ) || mid <= m_lo || m_hi <= mid;
+    }
+
+    float m_lo; // not resolved, or MINIMUM_GAP.
+    float m_hi; // resolved.
+    bool  m_hi_checked;
+    bool  m_lo_checked;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_LOG_BISECTION_SEARCH_HPP__*/
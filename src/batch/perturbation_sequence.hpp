@@ -0,0 +1,148 @@
+#ifndef __DEPTH_TEST_PERTURBATION_SEQUENCE_HPP__
+#define __DEPTH_TEST_PERTURBATION_SEQUENCE_HPP__
+
+#include <cstdint>
+#include <cmath>
+#include <random>
+
+namespace DepthTest {
+
+// The perturbations of the gap of the perturbed samples of a probe,
+// uniform in [ -gap / 500, gap / 500 ).
+//
+// RANDOM: drawn from the random engine of the search, scaled from its raw
+//         output rather than by std::uniform_real_distribution, whose
+//         algorithm is up to the standard library.
+// HALTON: the radical inverse in base 3, i.e. the second dimension of
+//         Halton, rotated by a random shift modulo 1 (Cranley-Patterson).
+//         the first one in base 2 would be the same points as SOBOL in 1D.
+// SOBOL:  the first dimension of Sobol in the Gray code order, with a random
+//         digital shift, i.e. XORed with a random 32 bit integer.
+//
+// The low discrepancy ones cover the interval evenly with any prefix of a
+// probe, so the early probes of SequentialTest are spread as well. Their
+// shifts are hashed from the seed, the sample point and the probe number
+// with integer arithmetic only, so they are the same on any platform and
+// do not depend on the random engine.
+class PerturbationSequence {
+
+  public:
+
+    typedef enum _Kind {
+        RANDOM,
+        HALTON,
+        SOBOL
+    } Kind;
+
+    PerturbationSequence( const Kind kind = RANDOM, const uint64_t seed = 0 ) noexcept
+        :m_kind { kind }
+        ,m_seed { seed }
+        ,m_shift{ 0 }
+        ,m_next { 0 }
+    {
+    }
+
+    Kind kind() const
+    {
+        return m_kind;
+    }
+
+    // starts the perturbations of the probe-th probe of the sample point at index.
+    void begin( const int index, const int probe )
+    {
+        m_shift = static_cast< uint32_t >(
+                      mix( mix( m_seed ^ static_cast< uint64_t >( index ) ) + static_cast< uint64_t >( probe ) ) >> 32 );
+        m_next  = 0;
+    }
+
+    float next( std::default_random_engine& rand_gen, const float gap )
+    {
+        double u;
+
+        if ( m_kind == RANDOM ) {
+
+            const double range = static_cast<double>( rand_gen.max() - rand_gen.min() ) + 1.0;
+
+            u = static_cast<double>( rand_gen() - rand_gen.min() ) / range;
+
+            return static_cast<float>( ( 2.0 * u - 1.0 ) * static_cast<double>( gap / 500.0f ) );
+        }
+
+        const uint32_t i = m_next++;
+
+        if ( m_kind == HALTON ) {
+
+            u = radicalInverse3( i ) + static_cast<double>( m_shift ) / 4294967296.0;
+            u = u - floor( u );
+        }
+        else {
+            u = static_cast<double>( reverseBits( i ^ ( i >> 1 ) ) ^ m_shift ) / 4294967296.0;
+        }
+
+        return static_cast<float>( ( 2.0 * u - 1.0 ) * static_cast<double>( gap / 500.0f ) );
+    }
+
+    static const char* kindName( const Kind kind )
+    {
+        switch ( kind ) {
+
+          case HALTON:
+            return "halton";
+
+          case SOBOL:
+            return "sobol";
+
+          default:
+            return "random";
+        }
+    }
+
+  private:
+
+    // the radical inverse in base 2 of the 32 bits.
+    static uint32_t reverseBits( uint32_t v )
+    {
+        v = ( ( v >> 1 ) & 0x55555555u ) | ( ( v & 0x55555555u ) << 1 );
+        v = ( ( v >> 2 ) & 0x33333333u ) | ( ( v & 0x33333333u ) << 2 );
+        v = ( ( v >> 4 ) & 0x0F0F0F0Fu ) | ( ( v & 0x0F0F0F0Fu ) << 4 );
+        v = ( ( v >> 8 ) & 0x00FF00FFu ) | ( ( v & 0x00FF00FFu ) << 8 );
+
+        return ( v >> 16 ) | ( v << 16 );
+    }
+
+    // the radical inverse in base 3, as the reversed digits over 3^digits,
+    // both exact in 64 bits for the 21 digits of 32 bits at most.
+    static double radicalInverse3( uint32_t v )
+    {
+        uint64_t reversed    = 0;
+        uint64_t denominator = 1;
+
+        while ( v > 0 ) {
+
+            reversed     = reversed * 3 + v % 3;
+            denominator *= 3;
+            v           /= 3;
+        }
+
+        return static_cast<double>( reversed ) / static_cast<double>( denominator );
+    }
+
+    // the finalizer of splitmix64.
+    static uint64_t mix( uint64_t v )
+    {
+        v += 0x9E3779B97F4A7C15ull;
+        v = ( v ^ ( v >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+        v = ( v ^ ( v >> 27 ) ) * 0x94D049BB133111EBull;
+
+        return v ^ ( v >> 31 );
+    }
+
+    Kind     m_kind;
+    uint64_t m_seed;
+    uint32_t m_shift;
+    uint32_t m_next;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_PERTURBATION_SEQUENCE_HPP__*/
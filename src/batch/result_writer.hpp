@@ -0,0 +1,223 @@
+#ifndef __DEPTH_TEST_RESULT_WRITER_HPP__
+#define __DEPTH_TEST_RESULT_WRITER_HPP__
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+
+namespace DepthTest {
+
+// Buffered writer of the per sample point results of BatchTester.
+//
+// BINARY: 32 byte header followed by 32 byte records, little endian.
+//     header: "ZFTR", version, depth type, near, far, c,
+//             num_perturbed_samples, record size
+//     record: index (u32), sample point (f32), min gap (f32),
+//             iterations (u32), probes (u32), wall time in seconds (f64),
+//             confidence (f32)
+// CSV:    one line per record with a header line.
+// NPY:    the records as a structured array of numpy. The shape is
+//         written in close().
+//
+// python/output_parser.py loads all of them.
+class ResultWriter {
+
+  public:
+
+    typedef enum _Format {
+        BINARY,
+        CSV,
+        NPY
+    } Format;
+
+    struct Record {
+        uint32_t m_index;
+        float    m_sample_point;
+        float    m_min_gap;
+        uint32_t m_num_iterations;
+        uint32_t m_num_probes;
+        double   m_wall_time;
+        float    m_confidence; // the lowest of the verdicts of the search settled
+                               // by SequentialTest. NaN if none.
+    };
+
+    static constexpr uint32_t VERSION     = 2;
+    static constexpr size_t   RECORD_SIZE = 32;
+    static constexpr size_t   BUFFER_SIZE = 64 * 1024;
+
+    ResultWriter(
+        const std::string& file_path,
+        const Format       format,
+        const uint32_t     depth_test_type,
+        const float        near,
+        const float        far,
+        const float        param_c,
+        const uint32_t     num_perturbed_samples
+    )
+        :m_os         ( file_path, std::ios::binary | std::ios::trunc )
+        ,m_format     { format }
+        ,m_num_records{ 0 }
+        ,m_shape_pos  { 0 }
+    {
+        if ( !m_os ) {
+
+            throw std::runtime_error( "cannot open " + file_path );
+        }
+
+        m_buffer.reserve( BUFFER_SIZE );
+
+        switch ( m_format ) {
+
+          case BINARY:
+            m_buffer.insert( m_buffer.end(), { 'Z', 'F', 'T', 'R' } );
+            put( VERSION );
+            put( depth_test_type );
+            put( near );
+            put( far );
+            put( param_c );
+            put( num_perturbed_samples );
+            put( static_cast< uint32_t >( RECORD_SIZE ) );
+            break;
+
+          case CSV:
+            putString( "index,sample_point,min_gap,iterations,probes,wall_time,confidence\n" );
+            break;
+
+          case NPY:
+            writeNpyHeader();
+            break;
+        }
+    }
+
+    ~ResultWriter()
+    {
+        close();
+    }
+
+    void write( const Record& record )
+    {
+        if ( m_format == CSV ) {
+
+            char line[ 128 ];
+
+            snprintf(
+                line,
+                sizeof(line),
+                "%u,%.9g,%.9g,%u,%u,%.6f,%.9g\n",
+                record.m_index,
+                record.m_sample_point,
+                record.m_min_gap,
+                record.m_num_iterations,
+                record.m_num_probes,
+                record.m_wall_time,
+                record.m_confidence
+            );
+            putString( line );
+        }
+        else {
+            put( record.m_index );
+            put( record.m_sample_point );
+            put( record.m_min_gap );
+            put( record.m_num_iterations );
+            put( record.m_num_probes );
+            put( record.m_wall_time );
+            put( record.m_confidence );
+        }
+
+        m_num_records++;
+
+        if ( m_buffer.size() >= BUFFER_SIZE ) {
+            flush();
+        }
+    }
+
+    void flush()
+    {
+        if ( !m_buffer.empty() ) {
+
+            m_os.write( m_buffer.data(), m_buffer.size() );
+            m_buffer.clear();
+        }
+        m_os.flush();
+    }
+
+    void close()
+    {
+        if ( !m_os.is_open() ) {
+            return;
+        }
+
+        flush();
+
+        if ( m_format == NPY ) {
+
+            // fill in the number of records reserved in the header.
+            const auto shape = std::to_string( m_num_records );
+
+            m_os.seekp( m_shape_pos );
+            m_os.write( shape.data(), shape.size() );
+        }
+
+        m_os.close();
+    }
+
+    uint64_t numRecords() const
+    {
+        return m_num_records;
+    }
+
+  private:
+
+    template< class T >
+    void put( const T v )
+    {
+        // all the supported platforms are little endian.
+        char bytes[ sizeof(T) ];
+        memcpy( bytes, &v, sizeof(T) );
+        m_buffer.insert( m_buffer.end(), bytes, bytes + sizeof(T) );
+    }
+
+    void putString( const std::string& s )
+    {
+        m_buffer.insert( m_buffer.end(), s.begin(), s.end() );
+    }
+
+    void writeNpyHeader()
+    {
+        // version 1.0. the shape is left blank for close() to fill in.
+        const std::string dict_head =
+            "{'descr': [('index', '<u4'), ('sample_point', '<f4'), ('min_gap', '<f4'), "
+            "('iterations', '<u4'), ('probes', '<u4'), ('wall_time', '<f8'), ('confidence', '<f4')], "
+            "'fortran_order': False, 'shape': (";
+
+        const std::string dict_tail = ",), }";
+
+        std::string dict = dict_head + std::string( 20, ' ' ) + dict_tail;
+
+        // magic (6) + version (2) + length (2) + dict + '\n' aligned to 64.
+        const size_t unpadded = 10 + dict.size() + 1;
+        dict += std::string( ( 64 - unpadded % 64 ) % 64, ' ' );
+        dict += '\n';
+
+        m_buffer.insert( m_buffer.end(), { '\x93', 'N', 'U', 'M', 'P', 'Y', '\x01', '\x00' } );
+        put( static_cast< uint16_t >( dict.size() ) );
+
+        m_shape_pos = m_buffer.size() + dict_head.size();
+
+        putString( dict );
+    }
+
+    std::ofstream       m_os;
+    const Format        m_format;
+    std::vector< char > m_buffer;
+    uint64_t            m_num_records;
+    size_t              m_shape_pos;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_RESULT_WRITER_HPP__*/
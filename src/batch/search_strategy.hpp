@@ -0,0 +1,166 @@
+#ifndef __DEPTH_TEST_SEARCH_STRATEGY_HPP__
+#define __DEPTH_TEST_SEARCH_STRATEGY_HPP__
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace DepthTest {
+
+// The search for the minimum resolvable gap at one sample point, as a state
+// machine, so that many searches can wait for their probes at the same time.
+// A probe at gap g tells whether two planes at sample_point -/+ g/2 are
+// resolved, which is assumed to hold for all the gaps above the minimum.
+//
+// usage:
+//     while ( !search.finished() ) {
+//         search.report( probe( search.nextGap() ) );
+//     }
+//     search.result();
+class SearchStrategy {
+
+  public:
+
+    static constexpr float MINIMUM_GAP = 1.0e-20; // real limit around 1.0E-37
+    static constexpr float MAXIMUM_GAP = 1.0e30;  // real limit around 1.0E+37
+
+    // the state at the start of a round, for Checkpoint.
+    // m_a, m_b, m_phase and m_step are up to the strategy.
+    // double holds the floats and the 32 bit counts exactly.
+    struct State {
+        double m_a;
+        double m_b;
+        int    m_phase;
+        int    m_step;
+        int    m_num_probes;
+        int    m_num_rounds;
+    };
+
+    SearchStrategy( const float near, const float far, const float sample_point ) noexcept
+        :m_near        { near }
+        ,m_far         { far }
+        ,m_sample_point{ sample_point }
+        ,m_finished    { true }
+        ,m_num_probes  { 0 }
+        ,m_num_rounds  { 0 }
+    {
+    }
+
+    virtual ~SearchStrategy()
+    {
+    }
+
+    bool finished() const
+    {
+        return m_finished;
+    }
+
+    // an estimate of the minimum gap, e.g. by AnalyticDepthModel, to start
+    // from. called before the first probe. the strategies that cannot use
+    // it ignore it.
+    virtual void seed( const float gap )
+    {
+        (void)gap;
+    }
+
+    // the gap to probe next.
+    virtual float nextGap() const = 0;
+
+    // the outcome of the probe at nextGap().
+    virtual void report( const bool resolved ) = 0;
+
+    // the minimum gap found, or far if the sample point is out of range or
+    // no gap within the limits is resolved.
+    virtual float result() const = 0;
+
+    // true between the rounds, where state() can be taken.
+    virtual bool atRoundStart() const = 0;
+
+    virtual State state() const = 0;
+
+    // continues the search of the same sample point from state.
+    virtual void restore( const State& state ) = 0;
+
+    float samplePoint() const
+    {
+        return m_sample_point;
+    }
+
+    // number of gaps probed.
+    int numProbes() const
+    {
+        return m_num_probes;
+    }
+
+    // number of rounds. a round is one probe except for GridSearch.
+    int numRounds() const
+    {
+        return m_num_rounds;
+    }
+
+  protected:
+
+    bool isSamplePointInRange() const
+    {
+        return m_near < m_sample_point && m_sample_point < m_far;
+    }
+
+    // the gaps at and above this do not fit around the sample point.
+    float gapLimit() const
+    {
+        const float limit = std::min( { 0.5f * m_sample_point,
+                                        2.0f * ( m_far - m_sample_point ),
+                                        2.0f * ( m_sample_point - m_near ),
+                                        MAXIMUM_GAP } );
+        return std::max( limit, 0.0f );
+    }
+
+    // the planes as BatchTester places them, without the perturbation.
+    float planeNear( const float gap ) const
+    {
+        return m_sample_point - 0.5f * gap;
+    }
+
+    float planeFar( const float gap ) const
+    {
+        return m_sample_point + 0.5f * gap;
+    }
+
+    // the distance between the float planes of gap.
+    float representableGap( const float gap ) const
+    {
+        return planeFar( gap ) - planeNear( gap );
+    }
+
+    // true if gap_1 and gap_2 give the same float planes.
+    bool isSamePlanes( const float gap_1, const float gap_2 ) const
+    {
+        return    planeNear( gap_1 ) == planeNear( gap_2 )
+               && planeFar ( gap_1 ) == planeFar ( gap_2 );
+    }
+
+    static uint32_t toBits( const float v )
+    {
+        uint32_t bits;
+        memcpy( &bits, &v, sizeof(bits) );
+        return bits;
+    }
+
+    static float fromBits( const uint32_t bits )
+    {
+        float v;
+        memcpy( &v, &bits, sizeof(v) );
+        return v;
+    }
+
+    const float m_near;
+    const float m_far;
+    const float m_sample_point;
+    bool        m_finished;
+    int         m_num_probes;
+    int         m_num_rounds;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_SEARCH_STRATEGY_HPP__*/
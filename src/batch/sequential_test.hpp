@@ -0,0 +1,178 @@
+#ifndef __DEPTH_TEST_SEQUENTIAL_TEST_HPP__
+#define __DEPTH_TEST_SEQUENTIAL_TEST_HPP__
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace DepthTest {
+
+// Sequential probability ratio test of one probe over its perturbed samples.
+// A sample passes if the nearer plane wins in both drawing orders.
+//
+//     H0: the gap is not resolved, the samples fail at UNRESOLVED_FAIL_RATE.
+//     H1: the gap is resolved, the samples fail at most at 1 / max_samples,
+//         i.e. as rarely as the full budget can tell.
+//
+// The log likelihood ratio of H1 over H0 is accumulated per sample, and the
+// verdict is settled when it leaves [ log( ( 1 - c ) / c ), log( c / ( 1 - c ) ) ]
+// for the confidence c. A clean pass then takes a handful of samples and a
+// clean failure one or two, while the borderline gaps run into max_samples,
+// where the verdict falls back to "resolved iff no sample failed".
+//
+// With confidence 0 it never stops early, and only tracks the confidence.
+class SequentialTest {
+
+  public:
+
+    static constexpr double UNRESOLVED_FAIL_RATE = 0.5;
+
+    typedef enum _Verdict {
+        UNDECIDED,
+        RESOLVED,
+        UNRESOLVED
+    } Verdict;
+
+    SequentialTest( const double confidence = 0.0, const int max_samples = 1 ) noexcept
+        :m_enabled    { confidence > 0.0 }
+        ,m_max_samples{ std::max( 1, max_samples ) }
+        ,m_log_pass   { 0.0 }
+        ,m_log_fail   { 0.0 }
+        ,m_upper      {  std::numeric_limits< double >::infinity() }
+        ,m_lower      { -std::numeric_limits< double >::infinity() }
+        ,m_min_samples{ m_max_samples }
+        ,m_llr        { 0.0 }
+        ,m_num_samples{ 0 }
+        ,m_num_failures{ 0 }
+        ,m_verdict    { UNDECIDED }
+    {
+        const double p0 = UNRESOLVED_FAIL_RATE;
+        const double p1 = std::min( 0.1, 1.0 / m_max_samples );
+
+        m_log_pass = log( ( 1.0 - p1 ) / ( 1.0 - p0 ) );
+        m_log_fail = log( p1 / p0 );
+
+        if ( m_enabled ) {
+
+            const double c = std::min( confidence, 1.0 - 1.0e-12 );
+
+            m_upper = log( c / ( 1.0 - c ) );
+            m_lower = -m_upper;
+
+            m_min_samples = std::max( 1, std::min( m_max_samples, static_cast<int>( ceil( m_upper / m_log_pass ) ) ) );
+        }
+    }
+
+    bool enabled() const
+    {
+        return m_enabled;
+    }
+
+    // starts a probe.
+    void begin()
+    {
+        m_llr          = 0.0;
+        m_num_samples  = 0;
+        m_num_failures = 0;
+        m_verdict      = UNDECIDED;
+    }
+
+    // the number of samples to render next, as a batch.
+    // the first batch settles a clean pass, and the next ones double.
+    int nextBatchSize() const
+    {
+        const int size = ( m_num_samples == 0 ) ? m_min_samples : m_num_samples;
+
+        return std::min( size, m_max_samples - m_num_samples );
+    }
+
+    Verdict add( const bool passed )
+    {
+        if ( m_verdict != UNDECIDED ) {
+            return m_verdict;
+        }
+
+        m_num_samples++;
+
+        if ( passed ) {
+            m_llr += m_log_pass;
+        }
+        else {
+            m_num_failures++;
+            m_llr += m_log_fail;
+        }
+
+        if ( m_llr >= m_upper ) {
+
+            m_verdict = RESOLVED;
+        }
+        else if ( m_llr <= m_lower ) {
+
+            m_verdict = UNRESOLVED;
+        }
+        else if ( m_num_samples >= m_max_samples ) {
+
+            m_verdict = ( m_num_failures == 0 ) ? RESOLVED : UNRESOLVED;
+        }
+
+        return m_verdict;
+    }
+
+    Verdict verdict() const
+    {
+        return m_verdict;
+    }
+
+    int numSamples() const
+    {
+        return m_num_samples;
+    }
+
+    // the confidence of the verdict, 1 - exp( -| log likelihood ratio | ) on
+    // its side. NaN if the ratio did not settle it, i.e. undecided, or by
+    // the fallback at max_samples, which is always the case without the
+    // early stopping.
+    double confidence() const
+    {
+        if ( m_verdict == RESOLVED && m_llr >= m_upper ) {
+
+            return std::max( 0.0, 1.0 - exp( -m_llr ) );
+        }
+        if ( m_verdict == UNRESOLVED && m_llr <= m_lower ) {
+
+            return std::max( 0.0, 1.0 - exp( m_llr ) );
+        }
+        return std::numeric_limits< double >::quiet_NaN();
+    }
+
+    // the lower of the confidences, skipping NaN. NaN if both are.
+    static double lowest( const double a, const double b )
+    {
+        if ( std::isnan( a ) ) {
+            return b;
+        }
+        if ( std::isnan( b ) ) {
+            return a;
+        }
+        return std::min( a, b );
+    }
+
+  private:
+
+    bool       m_enabled;
+    int        m_max_samples;
+    double     m_log_pass;
+    double     m_log_fail;
+    double     m_upper;
+    double     m_lower;
+    int        m_min_samples;
+
+    double     m_llr;
+    int        m_num_samples;
+    int        m_num_failures;
+    Verdict    m_verdict;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_SEQUENTIAL_TEST_HPP__*/
@@ -0,0 +1,155 @@
+#ifndef __DEPTH_TEST_STACK_SEARCH_HPP__
+#define __DEPTH_TEST_STACK_SEARCH_HPP__
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "log_bisection_search.hpp"
+
+namespace DepthTest {
+
+// LogBisectionSearch that probes num_gaps gaps per round with one stack of
+// planes per perturbed sample, instead of one gap per pair of planes.
+//
+// The gaps of a round split [lower bound, upper bound] evenly in the log,
+// and include the bounds not checked yet. Each side of the sample point is a
+// stack of the planes at half of each gap from it, and the sample point
+// itself. Drawn from the widest gap inwards, the winner is the first plane
+// with the code of the sample point, so all the gaps from its gap down are
+// not resolved on that side, and the ones above are. A round then shrinks
+// the bracket by num_gaps + 1 times in the log instead of 2.
+//
+// nextGap() and report() still probe one gap per round as LogBisectionSearch.
+class StackSearch : public LogBisectionSearch {
+
+  public:
+
+    static constexpr int DEFAULT_NUM_GAPS = 7;
+
+    StackSearch(
+        const float near,
+        const float far,
+        const float sample_point,
+        const int   num_gaps = DEFAULT_NUM_GAPS
+    ) noexcept
+        :LogBisectionSearch{ near, far, sample_point }
+        ,m_num_gaps        { std::max( 2, num_gaps ) }
+    {
+        updateGaps();
+    }
+
+    void seed( const float gap ) override
+    {
+        LogBisectionSearch::seed( gap );
+        updateGaps();
+    }
+
+    void report( const bool resolved ) override
+    {
+        LogBisectionSearch::report( resolved );
+        updateGaps();
+    }
+
+    void restore( const State& state ) override
+    {
+        LogBisectionSearch::restore( state );
+        updateGaps();
+    }
+
+    // the gaps of the next round in the ascending order.
+    const std::vector< float >& nextGaps() const
+    {
+        return m_gaps;
+    }
+
+    // the index in nextGaps() of the smallest gap resolved, or
+    // nextGaps().size() if none is.
+    void reportStack( const int first_resolved )
+    {
+        const int num_gaps = static_cast<int>( m_gaps.size() );
+
+        m_num_probes += num_gaps;
+        m_num_rounds++;
+
+        if ( first_resolved >= num_gaps ) {
+
+            if ( !m_hi_checked ) {
+
+                if ( m_hi >= 0.5f * gapLimit() ) {
+
+                    m_hi       = m_far; // nothing resolves within the limit.
+                    m_finished = true;
+                    return;
+                }
+
+                // the seed is too small. bisect above it.
+                m_lo         = m_hi;
+                m_lo_checked = true;
+                m_hi         = 0.5f * gapLimit();
+            }
+            else {
+                m_lo         = m_gaps.back();
+                m_lo_checked = true;
+            }
+        }
+        else if ( first_resolved == 0 && !m_lo_checked ) {
+
+            // the seed is too large. bisect below it.
+            m_hi         = m_lo;
+            m_hi_checked = true;
+            m_lo         = MINIMUM_GAP;
+            m_lo_checked = true;
+        }
+        else {
+            m_hi         = m_gaps[ first_resolved ];
+            m_hi_checked = true;
+
+            if ( first_resolved > 0 ) {
+
+                m_lo         = m_gaps[ first_resolved - 1 ];
+                m_lo_checked = true;
+            }
+        }
+
+        updateFinished();
+        updateGaps();
+    }
+
+  private:
+
+    void updateGaps()
+    {
+        m_gaps.clear();
+
+        if ( m_finished ) {
+            return;
+        }
+
+        // the divisions of [ lo, hi ] in the log. the checked bounds are not probed.
+        const int first     = m_lo_checked ? 1 : 0;
+        const int divisions = m_num_gaps - 1 + first + ( m_hi_checked ? 1 : 0 );
+
+        const double log_lo = log( static_cast<double>( m_lo ) );
+        const double log_hi = log( static_cast<double>( m_hi ) );
+
+        for ( int i = first; i < first + m_num_gaps; i++ ) {
+
+            const float gap = ( i == 0 )         ? m_lo
+                            : ( i == divisions ) ? m_hi
+                            : static_cast<float>( exp( log_lo + ( log_hi - log_lo ) * i / divisions ) );
+
+            // the gaps closer than a float are probed once.
+            if ( m_gaps.empty() || m_gaps.back() < gap ) {
+                m_gaps.push_back( gap );
+            }
+        }
+    }
+
+    const int            m_num_gaps;
+    std::vector< float > m_gaps;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_STACK_SEARCH_HPP__*/
@@ -0,0 +1,147 @@
+#ifndef __DEPTH_TEST_ULP_WALK_SEARCH_HPP__
+#define __DEPTH_TEST_ULP_WALK_SEARCH_HPP__
+
+#include <cstdint>
+#include <algorithm>
+
+#include "search_strategy.hpp"
+
+namespace DepthTest {
+
+// Walks the planes over the floats around the sample point instead of the
+// gap values. The planes of step k are the k-th floats below and above the
+// sample point, and the gap is the distance between them.
+//
+// k is doubled from 1, or from the seed, until the planes resolve, and then
+// bisected in the integers. The result is the gap of the smallest k that
+// resolves, which is exact up to the rounding of the planes by BatchTester.
+// It takes about 2 log2( k ) probes, or log2( k ) from a close seed.
+class UlpWalkSearch : public SearchStrategy {
+
+  public:
+
+    UlpWalkSearch( const float near, const float far, const float sample_point ) noexcept
+        :SearchStrategy{ near, far, sample_point }
+        ,m_k_lo        { 0 }
+        ,m_k_hi        { 0 }
+        ,m_k_max       { 0 }
+        ,m_k_start     { 1 }
+    {
+        if ( !isSamplePointInRange() || sample_point <= 0.0f ) {
+            return;
+        }
+
+        // the planes must stay within the gap limit around the sample point.
+        const auto half_limit = 0.5f * gapLimit();
+        const auto bits       = toBits( sample_point );
+        const auto bits_near  = toBits( std::max( sample_point - half_limit, 0.0f ) );
+        const auto bits_far   = toBits( sample_point + half_limit );
+
+        const auto k_max = std::min( bits - bits_near, bits_far - bits );
+
+        m_k_max    = ( k_max > 1 ) ? k_max - 1 : 0;
+        m_finished = ( m_k_max == 0 );
+    }
+
+    // the first k is the one of the planes at the seed gap.
+    void seed( const float gap ) override
+    {
+        if ( m_finished || !( gap > 0.0f ) ) {
+            return;
+        }
+
+        const auto bits = toBits( m_sample_point );
+        const auto k    = toBits( m_sample_point + 0.5f * gap ) - bits;
+
+        m_k_start = std::max( 1u, std::min( k, m_k_max ) );
+    }
+
+    float nextGap() const override
+    {
+        return gapOf( nextK() );
+    }
+
+    void report( const bool resolved ) override
+    {
+        const auto k = nextK();
+
+        m_num_probes++;
+        m_num_rounds++;
+
+        if ( resolved ) {
+            m_k_hi = k;
+        }
+        else {
+            m_k_lo = k;
+        }
+
+        updateFinished();
+    }
+
+    float result() const override
+    {
+        if ( m_k_hi == 0 ) {
+            return m_far;
+        }
+        return gapOf( m_k_hi );
+    }
+
+    bool atRoundStart() const override
+    {
+        return true;
+    }
+
+    // m_a: the largest k not resolved, m_b: the smallest k resolved, 0 if none.
+    State state() const override
+    {
+        return { static_cast<double>( m_k_lo ), static_cast<double>( m_k_hi ), 0, 0, m_num_probes, m_num_rounds };
+    }
+
+    void restore( const State& state ) override
+    {
+        m_k_lo       = static_cast<uint32_t>( state.m_a );
+        m_k_hi       = static_cast<uint32_t>( state.m_b );
+        m_num_probes = state.m_num_probes;
+        m_num_rounds = state.m_num_rounds;
+        updateFinished();
+    }
+
+  private:
+
+    uint32_t nextK() const
+    {
+        if ( m_k_hi == 0 ) {
+
+            // doubling.
+            return std::min( m_k_lo == 0 ? m_k_start : 2u * m_k_lo, m_k_max );
+        }
+        return m_k_lo + ( m_k_hi - m_k_lo ) / 2;
+    }
+
+    float gapOf( const uint32_t k ) const
+    {
+        const auto bits = toBits( m_sample_point );
+
+        return fromBits( bits + k ) - fromBits( bits - k );
+    }
+
+    void updateFinished()
+    {
+        if ( m_k_hi == 0 ) {
+
+            m_finished = ( m_k_lo >= m_k_max ); // nothing resolves within the limit.
+        }
+        else {
+            m_finished = ( m_k_hi - m_k_lo <= 1 );
+        }
+    }
+
+    uint32_t m_k_lo;
+    uint32_t m_k_hi;
+    uint32_t m_k_max;
+    uint32_t m_k_start;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_ULP_WALK_SEARCH_HPP__*/
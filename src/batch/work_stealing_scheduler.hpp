@@ -0,0 +1,199 @@
+#ifndef __DEPTH_TEST_WORK_STEALING_SCHEDULER_HPP__
+#define __DEPTH_TEST_WORK_STEALING_SCHEDULER_HPP__
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <exception>
+
+namespace DepthTest {
+
+// Runs the items [0, num_items) on a pool of workers.
+//
+// Each worker starts with a contiguous block of the items in its own deque
+// and takes them from the front. A worker that runs out steals from the back
+// of the deque of the worker with the most items left, so the slow items,
+// e.g. the sample points whose search takes more iterations, do not leave
+// the other workers idle.
+//
+// begin_worker() and end_worker() are called on the worker thread before the
+// first and after the last item, e.g. to make an OpenGL context current.
+// run_item() may take further items with nextItem() to work on several at
+// once, e.g. to keep the asynchronous tests of many items in flight.
+// With one worker everything runs on the calling thread.
+// The first exception thrown by a worker is rethrown after all are joined.
+class WorkStealingScheduler {
+
+  public:
+
+    typedef std::function< void( const int worker ) >                 WorkerFunc;
+    typedef std::function< void( const int worker, const int item ) > ItemFunc;
+
+    explicit WorkStealingScheduler( const int num_workers ) noexcept
+        :m_num_workers{ std::max( 1, num_workers ) }
+    {
+    }
+
+    int numWorkers() const
+    {
+        return m_num_workers;
+    }
+
+    void run(
+        const int         num_items,
+        const WorkerFunc& begin_worker,
+        const ItemFunc&   run_item,
+        const WorkerFunc& end_worker
+    ) {
+        m_queues = std::vector< Queue >( m_num_workers );
+
+        for ( int i = 0; i < num_items; i++ ) {
+
+            m_queues[ static_cast<long long>(i) * m_num_workers / std::max( 1, num_items ) ].m_items.push_back( i );
+        }
+
+        m_exception = nullptr;
+
+        if ( m_num_workers == 1 ) {
+
+            runWorker( 0, begin_worker, run_item, end_worker );
+        }
+        else {
+            std::vector< std::thread > threads;
+
+            for ( int w = 0; w < m_num_workers; w++ ) {
+
+                threads.emplace_back(
+                    [ this, w, &begin_worker, &run_item, &end_worker ] {
+                        runWorker( w, begin_worker, run_item, end_worker );
+                    }
+                );
+            }
+
+            for ( auto& t : threads ) {
+                t.join();
+            }
+        }
+
+        if ( m_exception ) {
+            std::rethrow_exception( m_exception );
+        }
+    }
+
+    // takes the next item for the worker, stealing one if its own are done.
+    // returns false if no item is left.
+    bool nextItem( const int worker, int& item )
+    {
+        return popOwn( worker, item ) || steal( worker, item );
+    }
+
+  private:
+
+    struct Queue {
+        std::mutex      m_mutex;
+        std::deque<int> m_items;
+    };
+
+    void runWorker(
+        const int         worker,
+        const WorkerFunc& begin_worker,
+        const ItemFunc&   run_item,
+        const WorkerFunc& end_worker
+    ) {
+        try {
+            begin_worker( worker );
+
+            int item;
+
+            while ( nextItem( worker, item ) ) {
+
+                run_item( worker, item );
+            }
+
+            end_worker( worker );
+        }
+        catch ( ... ) {
+
+            std::lock_guard< std::mutex > lock( m_exception_mutex );
+
+            if ( !m_exception ) {
+                m_exception = std::current_exception();
+            }
+
+            // let the other workers drain.
+            for ( auto& q : m_queues ) {
+
+                std::lock_guard< std::mutex > queue_lock( q.m_mutex );
+                q.m_items.clear();
+            }
+        }
+    }
+
+    bool popOwn( const int worker, int& item )
+    {
+        auto& q = m_queues[ worker ];
+
+        std::lock_guard< std::mutex > lock( q.m_mutex );
+
+        if ( q.m_items.empty() ) {
+            return false;
+        }
+
+        item = q.m_items.front();
+        q.m_items.pop_front();
+        return true;
+    }
+
+    bool steal( const int worker, int& item )
+    {
+        while ( true ) {
+
+            int    victim   = -1;
+            size_t max_size = 0;
+
+            for ( int w = 0; w < m_num_workers; w++ ) {
+
+                if ( w == worker ) {
+                    continue;
+                }
+
+                std::lock_guard< std::mutex > lock( m_queues[w].m_mutex );
+
+                if ( m_queues[w].m_items.size() > max_size ) {
+
+                    max_size = m_queues[w].m_items.size();
+                    victim   = w;
+                }
+            }
+
+            if ( victim == -1 ) {
+                return false;
+            }
+
+            auto& q = m_queues[ victim ];
+
+            std::lock_guard< std::mutex > lock( q.m_mutex );
+
+            if ( !q.m_items.empty() ) {
+
+                item = q.m_items.back();
+                q.m_items.pop_back();
+                return true;
+            }
+            // emptied meanwhile. look again.
+        }
+    }
+
+    const int            m_num_workers;
+    std::vector< Queue > m_queues;
+
+    std::mutex           m_exception_mutex;
+    std::exception_ptr   m_exception;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_WORK_STEALING_SCHEDULER_HPP__*/
@@ -2,7 +2,29 @@
 #define __DEPTH_TEST_BATCH_TESTER_HPP__
 
 #include <vector>
+#include <memory>
 #include <cmath>
+#include <limits>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <iostream>
+#include <stdexcept>
+
+#include "depth_tester.hpp"
+#include "work_stealing_scheduler.hpp"
+#include "search_strategy.hpp"
+#include "grid_search.hpp"
+#include "log_bisection_search.hpp"
+#include "bracketing_search.hpp"
+#include "ulp_walk_search.hpp"
+#include "stack_search.hpp"
+#include "depth_code_search.hpp"
+#include "sequential_test.hpp"
+#include "perturbation_sequence.hpp"
+#include "result_writer.hpp"
+#include "checkpoint.hpp"
+#include "analytic_depth_model.hpp"
 
 namespace DepthTest {
 
@@ -10,236 +32,1222 @@ class BatchTester {
 
 public:
 
-    static constexpr float MINIMUM_GAP = 1.0e-20; // real limit around 1.0E-37
-    static constexpr float MAXIMUM_GAP = 1.0e30;  // real limit around 1.0E+37
-
+    typedef enum _SearchMode {
+        GRID_SEARCH,          // pairs of planes, GridSearch per sample point
+        DEPTH_CODE_SEARCH,    // depth buffer codes, DepthCodeSearch
+        LOG_BISECTION_SEARCH, // pairs of planes, LogBisectionSearch
+        BRACKETING_SEARCH,    // pairs of planes, BracketingSearch
+        ULP_WALK_SEARCH,      // pairs of planes, UlpWalkSearch
+        STACK_SEARCH          // stacks of planes, StackSearch
+    } SearchMode;
+
+    static constexpr float MINIMUM_GAP = SearchStrategy::MINIMUM_GAP;
+    static constexpr float MAXIMUM_GAP = SearchStrategy::MAXIMUM_GAP;
+
+    // each sample point is tested with its own random sequence from the seed
+    // and its index, so the results do not depend on the number of workers
+    // or the scheduling.
+    static constexpr unsigned int DEFAULT_SEED = std::default_random_engine::default_seed;
+
+    // seconds between the saved states of a grid search in the checkpoint.
+    static constexpr double CHECKPOINT_INTERVAL = 10.0;
+
+    // the adaptive sampling starts from this many intervals of the sample points.
+    static constexpr int    ADAPTIVE_INITIAL_INTERVALS = 16;
+    static constexpr double DEFAULT_REFINE_TOLERANCE   = 0.05;
+
+    // the near plane and the planes of StackSearch::DEFAULT_NUM_GAPS gaps.
+    static constexpr int    DEFAULT_STACK_PLANES = StackSearch::DEFAULT_NUM_GAPS + 1;
+
+    // testers: one per worker thread.
+    // pipeline_depth: number of sample points each worker keeps in flight
+    //                 with the asynchronous tests. 1 for the synchronous test.
+    // search_mode:    DEPTH_CODE_SEARCH splits the sample points into one
+    //                 block per worker, and ignores pipeline_depth and
+    //                 num_perturbed_samples. STACK_SEARCH ignores
+    //                 pipeline_depth and the early stopping.
     explicit BatchTester(
 
-        const SquareRenderer::DepthTestType depth_test_type,
+        const std::vector< DepthTester* >& testers,
+        const DepthTester::DepthTestType   depth_test_type,
         const float near,
         const float far,
         const float param_c,
         const int   num_sample_points,
-        const int   num_perturbed_samples
+        const int   num_perturbed_samples,
+        const int   pipeline_depth = 1,
+        const SearchMode search_mode = GRID_SEARCH
     ) noexcept
-        :m_tester               { depth_test_type }
-        ,m_rand_gen             { }
+        :m_workers              ( testers.size() )
+        ,m_scheduler            { static_cast<int>( testers.size() ) }
         ,m_depth_test_type      { depth_test_type }
         ,m_near                 { near }
         ,m_far                  { far }
         ,m_param_c              { param_c }
         ,m_num_samples          { num_sample_points }
         ,m_num_perturbed_samples{ num_perturbed_samples }
+        ,m_pipeline_depth       { std::max( 1, pipeline_depth ) }
+        ,m_search_mode          { search_mode }
+        ,m_next_to_print        { 0 }
+        ,m_os                   { &std::cerr }
+        ,m_result_writer        { nullptr }
+        ,m_checkpoint           { nullptr }
+        ,m_model                { nullptr }
+        ,m_early_stop_confidence{ 0.0 }
+        ,m_perturbation         { PerturbationSequence::RANDOM }
+        ,m_seed                 { DEFAULT_SEED }
+        ,m_refine_tolerance     { 0.0 }
+        ,m_stack_planes         { DEFAULT_STACK_PLANES }
+        ,m_depth_format         { DepthTester::DEPTH_D24 }
+        ,m_clip_convention      { DepthTester::CLIP_STANDARD }
+    {
+        for ( size_t i = 0; i < testers.size(); i++ ) {
+
+            m_workers[i].m_tester = testers[i];
+        }
+    }
+
+    // the records are also written to writer in the order of the sample
+    // points as they complete.
+    void setResultWriter( ResultWriter* writer )
+    {
+        m_result_writer = writer;
+    }
+
+    // the completed sample points and the grid searches are saved to
+    // checkpoint as the run goes. The sample points completed in the loaded
+    // checkpoint are not searched again, and the incomplete ones continue
+    // from their saved states, with the same results as an uninterrupted run.
+    void setCheckpoint( Checkpoint* checkpoint )
+    {
+        m_checkpoint = checkpoint;
+    }
+
+    // the searches of the pairs of planes start from the minimum gap of
+    // model at each sample point instead of a fixed fraction of the range.
+    void setAnalyticModel( const AnalyticDepthModel* model )
+    {
+        m_model = model;
+    }
+
+    // each probe renders its perturbed samples in batches and stops as soon
+    // as SequentialTest settles the verdict at confidence, instead of
+    // rendering all num_perturbed_samples of them. 0 to always render all.
+    void setEarlyStopping( const double confidence )
+    {
+        m_early_stop_confidence = confidence;
+    }
+
+    // the perturbations of the perturbed samples, and the seed of the
+    // random sequences of the sample points.
+    void setPerturbation( const PerturbationSequence::Kind kind, const unsigned int seed = DEFAULT_SEED )
+    {
+        m_perturbation = kind;
+        m_seed         = seed;
+    }
+
+    // searches only a subset of the sample points. It starts from
+    // ADAPTIVE_INITIAL_INTERVALS intervals, and bisects an interval while the
+    // minimum gap at its middle sample point deviates from the interpolation
+    // of its ends on the log-log plot by more than tolerance, relatively.
+    // The sample points are the same as without it, but the ones in the
+    // intervals that are straight enough are skipped.
+    // 0 to search all of them.
+    void setAdaptiveSampling( const double tolerance )
+    {
+        m_refine_tolerance = tolerance;
+    }
+
+    // the planes per stack of STACK_SEARCH, i.e. the gaps probed per
+    // round plus one. at least 3.
+    void setStackPlanes( const int num_planes )
     {
+        m_stack_planes = std::max( 3, num_planes );
+    }
+
+    // the depth buffer of the testers, for the parameters printed.
+    // the testers are made with them. The reversed clip conventions are
+    // not for DEPTH_CODE_SEARCH and STACK_SEARCH.
+    void setDepthBuffer(
+        const DepthTester::DepthFormat    depth_format,
+        const DepthTester::ClipConvention clip_convention
+    ) {
+        m_depth_format    = depth_format;
+        m_clip_convention = clip_convention;
     }
 
     void run()
     {
-        switch ( m_depth_test_type ) {
-          case SquareRenderer::PERSPECTIVE:
-            std::cerr << "Testing Perspective (normal) Depth.\n";
-            break;
-          case SquareRenderer::LOG_DEPTH_FN:
-            std::cerr << "Testing Log Depth ((log(-z)-log(n)) / (log(f)-log(n)) type).\n";
-            break;
-          case SquareRenderer::LOG_DEPTH_CF:
-            std::cerr << "Testing Log Depth (log(-cz+1)/ log(cf+1) type).\n";
-            break;
+        run( std::cerr );
+    }
 
-          default:
-            throw std::runtime_error( "unknown depth type" );
+    // the parameters and the results are printed to os.
+    void run( std::ostream& os )
+    {
+        m_os = &os;
+
+        if (    m_clip_convention != DepthTester::CLIP_STANDARD
+             && ( m_search_mode == DEPTH_CODE_SEARCH || m_search_mode == STACK_SEARCH ) ) {
+
+            throw std::runtime_error( "the search needs the standard clip convention" );
         }
 
-        std::cerr << "Parameters: " << m_near << "\n";
-        std::cerr << "    near: " << m_near << "\n";
-        std::cerr << "    far: " << m_far   << "\n";
-        std::cerr << "    param C: " << m_param_c  << "\n";
-        std::cerr << "    test points: " << m_num_samples << "\n";
-        std::cerr << "    num_perturbed_samples: " << m_num_perturbed_samples << "\n";
+        printParameters(
+            os,
+            m_depth_test_type,
+            m_near,
+            m_far,
+            m_param_c,
+            m_depth_format,
+            m_clip_convention,
+            m_num_samples,
+            m_num_perturbed_samples,
+            m_scheduler.numWorkers()
+        );
+        os << "    pipeline depth: " << m_pipeline_depth << "\n";
+        os << "    search: " << searchModeName( m_search_mode ) << "\n";
+        if ( m_search_mode == STACK_SEARCH ) {
+            os << "    stack planes: " << m_stack_planes << "\n";
+        }
+        os << "    initial gap: " << ( m_model != nullptr ? "analytic model" : "blind" ) << "\n";
+        os << "    early stop: ";
+        if ( m_early_stop_confidence > 0.0 ) {
+            os << "confidence " << m_early_stop_confidence << "\n";
+        }
+        else {
+            os << "off\n";
+        }
+        os << "    perturbation: " << PerturbationSequence::kindName( m_perturbation ) << "\n";
+        os << "    seed: " << m_seed << "\n";
+        os << "    sampling: ";
+        if ( m_refine_tolerance > 0.0 ) {
+            os << "adaptive, tolerance " << m_refine_tolerance << "\n";
+        }
+        else {
+            os << "uniform\n";
+        }
+
+        for ( auto& worker : m_workers ) {
 
-        generateSamplePoints();
-        int index{0};
-        for ( const auto& sample_point: m_sample_points ) {
+            worker.m_sequential         = makeSequentialTest();
+            worker.m_perturbation       = PerturbationSequence{ m_perturbation, m_seed };
+            worker.m_num_probes_tested  = 0;
+            worker.m_num_samples_tested = 0;
+        }
 
-            std::cerr << "sample point [" << index << "]:\t" << sample_point << "\t";
+        m_sample_points = samplePoints( m_near, m_far, m_num_samples );
 
-            const auto result = testOneSamplePoint( sample_point );
+        m_results.assign( m_sample_points.size(), 0.0f );
+        m_records.assign( m_sample_points.size(), ResultWriter::Record{} );
+        m_completed.assign( m_sample_points.size(), false );
+        m_skipped.assign( m_sample_points.size(), false );
+        m_next_to_print = 0;
 
-            std::cerr << result << "\n";
+        if ( m_checkpoint != nullptr ) {
 
-            m_results.push_back( result );
+            os << "    resumed: " << m_checkpoint->completedRecords().size() << " sample points\n";
 
-            index++;
+            for ( const auto& record : m_checkpoint->completedRecords() ) {
+
+                if ( record.m_index < m_sample_points.size() ) {
+                    complete( record, false );
+                }
+            }
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+
+        if ( m_refine_tolerance > 0.0 ) {
+
+            runAdaptiveSampling();
         }
+        else {
+            std::vector< int > indices;
+
+            for ( int i = 0; i < static_cast<int>( m_sample_points.size() ); i++ ) {
+                indices.push_back( i );
+            }
+            searchSamplePoints( indices );
+        }
+
+        const std::chrono::duration< double > elapsed = std::chrono::steady_clock::now() - start;
+
+        printSummary( os, elapsed.count() );
     }    
 
-private:
+    // searches sample_point alone with the search of the pairs of planes on
+    // the first tester, on the calling thread, without the checkpoint, the
+    // writer or the printing. for the benchmarks. the index of the record is 0.
+    ResultWriter::Record testOneSamplePoint( const float sample_point )
+    {
+        auto& w = m_workers.front();
+
+        w.m_sequential   = makeSequentialTest();
+        w.m_perturbation = PerturbationSequence{ m_perturbation, m_seed };
+        w.m_rand_gen.seed( m_seed );
+
+        auto   search     = makeSearch( sample_point );
+        double confidence = std::numeric_limits< double >::quiet_NaN();
+
+        const auto start = std::chrono::steady_clock::now();
+
+        w.m_tester->attachThread();
+
+        while ( !search->finished() ) {
+
+            search->report( testOneGap( w, 0, search->numProbes(), search->samplePoint(), search->nextGap() ) );
+
+            confidence = SequentialTest::lowest( confidence, w.m_sequential.confidence() );
+        }
+
+        w.m_tester->detachThread();
+
+        const std::chrono::duration< double > elapsed = std::chrono::steady_clock::now() - start;
 
-    void generateSamplePoints()
+        return {
+            0,
+            sample_point,
+            search->result(),
+            static_cast< uint32_t >( search->numRounds() ),
+            static_cast< uint32_t >( search->numProbes() ),
+            elapsed.count(),
+            static_cast< float >( confidence )
+        };
+    }
+
+    // the sample points at the equal intervals of log(z) in (near, far).
+    // shared with LayeredBatchTester.
+    static std::vector< float > samplePoints( const float near, const float far, const int num_samples )
     {
-        const float log_near = log( m_near );
-        const float log_far  = log( m_far  );
+        const float log_near = log( near );
+        const float log_far  = log( far  );
         const float log_diff = log_far - log_near;
 
-        const float num_samples_f = static_cast<float>( m_num_samples );
+        const float num_samples_f = static_cast<float>( num_samples );
+
+        std::vector< float > sample_points;
 
-        for ( int i = 1; i < m_num_samples; i++ ) {
+        for ( int i = 1; i < num_samples; i++ ) {
 
             const auto alpha = static_cast<float>(i) / num_samples_f;
             const auto log_point = log_near + alpha * log_diff;
 
             const auto point = exp( log_point );
 
-            m_sample_points.push_back( point );
+            sample_points.push_back( point );
         }
+
+        return sample_points;
     }
 
-    float testOneSamplePoint( const float sample_point )
+    // the results of the i-th perturbed sample are at 2i with plane_1 drawn
+    // first and at 2i+1 with plane_2 first. plane_1 (nearer) must win in both orders.
+    static bool isSampleResolved( const DepthTester::TestResult* results, const int i )
     {
-        if ( sample_point < m_near || m_far < sample_point ) {
-            return m_far;
+        const auto& result_1_first = results[ 2 * i ];
+        const auto& result_2_first = results[ 2 * i + 1 ];
+
+        return    result_1_first.m_plane_1_detected && !result_1_first.m_plane_2_detected
+               && result_2_first.m_plane_2_detected && !result_2_first.m_plane_1_detected;
+    }
+
+    // the head of the results up to the workers. the testers print the
+    // parameters of their searches after it.
+    static void printParameters(
+        std::ostream&                     os,
+        const DepthTester::DepthTestType  depth_test_type,
+        const float                       near,
+        const float                       far,
+        const float                       param_c,
+        const DepthTester::DepthFormat    depth_format,
+        const DepthTester::ClipConvention clip_convention,
+        const int                         num_samples,
+        const int                         num_perturbed_samples,
+        const int                         num_workers
+    ) {
+        switch ( depth_test_type ) {
+          case DepthTester::PERSPECTIVE:
+            os << "Testing Perspective (normal) Depth.\n";
+            break;
+          case DepthTester::LOG_DEPTH_FN:
+            os << "Testing Log Depth ((log(-z)-log(n)) / (log(f)-log(n)) type).\n";
+            break;
+          case DepthTester::LOG_DEPTH_CF:
+            os << "Testing Log Depth (log(-cz+1)/ log(cf+1) type).\n";
+            break;
+
+          default:
+            throw std::runtime_error( "unknown depth type" );
         }
-        const auto min_gap = std::min( sample_point - m_near, m_far - sample_point );
 
-        auto base_gap = min_gap * 0.1f;
+        os << "Parameters: " << near << "\n";
+        os << "    near: " << near << "\n";
+        os << "    far: " << far   << "\n";
+        os << "    param C: " << param_c  << "\n";
+        os << "    depth format: " << DepthTester::depthFormatName( depth_format ) << "\n";
+        os << "    clip convention: " << DepthTester::clipConventionName( clip_convention ) << "\n";
+        os << "    test points: " << num_samples << "\n";
+        os << "    num_perturbed_samples: " << num_perturbed_samples << "\n";
+        os << "    workers: " << num_workers << "\n";
+    }
 
-        auto range = base_gap;
+private:
 
-        while( isBaseGapAndRangeOK( base_gap, range, sample_point ) ) {
+    // per worker thread.
+    struct Worker {
+        DepthTester*                           m_tester;
+        std::default_random_engine             m_rand_gen;
+        std::vector< DepthTester::TestCase >   m_test_cases;
+        std::vector< DepthTester::TestResult > m_test_results;
+        std::vector< float >                   m_stack_planes;
+        std::vector< int >                     m_stack_winners;
+        SequentialTest                         m_sequential;
+        PerturbationSequence                   m_perturbation;
+        uint64_t                               m_num_probes_tested;
+        uint64_t                               m_num_samples_tested;
+    };
+
+    // a sample point in flight in the pipelined test.
+    struct SearchSlot {
+
+        SearchSlot() noexcept
+            :m_index     { -1 }
+            ,m_confidence{ std::numeric_limits< double >::quiet_NaN() }
+            ,m_in_flight { false }
+        {
+        }
 
-            for ( int i = 0; i < 4; i++ ) {
+        int                        m_index; // -1 if not in use.
+        std::unique_ptr< SearchStrategy >
+                                   m_search;
+        std::chrono::steady_clock::time_point
+                                   m_start;
+        std::chrono::steady_clock::time_point
+                                   m_last_saved;
+        std::default_random_engine m_rand_gen;
+        SequentialTest             m_sequential; // of the probe in flight.
+        PerturbationSequence       m_perturbation;
+        double                     m_confidence;
+        bool                       m_in_flight;
+    };
+
+    void complete(
+        const int                                    index,
+        const SearchStrategy&                        search,
+        const std::chrono::steady_clock::time_point& start,
+        const double                                 confidence
+    ) {
+        const std::chrono::duration< double > elapsed = std::chrono::steady_clock::now() - start;
+
+        complete( {
+            static_cast< uint32_t >( index ),
+            m_sample_points[ index ],
+            search.result(),
+            static_cast< uint32_t >( search.numRounds() ),
+            static_cast< uint32_t >( search.numProbes() ),
+            elapsed.count(),
+            static_cast< float >( confidence )
+        } );
+    }
 
-                const auto current_gap = base_gap - static_cast<float>(i) / 4.0f * range;
+    // stores the result and prints the results completed so far in order.
+    // save: false for the records loaded from the checkpoint.
+    void complete( const ResultWriter::Record& record, const bool save = true )
+    {
+        std::lock_guard< std::mutex > lock( m_results_mutex );
 
-                const auto result = testOneGap( sample_point, current_gap );
+        if ( save && m_checkpoint != nullptr ) {
+            m_checkpoint->saveRecord( record );
+        }
 
-                if ( result == false ) {
+        m_results  [ record.m_index ] = record.m_min_gap;
+        m_records  [ record.m_index ] = record;
+        m_completed[ record.m_index ] = true;
 
-                    if ( i == 0 )  {
+        printCompleted();
+    }
 
-                        base_gap += range;
-                        range = 2.0f * range; // widen the search
-                    }
-                    else if ( i == 1 ) {
+    // the sample points in [ begin, end ) that are not searched are not
+    // waited for by the printing.
+    void skip( const int begin, const int end )
+    {
+        std::lock_guard< std::mutex > lock( m_results_mutex );
 
-                        range = 0.5f * range; // narrow the search
-                    }
-                    else if ( i == 2 ) {
-
-                        base_gap -= ( 0.25f * range );
-                        range = 0.5f * range; // narrow the search
-                    }            
-                    else{ // i == 3
-                        base_gap -= ( 0.5f * range );
-                        range = 0.5f * range; // narrow the search
-                    }
-                    break;
-                }
-                else if ( i == 3 ) { // true until i = 3
-                    base_gap -= ( 0.5f * range );
-                    range = 0.5f * range; // narrow the search
+        for ( int i = begin; i < end; i++ ) {
+
+            m_skipped[i] = !m_completed[i];
+        }
+
+        printCompleted();
+    }
+
+    // m_results_mutex must be held.
+    void printCompleted()
+    {
+        while (    m_next_to_print < static_cast<int>( m_sample_points.size() )
+                && ( m_completed[ m_next_to_print ] || m_skipped[ m_next_to_print ] ) ) {
+
+            if ( m_completed[ m_next_to_print ] ) {
+
+                *m_os << "sample point [" << m_next_to_print << "]:\t"
+                          << m_sample_points[ m_next_to_print ] << "\t"
+                          << m_results[ m_next_to_print ] << "\n";
+
+                if ( m_result_writer != nullptr ) {
+                    m_result_writer->write( m_records[ m_next_to_print ] );
                 }
             }
+
+            m_next_to_print++;
+        }
+    }
+
+    std::unique_ptr< SearchStrategy > makeSearch( const float sample_point ) const
+    {
+        std::unique_ptr< SearchStrategy > search;
+
+        switch ( m_search_mode ) {
+
+          case LOG_BISECTION_SEARCH:
+            search = std::make_unique< LogBisectionSearch >( m_near, m_far, sample_point );
+            break;
+
+          case BRACKETING_SEARCH:
+            search = std::make_unique< BracketingSearch >( m_near, m_far, sample_point );
+            break;
+
+          case ULP_WALK_SEARCH:
+            search = std::make_unique< UlpWalkSearch >( m_near, m_far, sample_point );
+            break;
+
+          case STACK_SEARCH:
+            search = std::make_unique< StackSearch >( m_near, m_far, sample_point, m_stack_planes - 1 );
+            break;
+
+          default:
+            search = std::make_unique< GridSearch >( m_near, m_far, sample_point );
+            break;
+        }
+
+        if ( m_model != nullptr ) {
+
+            search->seed( static_cast<float>( m_model->minGap( -1.0 * sample_point ) ) );
         }
 
-        return base_gap;
+        return search;
     }
 
-    bool isBaseGapAndRangeOK(
+    static const char* searchModeName( const SearchMode search_mode )
+    {
+        switch ( search_mode ) {
+
+          case DEPTH_CODE_SEARCH:
+            return "depth codes";
+
+          case LOG_BISECTION_SEARCH:
+            return "log bisection";
 
-        const float base_gap, 
-        const float range, 
-        const float sample_point
+          case BRACKETING_SEARCH:
+            return "bracketing";
 
+          case ULP_WALK_SEARCH:
+            return "ulp walk";
+
+          case STACK_SEARCH:
+            return "stack";
+
+          default:
+            return "grid";
+        }
+    }
+
+    SequentialTest makeSequentialTest() const
+    {
+        return SequentialTest{ m_early_stop_confidence, m_num_perturbed_samples };
+    }
+
+    // sets up the search of the sample point at index, from the checkpoint
+    // if it has the state. returns the start time, which includes the wall
+    // time before the checkpoint.
+    // confidence: the lowest confidence of the verdicts so far, NaN if none
+    //             was settled by the ratio test.
+    std::chrono::steady_clock::time_point startSearch(
+        const int                   index,
+        std::unique_ptr< SearchStrategy >& search,
+        std::default_random_engine&        rand_gen,
+        double&                            confidence
     ) const {
+        search = makeSearch( m_sample_points[ index ] );
+        rand_gen.seed( m_seed + index );
+
+        double wall_time = 0.0;
 
-        if( range <= MINIMUM_GAP ) {
+        confidence = std::numeric_limits< double >::quiet_NaN();
 
-            return false; // the gap too small in general.
+        if ( m_checkpoint != nullptr ) {
+            m_checkpoint->findSearchState( index, *search, rand_gen, wall_time, confidence );
         }
-        if( base_gap >= MAXIMUM_GAP ) {
 
-            return false; // the gap too big in general.
+        return   std::chrono::steady_clock::now()
+               - std::chrono::duration_cast< std::chrono::steady_clock::duration >(
+                     std::chrono::duration< double >( wall_time ) );
+    }
+
+    // saves the state of a long search at the start of its round, at most
+    // once per CHECKPOINT_INTERVAL.
+    void saveSearchState(
+        const int                                    index,
+        const SearchStrategy&                        search,
+        const std::default_random_engine&            rand_gen,
+        const double                                 confidence,
+        const std::chrono::steady_clock::time_point& start,
+        std::chrono::steady_clock::time_point&       last_saved
+    ) {
+        if ( m_checkpoint == nullptr || search.finished() || !search.atRoundStart() ) {
+            return;
         }
 
-        if ( base_gap >= sample_point * 0.5f ) {
+        const auto now = std::chrono::steady_clock::now();
+
+        if ( now - last_saved < std::chrono::duration< double >( CHECKPOINT_INTERVAL ) ) {
+            return;
+        }
+
+        const std::chrono::duration< double > elapsed = now - start;
+
+        m_checkpoint->saveSearchState( index, search, rand_gen, elapsed.count(), confidence );
+
+        last_saved = now;
+    }
+
+    // searches the sample points of indices that are not completed yet.
+    void searchSamplePoints( const std::vector< int >& indices )
+    {
+        m_pending.clear();
+
+        for ( const auto i : indices ) {
+
+            if ( !m_completed[i] ) {
+                m_pending.push_back( i );
+            }
+        }
 
-            return false; // the gap too big for the sample point.
+        if ( m_pending.empty() ) {
+            return;
         }
 
-        if ( sample_point + base_gap * 0.5f >= m_far ) {
+        if ( m_search_mode == DEPTH_CODE_SEARCH ) {
 
-            return false; // the grid exceeds the far limit.
+            runDepthCodeSearch();
+        }
+        else {
+            runSearches();
         }
+    }
 
-        if ( sample_point - base_gap * 0.5f <= m_near ) {
+    // Searches the ends of the initial intervals, and then the middle sample
+    // points of all the intervals of a level together, so that the workers
+    // are kept busy. An interval is bisected if its middle deviates from the
+    // interpolation, and its sample points are skipped otherwise.
+    void runAdaptiveSampling()
+    {
+        const int last = static_cast<int>( m_sample_points.size() ) - 1;
 
-            return false; // the grid exceeds the near limit.
+        if ( last < 0 ) {
+            return;
         }
 
-        return true;
+        const int num_intervals = std::max( 1, std::min( ADAPTIVE_INITIAL_INTERVALS, last ) );
+
+        std::vector< int > ends;
+
+        for ( int i = 0; i <= num_intervals; i++ ) {
+
+            ends.push_back( static_cast<long long>( i ) * last / num_intervals );
+        }
+
+        searchSamplePoints( ends );
+
+        std::vector< std::pair< int, int > > intervals;
+
+        for ( int i = 0; i < num_intervals; i++ ) {
+
+            intervals.push_back( { ends[i], ends[ i + 1 ] } );
+        }
+
+        while ( !intervals.empty() ) {
+
+            std::vector< int > middles;
+
+            for ( const auto& interval : intervals ) {
+
+                if ( interval.second - interval.first >= 2 ) {
+                    middles.push_back( ( interval.first + interval.second ) / 2 );
+                }
+            }
+
+            searchSamplePoints( middles );
+
+            std::vector< std::pair< int, int > > next_intervals;
+
+            for ( const auto& interval : intervals ) {
+
+                const int a = interval.first;
+                const int b = interval.second;
+                const int m = ( a + b ) / 2;
+
+                if ( b - a >= 2 && deviatesFromInterpolation( a, m, b ) ) {
+
+                    next_intervals.push_back( { a, m } );
+                    next_intervals.push_back( { m, b } );
+                }
+                else {
+                    skip( a + 1, b );
+                }
+            }
+
+            intervals.swap( next_intervals );
+        }
+    }
+
+    // true if the minimum gap at m is off the line between a and b on the
+    // log-log plot by more than m_refine_tolerance, plus the step of the gap
+    // by the float planes, as the gaps of a few ulps are steps rather than a line.
+    bool deviatesFromInterpolation( const int a, const int m, const int b ) const
+    {
+        const float  z_m       = m_sample_points[m];
+        const double gap_step  = 2.0 * static_cast<double>( nextafterf( z_m, m_far ) - z_m );
+        const double tolerance = m_refine_tolerance + gap_step / static_cast<double>( m_results[m] );
+
+        const double x_a = log( static_cast<double>( m_sample_points[a] ) );
+        const double x_m = log( static_cast<double>( m_sample_points[m] ) );
+        const double x_b = log( static_cast<double>( m_sample_points[b] ) );
+
+        const double y_a = log( static_cast<double>( m_results[a] ) );
+        const double y_m = log( static_cast<double>( m_results[m] ) );
+        const double y_b = log( static_cast<double>( m_results[b] ) );
+
+        const double y_interpolated = y_a + ( y_b - y_a ) * ( x_m - x_a ) / ( x_b - x_a );
+
+        return !( fabs( y_m - y_interpolated ) <= log1p( tolerance ) );
+    }
+
+    // the searches of the pairs of planes, one SearchStrategy per sample point.
+    void runSearches()
+    {
+        m_scheduler.run(
+
+            static_cast<int>( m_pending.size() ),
+
+            [ this ]( const int worker ) {
+
+                m_workers[ worker ].m_tester->attachThread();
+            },
+
+            [ this ]( const int worker, const int item ) {
+
+                auto& w = m_workers[ worker ];
+
+                const int index = m_pending[ item ];
+
+                if ( m_search_mode == STACK_SEARCH ) {
+
+                    testSamplePointStacked( w, index );
+                }
+                else if ( m_pipeline_depth > 1 ) {
+
+                    testSamplePointsPipelined( w, worker, index );
+                }
+                else {
+                    std::unique_ptr< SearchStrategy > search;
+                    double                            confidence;
+
+                    const auto start      = startSearch( index, search, w.m_rand_gen, confidence );
+                    auto       last_saved = std::chrono::steady_clock::now();
+
+                    while ( !search->finished() ) {
+
+                        search->report(
+                            testOneGap( w, index, search->numProbes(), search->samplePoint(), search->nextGap() ) );
+
+                        confidence = SequentialTest::lowest( confidence, w.m_sequential.confidence() );
+
+                        saveSearchState( index, *search, w.m_rand_gen, confidence, start, last_saved );
+                    }
+
+                    complete( index, *search, start, confidence );
+                }
+            },
+
+            [ this ]( const int worker ) {
+
+                m_workers[ worker ].m_tester->detachThread();
+            }
+        );
     }
 
-    bool testOneGap( const float sample_point, const float gap )
+    // the probes and the time of the search, to compare the strategies.
+    // the wall times of the sample points are the sums over their searches
+    // and overlap with the other workers and the pipeline.
+    void printSummary( std::ostream& os, const double elapsed ) const
     {
-        std::uniform_real_distribution< float > distribution{ gap / -500.0f, gap / 500.0f };
+        uint64_t total_probes  = 0;
+        uint64_t total_rounds  = 0;
+        uint64_t num_searched  = 0;
+        uint64_t run_probes    = 0;
+        uint64_t run_samples   = 0;
+        double   total_time    = 0.0;
+        double   confidence    = std::numeric_limits< double >::quiet_NaN();
+
+        for ( size_t i = 0; i < m_records.size(); i++ ) {
+
+            if ( !m_completed[i] ) {
+                continue;
+            }
+
+            const auto& record = m_records[i];
+
+            num_searched++;
+            total_probes += record.m_num_probes;
+            total_rounds += record.m_num_iterations;
+            total_time   += record.m_wall_time;
+            confidence    = SequentialTest::lowest( confidence, record.m_confidence );
+        }
+
+        // the samples of this run only, not of the resumed ones.
+        for ( const auto& worker : m_workers ) {
+
+            run_probes  += worker.m_num_probes_tested;
+            run_samples += worker.m_num_samples_tested;
+        }
+
+        const double num_points = static_cast<double>( std::max< uint64_t >( 1, num_searched ) );
+
+        os << "Search summary: " << searchModeName( m_search_mode ) << "\n";
+        os << "    sample points: " << num_searched << " of " << m_records.size() << "\n";
+        os << "    probes: " << total_probes << " (" << total_probes / num_points << " per sample point)\n";
+        os << "    rounds: " << total_rounds << " (" << total_rounds / num_points << " per sample point)\n";
+        if ( m_search_mode != DEPTH_CODE_SEARCH ) {
+            os << "    perturbed samples: " << run_samples << " ("
+               << run_samples / static_cast<double>( std::max< uint64_t >( 1, run_probes ) ) << " per probe)\n";
+        }
+        os << "    lowest confidence: ";
+        if ( std::isnan( confidence ) ) {
+            os << "none settled by the ratio test\n";
+        }
+        else {
+            os << confidence << "\n";
+        }
+        os << "    time: " << elapsed << " seconds (" << total_time / num_points << " seconds per sample point)\n";
+    }
+
+    void runDepthCodeSearch()
+    {
+        const int num_points = static_cast<int>( m_pending.size() );
+        const int num_blocks = std::min( m_scheduler.numWorkers(), std::max( 1, num_points ) );
+
+        m_scheduler.run(
+
+            num_blocks,
+
+            [ this ]( const int worker ) {
+
+                m_workers[ worker ].m_tester->attachThread();
+            },
+
+            [ this, num_points, num_blocks ]( const int worker, const int block ) {
+
+                const auto start = std::chrono::steady_clock::now();
+
+                const int begin = static_cast<long long>( block     ) * num_points / num_blocks;
+                const int end   = static_cast<long long>( block + 1 ) * num_points / num_blocks;
+
+                std::vector< float > points;
+                std::vector< float > gaps;
+
+                for ( int i = begin; i < end; i++ ) {
+                    points.push_back( m_sample_points[ m_pending[i] ] );
+                }
+
+                DepthCodeSearch search{ *m_workers[ worker ].m_tester, m_near, m_far, m_param_c };
+
+                search.run( points, gaps );
+
+                // the sample points of a block are searched together.
+                // each gets the wall time of the block.
+                const std::chrono::duration< double > elapsed = std::chrono::steady_clock::now() - start;
+
+                for ( int i = begin; i < end; i++ ) {
+
+                    complete( {
+                        static_cast< uint32_t >( m_pending[i] ),
+                        m_sample_points[ m_pending[i] ],
+                        gaps[ i - begin ],
+                        static_cast< uint32_t >( search.numRounds( i - begin ) ),
+                        static_cast< uint32_t >( search.numProbes( i - begin ) ),
+                        elapsed.count(),
+                        std::numeric_limits< float >::quiet_NaN() // no SequentialTest.
+                    } );
+                }
+            },
+
+            [ this ]( const int worker ) {
+
+                m_workers[ worker ].m_tester->detachThread();
+            }
+        );
+    }
+
+    // Runs the searches of the sample point at index and the ones taken
+    // from the scheduler after it, keeping up to m_pipeline_depth of them
+    // in flight on the tester at a time.
+    // A completed probe advances its search from the callback, and the next
+    // probe of the search is submitted in the next round. A probe not settled
+    // by its batch submits the next batch of its perturbed samples instead.
+    void testSamplePointsPipelined( Worker& worker, const int worker_index, const int index )
+    {
+        std::vector< SearchSlot > slots( m_pipeline_depth );
+
+        int num_active = 0;
+
+        auto start_slot = [ this, &num_active ]( SearchSlot& slot, const int index ) {
+
+            slot.m_index      = index;
+            slot.m_start      = startSearch( index, slot.m_search, slot.m_rand_gen, slot.m_confidence );
+            slot.m_last_saved = std::chrono::steady_clock::now();
+            slot.m_sequential   = makeSequentialTest();
+            slot.m_perturbation = PerturbationSequence{ m_perturbation, m_seed };
+            slot.m_in_flight  = false;
+            num_active++;
+        };
+
+        start_slot( slots[0], index );
+
+        for ( int i = 1; i < m_pipeline_depth; i++ ) {
+
+            int next_index;
+
+            if ( !m_scheduler.nextItem( worker_index, next_index ) ) {
+                break;
+            }
+            start_slot( slots[i], m_pending[ next_index ] );
+        }
+
+        while ( num_active > 0 ) {
+
+            for ( auto& slot : slots ) {
+
+                if ( slot.m_index < 0 || slot.m_in_flight ) {
+                    continue;
+                }
+
+                const bool in_probe =    slot.m_sequential.numSamples() > 0
+                                      && slot.m_sequential.verdict() == SequentialTest::UNDECIDED;
+
+                if ( !in_probe ) {
+
+                    if ( slot.m_search->finished() ) {
+
+                        complete( slot.m_index, *slot.m_search, slot.m_start, slot.m_confidence );
+
+                        num_active--;
+                        slot.m_index = -1;
+
+                        int next_index;
+
+                        if ( !m_scheduler.nextItem( worker_index, next_index ) ) {
+                            continue;
+                        }
+                        start_slot( slot, m_pending[ next_index ] );
+
+                        if ( slot.m_search->finished() ) {
+                            continue; // completed in the next round.
+                        }
+                    }
+
+                    saveSearchState(
+                        slot.m_index, *slot.m_search, slot.m_rand_gen, slot.m_confidence, slot.m_start, slot.m_last_saved );
+
+                    slot.m_sequential.begin();
+                    slot.m_perturbation.begin( slot.m_index, slot.m_search->numProbes() );
+                }
+
+                const auto sample_point = slot.m_search->samplePoint();
+
+                makeTestCases(
+                    slot.m_rand_gen,
+                    slot.m_perturbation,
+                    sample_point,
+                    slot.m_search->nextGap(),
+                    slot.m_sequential.nextBatchSize(),
+                    worker.m_test_cases
+                );
+
+                slot.m_in_flight = true;
+
+                SearchSlot* slot_ptr   = &slot;
+                Worker*     worker_ptr = &worker;
+
+                worker.m_tester->submitBatch(
+
+                    worker.m_test_cases,
+
+                    [ this, slot_ptr, worker_ptr ]( const std::vector< DepthTester::TestResult >& test_results ) {
+
+                        auto& sequential = slot_ptr->m_sequential;
+
+                        if ( addSamples( sequential, test_results ) ) {
+
+                            slot_ptr->m_search->report( sequential.verdict() == SequentialTest::RESOLVED );
+                            slot_ptr->m_confidence = SequentialTest::lowest( slot_ptr->m_confidence, sequential.confidence() );
+
+                            worker_ptr->m_num_probes_tested++;
+                            worker_ptr->m_num_samples_tested += sequential.numSamples();
+                        }
+                        slot_ptr->m_in_flight = false;
+                    }
+                );
+            }
+
+            if ( worker.m_tester->numInFlight() > 0 ) {
+
+                worker.m_tester->pollCompleted( true );
+            }
+        }
+    }
+
+    // Searches the sample point at index with StackSearch, one stack per
+    // perturbed sample, all of them in one testStacks() per round.
+    void testSamplePointStacked( Worker& worker, const int index )
+    {
+        std::unique_ptr< SearchStrategy > search;
+        double                            confidence;
+
+        const auto start      = startSearch( index, search, worker.m_rand_gen, confidence );
+        auto       last_saved = std::chrono::steady_clock::now();
+
+        auto& stack_search = static_cast< StackSearch& >( *search );
+
+        while ( !stack_search.finished() ) {
+
+            stack_search.reportStack( testOneStack( worker, index, stack_search, confidence ) );
+
+            saveSearchState( index, *search, worker.m_rand_gen, confidence, start, last_saved );
+        }
+
+        complete( index, *search, start, confidence );
+    }
+
+    // returns the index of the smallest gap of search.nextGaps() resolved
+    // by all the perturbed samples, or the number of the gaps if none is.
+    // confidence: lowered to the ones of the verdicts on both sides.
+    int testOneStack(
+        Worker&            worker,
+        const int          index,
+        const StackSearch& search,
+        double&            confidence
+    ) {
+        const auto& gaps         = search.nextGaps();
+        const int   num_gaps     = static_cast<int>( gaps.size() );
+        const int   num_planes   = num_gaps + 1;
+        const float sample_point = search.samplePoint();
+
+        worker.m_perturbation.begin( index, search.numProbes() );
+
+        // the perturbation of a sample scales all of its gaps.
+        std::vector< float > scales;
 
         for ( int i = 0; i < m_num_perturbed_samples; i++ ) {
+            scales.push_back( 1.0f + worker.m_perturbation.next( worker.m_rand_gen, 1.0f ) );
+        }
 
-            const auto perturbation = distribution( m_rand_gen );
+        // A pair of planes at sample_point -/+ gap/2 is resolved if either of
+        // them gets a code different from sample_point. The far halves are
+        // stacked from the widest gap to sample_point with GL_LESS, and the
+        // near halves likewise with GL_GREATER. The winner is the first plane
+        // with the code of sample_point, and the gaps of the planes before
+        // it are resolved on that side.
+        std::vector< int > first_resolved_of_samples( m_num_perturbed_samples, 0 );
 
-            bool plane_1_detected;
-            bool plane_2_detected;
+        for ( const float side : { 1.0f, -1.0f } ) {
 
-            const auto plane_1 = sample_point - 0.5f * ( gap + perturbation );
-            const auto plane_2 = sample_point + 0.5f * ( gap + perturbation );
+            worker.m_stack_planes.clear();
+
+            for ( int i = 0; i < m_num_perturbed_samples; i++ ) {
+
+                for ( int j = num_gaps - 1; j >= 0; j-- ) {
+                    worker.m_stack_planes.push_back( sample_point + side * 0.5f * gaps[j] * scales[i] );
+                }
+                worker.m_stack_planes.push_back( sample_point );
+            }
 
-            m_tester.test(
+            worker.m_tester->testStacks(
                 m_near,
                 m_far,
                 m_param_c,
-                plane_1,
-                plane_2,
-                plane_1_detected,
-                plane_2_detected
+                ( side > 0.0f ) ? DepthTester::STACK_LESS : DepthTester::STACK_GREATER,
+                num_planes,
+                worker.m_stack_planes,
+                worker.m_stack_winners
             );
 
-            if ( (!plane_1_detected) || plane_2_detected ) {
+            for ( int i = 0; i < m_num_perturbed_samples; i++ ) {
+
+                const int winner         = worker.m_stack_winners[i];
+                const int first_resolved = ( winner < 0 ) ? num_gaps : num_gaps - winner;
 
-                return false;
+                auto& first_resolved_of_sample = first_resolved_of_samples[i];
+
+                first_resolved_of_sample = ( side > 0.0f ) ? first_resolved
+                                                           : std::min( first_resolved_of_sample, first_resolved );
             }
+        }
 
-            m_tester.test(
-                m_near,
-                m_far,
-                m_param_c,
-                plane_2,
-                plane_1,
-                plane_2_detected,
-                plane_1_detected
+        int first_resolved = 0;
+
+        for ( const auto first_resolved_of_sample : first_resolved_of_samples ) {
+            first_resolved = std::max( first_resolved, first_resolved_of_sample );
+        }
+
+        for ( const int gap : { first_resolved - 1, first_resolved } ) {
+
+            if ( gap < 0 || gap >= num_gaps ) {
+                continue;
+            }
+
+            SequentialTest sequential{ 0.0, m_num_perturbed_samples };
+
+            sequential.begin();
+
+            for ( const auto first_resolved_of_sample : first_resolved_of_samples ) {
+                sequential.add( first_resolved_of_sample <= gap );
+            }
+
+            confidence = SequentialTest::lowest( confidence, sequential.confidence() );
+        }
+
+        worker.m_num_probes_tested  += num_gaps;
+        worker.m_num_samples_tested += static_cast<uint64_t>( num_gaps ) * m_num_perturbed_samples;
+
+        return first_resolved;
+    }
+
+    // the verdict and its confidence are left in worker.m_sequential.
+    // probe: the number of the probe in the search of the sample point at index.
+    bool testOneGap(
+        Worker&     worker,
+        const int   index,
+        const int   probe,
+        const float sample_point,
+        const float gap
+    ) {
+        auto& sequential = worker.m_sequential;
+
+        sequential.begin();
+        worker.m_perturbation.begin( index, probe );
+
+        // The test cases of a batch are rendered together and read back at
+        // once. Without early stopping, all of them are in the first batch.
+        do {
+            makeTestCases(
+                worker.m_rand_gen,
+                worker.m_perturbation,
+                sample_point,
+                gap,
+                sequential.nextBatchSize(),
+                worker.m_test_cases
             );
 
-            if ( (!plane_1_detected) || plane_2_detected ) {
+            worker.m_tester->testBatch( worker.m_test_cases, worker.m_test_results );
+
+        } while ( !addSamples( sequential, worker.m_test_results ) );
+
+        worker.m_num_probes_tested++;
+        worker.m_num_samples_tested += sequential.numSamples();
+
+        return sequential.verdict() == SequentialTest::RESOLVED;
+    }
+
+    // Each perturbed sample is tested in both drawing orders.
+    void makeTestCases(
+
+        std::default_random_engine&            rand_gen,
+        PerturbationSequence&                  perturbations,
+        const float                            sample_point,
+        const float                            gap,
+        const int                              num_perturbed_samples,
+        std::vector< DepthTester::TestCase >&  test_cases
+
+    ) const {
+
+        test_cases.clear();
+
+        for ( int i = 0; i < num_perturbed_samples; i++ ) {
+
+            const auto perturbation = perturbations.next( rand_gen, gap );
+
+            const auto plane_1 = sample_point - 0.5f * ( gap + perturbation );
+            const auto plane_2 = sample_point + 0.5f * ( gap + perturbation );
+
+            test_cases.push_back( { m_near, m_far, m_param_c, plane_1, plane_2 } );
+            test_cases.push_back( { m_near, m_far, m_param_c, plane_2, plane_1 } );
+        }
+    }
+
+    // adds the perturbed samples of a batch to sequential in order until it
+    // settles. returns true if it has.
+    bool addSamples(
+        SequentialTest&                               sequential,
+        const std::vector< DepthTester::TestResult >& test_results
+    ) const {
+        const int num_perturbed_samples = static_cast<int>( test_results.size() / 2 );
+
+        for ( int i = 0; i < num_perturbed_samples; i++ ) {
 
-                return false;
+            if ( sequential.add( isSampleResolved( test_results.data(), i ) ) != SequentialTest::UNDECIDED ) {
+                return true;
             }
         }
 
-        return true;
+        return false;
     }
 
-    SquareRenderer  m_tester;
-    std::default_random_engine m_rand_gen;
+    std::vector< Worker >  m_workers;
+    WorkStealingScheduler  m_scheduler;
 
-    const SquareRenderer::DepthTestType m_depth_test_type;
+    const DepthTester::DepthTestType m_depth_test_type;
     const float m_near;
     const float m_far;
     const float m_param_c;
     const int   m_num_samples;
     const int   m_num_perturbed_samples;
+    const int   m_pipeline_depth;
+    const SearchMode m_search_mode;
 
     std::vector< float > m_sample_points;
     std::vector< float > m_results;
+    std::vector< ResultWriter::Record > m_records;
+    std::vector< int >   m_pending; // the sample points to search.
+
+    std::mutex           m_results_mutex;
+    std::vector< bool >  m_completed;
+    std::vector< bool >  m_skipped; // not searched by the adaptive sampling.
+    int                  m_next_to_print;
+    std::ostream*        m_os;
+    ResultWriter*        m_result_writer;
+    Checkpoint*          m_checkpoint;
+    const AnalyticDepthModel*
+                         m_model;
+    double               m_early_stop_confidence;
+    PerturbationSequence::Kind
+                         m_perturbation;
+    unsigned int         m_seed;
+    double               m_refine_tolerance;
+    int                  m_stack_planes;
+    DepthTester::DepthFormat
+                         m_depth_format;
+    DepthTester::ClipConvention
+                         m_clip_convention;
 };
 
 } //namespace DepthTest
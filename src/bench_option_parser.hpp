@@ -0,0 +1,183 @@
+#ifndef __DEPTH_TEST_BENCH_OPTION_PARSE_HPP__
+#define __DEPTH_TEST_BENCH_OPTION_PARSE_HPP__
+
+#include <string>
+#include <algorithm>
+#include <iostream>
+
+#include "common_option_parser.hpp"
+
+namespace DepthTest {
+
+class BenchOptionParser : public CommonOptionParser
+{
+
+public:
+
+    explicit BenchOptionParser( int argc, char* argv[] ) noexcept
+        :CommonOptionParser{ SHADER_CACHE_OPTION, OPENGL, USAGE }
+        ,m_iterations           { 1000 }
+        ,m_cold_iterations      { 10 }
+        ,m_num_perturbed_samples{ 100 }
+        ,m_near                 { 0.1f }
+        ,m_far                  { 1000.0f }
+        ,m_param_c              { 1.0f }
+        ,m_output_path          {}
+        ,m_font_path            { "../data/font" }
+    {
+        for ( auto i = 1; i < argc ; i++ ) {
+
+            std::string arg( argv[i] );
+
+            if (    arg.compare ( HELP1 ) == 0
+                 || arg.compare ( HELP2 ) == 0
+                 || arg.compare ( HELP3 ) == 0
+                 || i + 1 == argc                ) {
+
+                std::cerr << USAGE;
+                exit(1);
+            }
+
+            std::string arg2( argv[++i] );
+
+            if ( parseCommonOption( arg, arg2 ) ) {
+
+                continue;
+            }
+            else if ( arg.compare ( ITERATIONS ) == 0 ) {
+
+                m_iterations = std::max( 1, std::stoi( arg2 ) );
+            }
+            else if ( arg.compare ( COLD_ITERATIONS ) == 0 ) {
+
+                m_cold_iterations = std::max( 1, std::stoi( arg2 ) );
+            }
+            else if ( arg.compare ( NUM_PERTURBED_SAMPLES ) == 0 ) {
+
+                m_num_perturbed_samples = std::max( 1, std::stoi( arg2 ) );
+            }
+            else if ( arg.compare ( NEAR ) == 0 ) {
+
+                m_near = std::stof( arg2 );
+            }
+            else if ( arg.compare ( FAR ) == 0 ) {
+
+                m_far = std::stof( arg2 );
+            }
+            else if ( arg.compare ( PARAM_C ) == 0 ) {
+
+                m_param_c = std::stof( arg2 );
+            }
+            else if ( arg.compare ( OUTPUT ) == 0 ) {
+
+                m_output_path = arg2;
+            }
+            else if ( arg.compare ( FONT ) == 0 ) {
+
+                m_font_path = arg2;
+            }
+            else {
+                std::cerr << USAGE;
+                exit(1);
+            }
+        }
+
+        if ( m_near <= 0.0f || m_far <= m_near || m_param_c <= 0.0f ) {
+
+            std::cerr << USAGE;
+            exit(1);
+        }
+    }
+
+    // the iterations of the short benchmarks, e.g. SquareRenderer::test().
+    int iterations() const
+    {
+        return m_iterations;
+    }
+
+    // the iterations of the long ones, e.g. the search of a sample point,
+    // and of the ones on a fresh context.
+    int coldIterations() const
+    {
+        return m_cold_iterations;
+    }
+
+    int numPerturbedSamples() const
+    {
+        return m_num_perturbed_samples;
+    }
+
+    float near() const
+    {
+        return m_near;
+    }
+
+    float far() const
+    {
+        return m_far;
+    }
+
+    float paramC() const
+    {
+        return m_param_c;
+    }
+
+    // empty for stdout.
+    const std::string& outputPath() const
+    {
+        return m_output_path;
+    }
+
+    // the font files without the extensions, i.e. font.txt and font.png.
+    const std::string& fontPath() const
+    {
+        return m_font_path;
+    }
+
+private:
+
+    static const std::string ITERATIONS;
+    static const std::string COLD_ITERATIONS;
+    static const std::string NUM_PERTURBED_SAMPLES;
+    static const std::string NEAR;
+    static const std::string FAR;
+    static const std::string PARAM_C;
+    static const std::string OUTPUT;
+    static const std::string FONT;
+    static const std::string HELP1;
+    static const std::string HELP2;
+    static const std::string HELP3;
+    static const std::string USAGE;
+
+    int         m_iterations;
+    int         m_cold_iterations;
+    int         m_num_perturbed_samples;
+    float       m_near;
+    float       m_far;
+    float       m_param_c;
+    std::string m_output_path;
+    std::string m_font_path;
+};
+
+} // namespace DepthTest {
+
+#endif/*__DEPTH_TEST_BENCH_OPTION_PARSE_HPP__*/
+
+///////////////////////
+
+namespace DepthTest {
+
+const std::string BenchOptionParser::ITERATIONS            = "-iterations";
+const std::string BenchOptionParser::COLD_ITERATIONS       = "-cold_iterations";
+const std::string BenchOptionParser::NUM_PERTURBED_SAMPLES = "-num_perturbed_samples";
+const std::string BenchOptionParser::NEAR                  = "-near";
+const std::string BenchOptionParser::FAR                   = "-far";
+const std::string BenchOptionParser::PARAM_C               = "-c";
+const std::string BenchOptionParser::OUTPUT                = "-output";
+const std::string BenchOptionParser::FONT                  = "-font";
+const std::string BenchOptionParser::HELP1                 = "-h";
+const std::string BenchOptionParser::HELP2                 = "-help";
+const std::string BenchOptionParser::HELP3                 = "-H";
+const std::string BenchOptionParser::USAGE                 = "depth_test_bench -h <for help> [-iterations <iterations of the short benchmarks, default 1000>] [-cold_iterations <iterations of the searches and of the fresh contexts, default 10>] [-num_perturbed_samples <num samples, default 100>] [-near <near, default 0.1>] [-far <far, default 1000>] [-c <parameter C for CF-type, default 1>] [-output <csv file, default stdout>] [-font <font files without the extensions, default ../data/font>] [-shader_cache <directory of the program binaries, default shader_cache, \"off\" to always compile>]\n";
+
+} // namespace DepthTest {
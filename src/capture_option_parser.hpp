@@ -0,0 +1,156 @@
+#ifndef __DEPTH_TEST_CAPTURE_OPTION_PARSE_HPP__
+#define __DEPTH_TEST_CAPTURE_OPTION_PARSE_HPP__
+
+#include <string>
+#include <algorithm>
+#include <iostream>
+
+#include "common_option_parser.hpp"
+
+namespace DepthTest {
+
+class CaptureOptionParser : public CommonOptionParser
+{
+
+public:
+
+    explicit CaptureOptionParser( int argc, char* argv[] ) noexcept
+        :CommonOptionParser{ DEPTH_TYPE_OPTION, OPENGL, USAGE }
+        ,m_near           { 0.0f }
+        ,m_far            { 0.0f }
+        ,m_param_c        { 1.0f }
+        ,m_num_planes     { 1 << 24 }
+        ,m_max_ulps       { 0 }
+        ,m_output_path    {}
+    {
+        for ( auto i = 1; i < argc ; i++ ) {
+
+            std::string arg( argv[i] );
+
+            if (    arg.compare ( HELP1 ) == 0
+                 || arg.compare ( HELP2 ) == 0
+                 || arg.compare ( HELP3 ) == 0
+                 || i + 1 == argc                ) {
+
+                std::cerr << USAGE;
+                exit(1);
+            }
+
+            std::string arg2( argv[++i] );
+
+            if ( parseCommonOption( arg, arg2 ) ) {
+
+                continue;
+            }
+            else if ( arg.compare ( NEAR ) == 0 ) {
+
+                m_near = std::stof( arg2 );
+            }
+            else if ( arg.compare ( FAR ) == 0 ) {
+
+                m_far = std::stof( arg2 );
+            }
+            else if ( arg.compare ( PARAM_C ) == 0 ) {
+
+                m_param_c = std::stof( arg2 );
+            }
+            else if ( arg.compare ( NUM_PLANES ) == 0 ) {
+
+                m_num_planes = std::max( 1, std::stoi( arg2 ) );
+            }
+            else if ( arg.compare ( MAX_ULPS ) == 0 ) {
+
+                m_max_ulps = std::max( 0, std::stoi( arg2 ) );
+            }
+            else if ( arg.compare ( OUTPUT ) == 0 ) {
+
+                m_output_path = arg2;
+            }
+            else {
+                std::cerr << USAGE;
+                exit(1);
+            }
+        }
+
+        if (    depthTestType() == DepthTester::UNKNOWN
+             || m_near <= 0.0f || m_far <= m_near || m_param_c <= 0.0f ) {
+
+            std::cerr << USAGE;
+            exit(1);
+        }
+    }
+
+    float near() const
+    {
+        return m_near;
+    }
+
+    float far() const
+    {
+        return m_far;
+    }
+
+    float paramC() const
+    {
+        return m_param_c;
+    }
+
+    // at most. every float plane in [near, far] if there are fewer.
+    int numPlanes() const
+    {
+        return m_num_planes;
+    }
+
+    // the planes off the CPU model by more ulps than this are written out.
+    int maxUlps() const
+    {
+        return m_max_ulps;
+    }
+
+    // empty for stdout.
+    const std::string& outputPath() const
+    {
+        return m_output_path;
+    }
+
+private:
+
+    static const std::string NEAR;
+    static const std::string FAR;
+    static const std::string PARAM_C;
+    static const std::string NUM_PLANES;
+    static const std::string MAX_ULPS;
+    static const std::string OUTPUT;
+    static const std::string HELP1;
+    static const std::string HELP2;
+    static const std::string HELP3;
+    static const std::string USAGE;
+
+    float                      m_near;
+    float                      m_far;
+    float                      m_param_c;
+    int                        m_num_planes;
+    int                        m_max_ulps;
+    std::string                m_output_path;
+};
+
+} // namespace DepthTest {
+
+#endif/*__DEPTH_TEST_CAPTURE_OPTION_PARSE_HPP__*/
+
+///////////////////////
+
+namespace DepthTest {
+
+const std::string CaptureOptionParser::NEAR                   = "-near";
+const std::string CaptureOptionParser::FAR                    = "-far";
+const std::string CaptureOptionParser::PARAM_C                = "-c";
+const std::string CaptureOptionParser::NUM_PLANES             = "-num_planes";
+const std::string CaptureOptionParser::MAX_ULPS               = "-max_ulps";
+const std::string CaptureOptionParser::OUTPUT                 = "-output";
+const std::string CaptureOptionParser::HELP1                  = "-h";
+const std::string CaptureOptionParser::HELP2                  = "-help";
+const std::string CaptureOptionParser::HELP3                  = "-H";
+const std::string CaptureOptionParser::USAGE                  = "depth_test_capture -h <for help> -depth_type <\"perspective\"/\"logfn\"/\"logcf\"> -near <near(positive)> -far <far(positive)> [-c <parameter C for CF-type, default 1>] [-num_planes <max num planes spread evenly over the float bits in [near, far], default 16777216>] [-max_ulps <planes off the CPU model by more ulps are written, default 0>] [-output <csv file, default stdout>]\n";
+
+} // namespace DepthTest {
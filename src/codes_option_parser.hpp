@@ -0,0 +1,161 @@
+#ifndef __DEPTH_TEST_CODES_OPTION_PARSE_HPP__
+#define __DEPTH_TEST_CODES_OPTION_PARSE_HPP__
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+#include "common_option_parser.hpp"
+
+namespace DepthTest {
+
+// -backend takes "gl" and "cpu" only, "cpu" by default.
+class CodesOptionParser : public CommonOptionParser
+{
+
+public:
+
+    explicit CodesOptionParser( int argc, char* argv[] ) noexcept
+        :CommonOptionParser{
+             DEPTH_TYPE_OPTION | DEPTH_FORMAT_OPTION | BACKEND_OPTION | THREADS_OPTION | SHADER_CACHE_OPTION,
+             CPU_EMULATION,
+             USAGE
+         }
+        ,m_num_bins       { 1000 }
+        ,m_near           { 0.0f }
+        ,m_far            { 0.0f }
+        ,m_param_c        { 1.0f }
+        ,m_output_path    {}
+        ,m_queries        {}
+    {
+        for ( auto i = 1; i < argc ; i++ ) {
+
+            std::string arg( argv[i] );
+
+            if (    arg.compare ( HELP1 ) == 0
+                 || arg.compare ( HELP2 ) == 0
+                 || arg.compare ( HELP3 ) == 0
+                 || i + 1 == argc                ) {
+
+                std::cerr << USAGE;
+                exit(1);
+            }
+
+            std::string arg2( argv[++i] );
+
+            if ( parseCommonOption( arg, arg2 ) ) {
+
+                continue;
+            }
+            else if ( arg.compare ( NUM_BINS ) == 0 ) {
+
+                m_num_bins = std::max( 1, std::stoi( arg2 ) );
+            }
+            else if ( arg.compare ( NEAR ) == 0 ) {
+
+                m_near = std::stof( arg2 );
+            }
+            else if ( arg.compare ( FAR ) == 0 ) {
+
+                m_far = std::stof( arg2 );
+            }
+            else if ( arg.compare ( PARAM_C ) == 0 ) {
+
+                m_param_c = std::stof( arg2 );
+            }
+            else if ( arg.compare ( OUTPUT ) == 0 ) {
+
+                m_output_path = arg2;
+            }
+            else if ( arg.compare ( QUERY ) == 0 ) {
+
+                m_queries.push_back( std::stof( arg2 ) );
+            }
+            else {
+                std::cerr << USAGE;
+                exit(1);
+            }
+        }
+
+        if (    depthTestType() == DepthTester::UNKNOWN
+             || m_near <= 0.0f || m_far <= m_near || m_param_c <= 0.0f ) {
+
+            std::cerr << USAGE;
+            exit(1);
+        }
+    }
+
+    int numBins() const
+    {
+        return m_num_bins;
+    }
+
+    float near() const
+    {
+        return m_near;
+    }
+
+    float far() const
+    {
+        return m_far;
+    }
+
+    float paramC() const
+    {
+        return m_param_c;
+    }
+
+    // empty for stdout.
+    const std::string& outputPath() const
+    {
+        return m_output_path;
+    }
+
+    // the z of -query. if any, only the steps at them are read.
+    const std::vector< float >& queries() const
+    {
+        return m_queries;
+    }
+
+private:
+
+    static const std::string NUM_BINS;
+    static const std::string NEAR;
+    static const std::string FAR;
+    static const std::string PARAM_C;
+    static const std::string OUTPUT;
+    static const std::string QUERY;
+    static const std::string HELP1;
+    static const std::string HELP2;
+    static const std::string HELP3;
+    static const std::string USAGE;
+
+    int                        m_num_bins;
+    float                      m_near;
+    float                      m_far;
+    float                      m_param_c;
+    std::string                m_output_path;
+    std::vector< float >       m_queries;
+};
+
+} // namespace DepthTest {
+
+#endif/*__DEPTH_TEST_CODES_OPTION_PARSE_HPP__*/
+
+///////////////////////
+
+namespace DepthTest {
+
+const std::string CodesOptionParser::NUM_BINS               = "-bins";
+const std::string CodesOptionParser::NEAR                   = "-near";
+const std::string CodesOptionParser::FAR                    = "-far";
+const std::string CodesOptionParser::PARAM_C                = "-c";
+const std::string CodesOptionParser::OUTPUT                 = "-output";
+const std::string CodesOptionParser::QUERY                  = "-query";
+const std::string CodesOptionParser::HELP1                  = "-h";
+const std::string CodesOptionParser::HELP2                  = "-help";
+const std::string CodesOptionParser::HELP3                  = "-H";
+const std::string CodesOptionParser::USAGE                  = "depth_test_codes -h <for help> -depth_type <\"perspective\"/\"logfn\"/\"logcf\"> -near <near(positive)> -far <far(positive)> [-c <parameter C for CF-type, default 1>] [-depth_format <\"d16\"/\"d24\"(default)/\"d32f\">] [-backend <\"cpu\"(CPU emulation, default)/\"gl\"(OpenGL)>] [-threads <num worker threads, 0 for all cores>] [-bins <num bins on log z, default 1000>] [-output <csv file, default stdout>] [-query <z to print the step at, instead of the table. repeatable>] [-shader_cache <directory of the program binaries, default shader_cache, \"off\" to always compile>]\n";
+
+} // namespace DepthTest {
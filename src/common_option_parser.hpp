@@ -0,0 +1,556 @@
+#ifndef __DEPTH_TEST_COMMON_OPTION_PARSE_HPP__
+#define __DEPTH_TEST_COMMON_OPTION_PARSE_HPP__
+
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <iostream>
+
+#include "shader_cache_option_parser.hpp"
+#include "square_renderer.hpp"
+#include "batch_tester.hpp"
+
+namespace DepthTest {
+
+// The options shared by the tools.
+// The parser of each tool derives from it, selects the groups of the options
+// it takes, and passes each of its options to parseCommonOption() first.
+// The tool keeps its own USAGE, which is printed on a bad value.
+class CommonOptionParser : public ShaderCacheOptionParser
+{
+
+public:
+
+    typedef enum _Backend {
+        OPENGL,        // SquareRenderer
+        CPU_EMULATION, // DepthPipelineEmulator
+        CROSS_CHECK    // both, reporting the disagreements
+    } Backend;
+
+    // the groups of the options.
+    typedef enum _OptionGroup {
+        DEPTH_TYPE_OPTION   = 1 << 0, // -depth_type
+        DEPTH_FORMAT_OPTION = 1 << 1, // -depth_format
+        CLIP_OPTION         = 1 << 2, // -clip
+        BACKEND_OPTION      = 1 << 3, // -backend gl/cpu
+        CROSS_CHECK_OPTION  = 1 << 4, // -backend check
+        THREADS_OPTION      = 1 << 5, // -threads
+        SEARCH_OPTIONS      = 1 << 6, // -pipeline, -detection, -search, -stack_planes, -initial_gap,
+                                      // -early_stop, -perturbation, -seed, -sampling,
+                                      // -refine_tolerance and -output_format
+        SHADER_CACHE_OPTION = 1 << 7  // -shader_cache
+    } OptionGroup;
+
+    SquareRenderer::DepthTestType depthTestType() const
+    {
+        return m_depth_test_type;
+    }
+
+    SquareRenderer::DepthFormat depthFormat() const
+    {
+        return m_depth_format;
+    }
+
+    // as requested. SquareRenderer may fall back from CLIP_REVERSED.
+    SquareRenderer::ClipConvention clipConvention() const
+    {
+        return m_clip_convention;
+    }
+
+    Backend backend() const
+    {
+        return m_backend;
+    }
+
+    int numThreads() const
+    {
+        return m_num_threads;
+    }
+
+    int pipelineDepth() const
+    {
+        return m_pipeline_depth;
+    }
+
+    SquareRenderer::DetectionMode detectionMode() const
+    {
+        return m_detection_mode;
+    }
+
+    BatchTester::SearchMode searchMode() const
+    {
+        return m_search_mode;
+    }
+
+    // the planes per stack of the stack search.
+    int stackPlanes() const
+    {
+        return m_stack_planes;
+    }
+
+    ResultWriter::Format outputFormat() const
+    {
+        return m_output_format;
+    }
+
+    // true if -output_format is given.
+    bool outputFormatGiven() const
+    {
+        return m_output_format_given;
+    }
+
+    // true if the searches start from AnalyticDepthModel.
+    bool modelInitialGap() const
+    {
+        return m_model_initial_gap;
+    }
+
+    // the confidence of the early stopping of the probes. 0 if off.
+    double earlyStopConfidence() const
+    {
+        return m_early_stop_confidence;
+    }
+
+    PerturbationSequence::Kind perturbation() const
+    {
+        return m_perturbation;
+    }
+
+    unsigned int seed() const
+    {
+        return m_seed;
+    }
+
+    // the tolerance of the adaptive sampling. 0 for the uniform sampling.
+    double refineTolerance() const
+    {
+        return m_adaptive_sampling ? m_refine_tolerance : 0.0;
+    }
+
+protected:
+
+    CommonOptionParser(
+        const unsigned int option_groups,
+        const Backend      default_backend,
+        const std::string& usage
+    ) noexcept
+        :ShaderCacheOptionParser{}
+        ,m_option_groups        { option_groups }
+        ,m_usage                { usage }
+        ,m_depth_test_type      { SquareRenderer::UNKNOWN }
+        ,m_depth_format         { SquareRenderer::DEPTH_D24 }
+        ,m_clip_convention      { SquareRenderer::CLIP_STANDARD }
+        ,m_backend              { default_backend }
+        ,m_num_threads          { 1 }
+        ,m_pipeline_depth       { 1 }
+        ,m_detection_mode       { SquareRenderer::COLOR_READBACK }
+        ,m_search_mode          { BatchTester::GRID_SEARCH }
+        ,m_stack_planes         { BatchTester::DEFAULT_STACK_PLANES }
+        ,m_output_format        { ResultWriter::BINARY }
+        ,m_output_format_given  { false }
+        ,m_model_initial_gap    { false }
+        ,m_early_stop_confidence{ 0.0 }
+        ,m_perturbation         { PerturbationSequence::RANDOM }
+        ,m_seed                 { BatchTester::DEFAULT_SEED }
+        ,m_adaptive_sampling    { false }
+        ,m_refine_tolerance     { BatchTester::DEFAULT_REFINE_TOLERANCE }
+    {
+    }
+
+    // parses arg and its value arg2 if arg is an option of the groups.
+    // returns false if it is not.
+    bool parseCommonOption( const std::string& arg, const std::string& arg2 )
+    {
+        if ( takes( DEPTH_TYPE_OPTION ) && arg.compare ( DEPTH_TYPE ) == 0 ) {
+
+            if ( arg2.compare( DEPTH_TYPE_PERSPECTIVE ) == 0 ) {
+
+                m_depth_test_type = SquareRenderer::PERSPECTIVE;
+            }
+            else if ( arg2.compare( DEPTH_TYPE_LOGFN ) == 0 ) {
+
+                m_depth_test_type = SquareRenderer::LOG_DEPTH_FN;
+            }
+            else if ( arg2.compare( DEPTH_TYPE_LOGCF ) == 0 ) {
+
+                m_depth_test_type = SquareRenderer::LOG_DEPTH_CF;
+            }
+        }
+        else if ( takes( DEPTH_FORMAT_OPTION ) && arg.compare ( DEPTH_FORMAT ) == 0 ) {
+
+            if ( arg2.compare( DEPTH_FORMAT_D16 ) == 0 ) {
+
+                m_depth_format = SquareRenderer::DEPTH_D16;
+            }
+            else if ( arg2.compare( DEPTH_FORMAT_D24 ) == 0 ) {
+
+                m_depth_format = SquareRenderer::DEPTH_D24;
+            }
+            else if ( arg2.compare( DEPTH_FORMAT_D32F ) == 0 ) {
+
+                m_depth_format = SquareRenderer::DEPTH_D32F;
+            }
+            else {
+                printUsageAndExit();
+            }
+        }
+        else if ( takes( CLIP_OPTION ) && arg.compare ( CLIP ) == 0 ) {
+
+            if ( arg2.compare( CLIP_STANDARD ) == 0 ) {
+
+                m_clip_convention = SquareRenderer::CLIP_STANDARD;
+            }
+            else if ( arg2.compare( CLIP_REVERSED ) == 0 ) {
+
+                m_clip_convention = SquareRenderer::CLIP_REVERSED;
+            }
+            else if ( arg2.compare( CLIP_REVERSED_RANGE ) == 0 ) {
+
+                m_clip_convention = SquareRenderer::CLIP_REVERSED_DEPTH_RANGE;
+            }
+            else {
+                printUsageAndExit();
+            }
+        }
+        else if ( takes( BACKEND_OPTION ) && arg.compare ( BACKEND ) == 0 ) {
+
+            if ( arg2.compare( BACKEND_GL ) == 0 ) {
+
+                m_backend = OPENGL;
+            }
+            else if ( arg2.compare( BACKEND_CPU ) == 0 ) {
+
+                m_backend = CPU_EMULATION;
+            }
+            else if ( takes( CROSS_CHECK_OPTION ) && arg2.compare( BACKEND_CROSS_CHECK ) == 0 ) {
+
+                m_backend = CROSS_CHECK;
+            }
+            else {
+                printUsageAndExit();
+            }
+        }
+        else if ( takes( THREADS_OPTION ) && arg.compare ( NUM_THREADS ) == 0 ) {
+
+            m_num_threads = std::stoi( arg2 );
+
+            if ( m_num_threads <= 0 ) {
+
+                m_num_threads = std::max( 1, static_cast<int>( std::thread::hardware_concurrency() ) );
+            }
+        }
+        else if ( takes( SHADER_CACHE_OPTION ) && parseShaderCacheOption( arg, arg2 ) ) {
+
+            return true;
+        }
+        else if ( takes( SEARCH_OPTIONS ) ) {
+
+            return parseSearchOption( arg, arg2 );
+        }
+        else {
+            return false;
+        }
+
+        return true;
+    }
+
+    // the checks across the options. called after all the options are parsed.
+    void checkCommonOptions() const
+    {
+        // the reversed depth orders the codes the other way.
+        if (    m_clip_convention != SquareRenderer::CLIP_STANDARD
+             && (    m_depth_test_type != SquareRenderer::PERSPECTIVE
+                  || m_search_mode == BatchTester::DEPTH_CODE_SEARCH
+                  || m_search_mode == BatchTester::STACK_SEARCH      ) ) {
+
+            printUsageAndExit();
+        }
+    }
+
+    void printUsageAndExit() const
+    {
+        std::cerr << m_usage;
+        exit(1);
+    }
+
+private:
+
+    bool takes( const OptionGroup group ) const
+    {
+        return ( m_option_groups & group ) != 0;
+    }
+
+    bool parseSearchOption( const std::string& arg, const std::string& arg2 )
+    {
+        if ( arg.compare ( PIPELINE_DEPTH ) == 0 ) {
+
+            m_pipeline_depth = std::max( 1, std::stoi( arg2 ) );
+        }
+        else if ( arg.compare ( DETECTION ) == 0 ) {
+
+            if ( arg2.compare( DETECTION_COLOR ) == 0 ) {
+
+                m_detection_mode = SquareRenderer::COLOR_READBACK;
+            }
+            else if ( arg2.compare( DETECTION_QUERY ) == 0 ) {
+
+                m_detection_mode = SquareRenderer::OCCLUSION_QUERY;
+            }
+            else {
+                printUsageAndExit();
+            }
+        }
+        else if ( arg.compare ( SEARCH ) == 0 ) {
+
+            if ( arg2.compare( SEARCH_GRID ) == 0 ) {
+
+                m_search_mode = BatchTester::GRID_SEARCH;
+            }
+            else if ( arg2.compare( SEARCH_DEPTH_CODES ) == 0 ) {
+
+                m_search_mode = BatchTester::DEPTH_CODE_SEARCH;
+            }
+            else if ( arg2.compare( SEARCH_LOG_BISECTION ) == 0 ) {
+
+                m_search_mode = BatchTester::LOG_BISECTION_SEARCH;
+            }
+            else if ( arg2.compare( SEARCH_BRACKETING ) == 0 ) {
+
+                m_search_mode = BatchTester::BRACKETING_SEARCH;
+            }
+            else if ( arg2.compare( SEARCH_ULP_WALK ) == 0 ) {
+
+                m_search_mode = BatchTester::ULP_WALK_SEARCH;
+            }
+            else if ( arg2.compare( SEARCH_STACK ) == 0 ) {
+
+                m_search_mode = BatchTester::STACK_SEARCH;
+            }
+            else {
+                printUsageAndExit();
+            }
+        }
+        else if ( arg.compare ( STACK_PLANES ) == 0 ) {
+
+            m_stack_planes = std::max( 3, std::min( SquareRenderer::MAX_STACK_PLANES, std::stoi( arg2 ) ) );
+        }
+        else if ( arg.compare ( OUTPUT_FORMAT ) == 0 ) {
+
+            if ( arg2.compare( OUTPUT_FORMAT_BINARY ) == 0 ) {
+
+                m_output_format = ResultWriter::BINARY;
+            }
+            else if ( arg2.compare( OUTPUT_FORMAT_CSV ) == 0 ) {
+
+                m_output_format = ResultWriter::CSV;
+            }
+            else if ( arg2.compare( OUTPUT_FORMAT_NPY ) == 0 ) {
+
+                m_output_format = ResultWriter::NPY;
+            }
+            else {
+                printUsageAndExit();
+            }
+            m_output_format_given = true;
+        }
+        else if ( arg.compare ( INITIAL_GAP ) == 0 ) {
+
+            if ( arg2.compare( INITIAL_GAP_BLIND ) == 0 ) {
+
+                m_model_initial_gap = false;
+            }
+            else if ( arg2.compare( INITIAL_GAP_MODEL ) == 0 ) {
+
+                m_model_initial_gap = true;
+            }
+            else {
+                printUsageAndExit();
+            }
+        }
+        else if ( arg.compare ( EARLY_STOP ) == 0 ) {
+
+            m_early_stop_confidence = std::stod( arg2 );
+
+            // 0 for off. at most 0.5 would settle the verdicts before any sample.
+            if (    m_early_stop_confidence < 0.0 || m_early_stop_confidence >= 1.0
+                 || ( m_early_stop_confidence > 0.0 && m_early_stop_confidence <= 0.5 ) ) {
+                printUsageAndExit();
+            }
+        }
+        else if ( arg.compare ( PERTURBATION ) == 0 ) {
+
+            if ( arg2.compare( PERTURBATION_RANDOM ) == 0 ) {
+
+                m_perturbation = PerturbationSequence::RANDOM;
+            }
+            else if ( arg2.compare( PERTURBATION_HALTON ) == 0 ) {
+
+                m_perturbation = PerturbationSequence::HALTON;
+            }
+            else if ( arg2.compare( PERTURBATION_SOBOL ) == 0 ) {
+
+                m_perturbation = PerturbationSequence::SOBOL;
+            }
+            else {
+                printUsageAndExit();
+            }
+        }
+        else if ( arg.compare ( SEED ) == 0 ) {
+
+            m_seed = static_cast< unsigned int >( std::stoul( arg2 ) );
+        }
+        else if ( arg.compare ( SAMPLING ) == 0 ) {
+
+            if ( arg2.compare( SAMPLING_UNIFORM ) == 0 ) {
+
+                m_adaptive_sampling = false;
+            }
+            else if ( arg2.compare( SAMPLING_ADAPTIVE ) == 0 ) {
+
+                m_adaptive_sampling = true;
+            }
+            else {
+                printUsageAndExit();
+            }
+        }
+        else if ( arg.compare ( REFINE_TOLERANCE ) == 0 ) {
+
+            m_refine_tolerance = std::stod( arg2 );
+
+            if ( m_refine_tolerance <= 0.0 ) {
+                printUsageAndExit();
+            }
+        }
+        else {
+            return false;
+        }
+
+        return true;
+    }
+
+    static const std::string DEPTH_TYPE;
+    static const std::string DEPTH_TYPE_PERSPECTIVE;
+    static const std::string DEPTH_TYPE_LOGFN;
+    static const std::string DEPTH_TYPE_LOGCF;
+    static const std::string DEPTH_FORMAT;
+    static const std::string DEPTH_FORMAT_D16;
+    static const std::string DEPTH_FORMAT_D24;
+    static const std::string DEPTH_FORMAT_D32F;
+    static const std::string CLIP;
+    static const std::string CLIP_STANDARD;
+    static const std::string CLIP_REVERSED;
+    static const std::string CLIP_REVERSED_RANGE;
+    static const std::string BACKEND;
+    static const std::string BACKEND_GL;
+    static const std::string BACKEND_CPU;
+    static const std::string BACKEND_CROSS_CHECK;
+    static const std::string NUM_THREADS;
+    static const std::string PIPELINE_DEPTH;
+    static const std::string DETECTION;
+    static const std::string DETECTION_COLOR;
+    static const std::string DETECTION_QUERY;
+    static const std::string SEARCH;
+    static const std::string SEARCH_GRID;
+    static const std::string SEARCH_DEPTH_CODES;
+    static const std::string SEARCH_LOG_BISECTION;
+    static const std::string SEARCH_BRACKETING;
+    static const std::string SEARCH_ULP_WALK;
+    static const std::string SEARCH_STACK;
+    static const std::string STACK_PLANES;
+    static const std::string OUTPUT_FORMAT;
+    static const std::string OUTPUT_FORMAT_BINARY;
+    static const std::string OUTPUT_FORMAT_CSV;
+    static const std::string OUTPUT_FORMAT_NPY;
+    static const std::string INITIAL_GAP;
+    static const std::string INITIAL_GAP_BLIND;
+    static const std::string INITIAL_GAP_MODEL;
+    static const std::string EARLY_STOP;
+    static const std::string PERTURBATION;
+    static const std::string PERTURBATION_RANDOM;
+    static const std::string PERTURBATION_HALTON;
+    static const std::string PERTURBATION_SOBOL;
+    static const std::string SEED;
+    static const std::string SAMPLING;
+    static const std::string SAMPLING_UNIFORM;
+    static const std::string SAMPLING_ADAPTIVE;
+    static const std::string REFINE_TOLERANCE;
+
+    const unsigned int            m_option_groups;
+    const std::string&            m_usage;
+
+    SquareRenderer::DepthTestType m_depth_test_type;
+    SquareRenderer::DepthFormat   m_depth_format;
+    SquareRenderer::ClipConvention
+                                  m_clip_convention;
+    Backend                       m_backend;
+    int                           m_num_threads;
+    int                           m_pipeline_depth;
+    SquareRenderer::DetectionMode m_detection_mode;
+    BatchTester::SearchMode       m_search_mode;
+    int                           m_stack_planes;
+    ResultWriter::Format          m_output_format;
+    bool                          m_output_format_given;
+    bool                          m_model_initial_gap;
+    double                        m_early_stop_confidence;
+    PerturbationSequence::Kind    m_perturbation;
+    unsigned int                  m_seed;
+    bool                          m_adaptive_sampling;
+    double                        m_refine_tolerance;
+};
+
+} // namespace DepthTest {
+
+///////////////////////
+
+namespace DepthTest {
+
+const std::string CommonOptionParser::DEPTH_TYPE            = "-depth_type";
+const std::string CommonOptionParser::DEPTH_TYPE_PERSPECTIVE= "perspective";
+const std::string CommonOptionParser::DEPTH_TYPE_LOGFN      = "logfn";
+const std::string CommonOptionParser::DEPTH_TYPE_LOGCF      = "logcf";
+const std::string CommonOptionParser::DEPTH_FORMAT          = "-depth_format";
+const std::string CommonOptionParser::DEPTH_FORMAT_D16      = "d16";
+const std::string CommonOptionParser::DEPTH_FORMAT_D24      = "d24";
+const std::string CommonOptionParser::DEPTH_FORMAT_D32F     = "d32f";
+const std::string CommonOptionParser::CLIP                  = "-clip";
+const std::string CommonOptionParser::CLIP_STANDARD         = "standard";
+const std::string CommonOptionParser::CLIP_REVERSED         = "reversed";
+const std::string CommonOptionParser::CLIP_REVERSED_RANGE   = "reversed_range";
+const std::string CommonOptionParser::BACKEND               = "-backend";
+const std::string CommonOptionParser::BACKEND_GL            = "gl";
+const std::string CommonOptionParser::BACKEND_CPU           = "cpu";
+const std::string CommonOptionParser::BACKEND_CROSS_CHECK   = "check";
+const std::string CommonOptionParser::NUM_THREADS           = "-threads";
+const std::string CommonOptionParser::PIPELINE_DEPTH        = "-pipeline";
+const std::string CommonOptionParser::DETECTION             = "-detection";
+const std::string CommonOptionParser::DETECTION_COLOR       = "color";
+const std::string CommonOptionParser::DETECTION_QUERY       = "query";
+const std::string CommonOptionParser::SEARCH                = "-search";
+const std::string CommonOptionParser::SEARCH_GRID           = "grid";
+const std::string CommonOptionParser::SEARCH_DEPTH_CODES    = "codes";
+const std::string CommonOptionParser::SEARCH_LOG_BISECTION  = "bisection";
+const std::string CommonOptionParser::SEARCH_BRACKETING     = "bracketing";
+const std::string CommonOptionParser::SEARCH_ULP_WALK       = "ulp";
+const std::string CommonOptionParser::SEARCH_STACK          = "stack";
+const std::string CommonOptionParser::STACK_PLANES          = "-stack_planes";
+const std::string CommonOptionParser::OUTPUT_FORMAT         = "-output_format";
+const std::string CommonOptionParser::OUTPUT_FORMAT_BINARY  = "binary";
+const std::string CommonOptionParser::OUTPUT_FORMAT_CSV     = "csv";
+const std::string CommonOptionParser::OUTPUT_FORMAT_NPY     = "npy";
+const std::string CommonOptionParser::INITIAL_GAP           = "-initial_gap";
+const std::string CommonOptionParser::INITIAL_GAP_BLIND     = "blind";
+const std::string CommonOptionParser::INITIAL_GAP_MODEL     = "model";
+const std::string CommonOptionParser::EARLY_STOP            = "-early_stop";
+const std::string CommonOptionParser::PERTURBATION          = "-perturbation";
+const std::string CommonOptionParser::PERTURBATION_RANDOM   = "random";
+const std::string CommonOptionParser::PERTURBATION_HALTON   = "halton";
+const std::string CommonOptionParser::PERTURBATION_SOBOL    = "sobol";
+const std::string CommonOptionParser::SEED                  = "-seed";
+const std::string CommonOptionParser::SAMPLING              = "-sampling";
+const std::string CommonOptionParser::SAMPLING_UNIFORM      = "uniform";
+const std::string CommonOptionParser::SAMPLING_ADAPTIVE     = "adaptive";
+const std::string CommonOptionParser::REFINE_TOLERANCE      = "-refine_tolerance";
+
+} // namespace DepthTest {
+
+#endif/*__DEPTH_TEST_COMMON_OPTION_PARSE_HPP__*/
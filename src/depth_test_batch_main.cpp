@@ -2,14 +2,19 @@
 #include <string>
 #include <chrono>
 #include <random>
+#include <memory>
 
 #include <GL/glew.h>
-#include <GLFW/glfw3.h>
 
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
 
+#include "headless_context.hpp"
+#include "context_bound_tester.hpp"
 #include "square_renderer.hpp"
+#include "stage_profiler.hpp"
+#include "depth_pipeline_emulator.hpp"
+#include "cross_check_tester.hpp"
 #include "option_parser.hpp"
 #include "batch_tester.hpp"
 
@@ -19,58 +24,188 @@ int main( int argc, char* argv[] )
 {
     DepthTest::OptionParser opt{ argc, argv };
 
-    if( !glfwInit() ) {
-        exit(1);
-    }
+    const bool use_gl  = opt.backend() != DepthTest::OptionParser::CPU_EMULATION;
+    const bool use_cpu = opt.backend() != DepthTest::OptionParser::OPENGL;
 
-    glfwWindowHint( GLFW_SAMPLES, 4 );
-    glfwWindowHint( GLFW_CONTEXT_VERSION_MAJOR, 3 );
-    glfwWindowHint( GLFW_CONTEXT_VERSION_MINOR, 3 );
-    glfwWindowHint( GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE );
+    // the programs of the renderers are loaded from the binaries of the previous runs.
+    DepthTest::setProgramBinaryCache( opt.shaderCache() );
 
-#ifdef __APPLE__
-    glfwWindowHint( GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
+    // one profiler per OpenGL tester, destroyed after the testers.
+    std::vector< std::unique_ptr< DepthTest::StageProfiler > >         profilers;
 
-    GLFWwindow* window = glfwCreateWindow(100, 100, "none", nullptr, nullptr );
+    // one tester per worker thread.
+    // each OpenGL tester has its own context.
+    // the CPU emulation does not need an OpenGL context.
+    std::vector< std::unique_ptr< DepthTest::ContextBoundTester > >    gl_testers;
+    std::vector< std::unique_ptr< DepthTest::DepthPipelineEmulator > > cpu_testers;
+    std::vector< std::unique_ptr< DepthTest::CrossCheckTester > >      cross_check_testers;
+    std::vector< DepthTest::DepthTester* >                             testers;
 
-    if( window == nullptr ) {
-        glfwTerminate();
-        exit(1);
-    }
+    // the one in effect. the renderers fall back from CLIP_REVERSED without
+    // glClipControl(), and the emulators follow them.
+    auto clip_convention = opt.clipConvention();
+
+    for ( int i = 0; i < opt.numThreads(); i++ ) {
+
+        if ( use_gl ) {
+
+            gl_testers.push_back( std::make_unique< DepthTest::ContextBoundTester >(
+                opt.depthTestType(),
+                opt.depthFormat(),
+                opt.clipConvention()
+            ) );
+            clip_convention = gl_testers.back()->renderer().clipConvention();
+
+            gl_testers.back()->renderer().setDetectionMode( opt.detectionMode() );
+
+            if ( opt.profile() ) {
+
+                profilers.push_back( std::make_unique< DepthTest::StageProfiler >() );
+                gl_testers.back()->renderer().setProfiler( profilers.back().get() );
+            }
+        }
+
+        if ( use_cpu ) {
+
+            cpu_testers.push_back( std::make_unique< DepthTest::DepthPipelineEmulator >(
+                opt.depthTestType(),
+                opt.depthFormat(),
+                clip_convention
+            ) );
+        }
+
+        if ( use_gl && use_cpu ) {
 
-    glfwMakeContextCurrent( window );
+            cross_check_testers.push_back(
+                std::make_unique< DepthTest::CrossCheckTester >( *gl_testers.back(), *cpu_testers.back() )
+            );
+            testers.push_back( cross_check_testers.back().get() );
+        }
+        else if ( use_gl ) {
 
-    glewExperimental = GL_TRUE;
-    if ( glewInit() != GLEW_OK ) {
-        exit(1);
+            testers.push_back( gl_testers.back().get() );
+        }
+        else {
+            testers.push_back( cpu_testers.back().get() );
+        }
     }
 
-    DepthTest::OpenGLInfo gl_info;
-    std::cout << "Open GL Info: " << gl_info << "\n";
+    if ( use_gl ) {
 
-    DepthTest::BatchTester tester{
+        std::cout << "Context: " << DepthTest::HeadlessContext::backendName() << "\n";
+
+        gl_testers.front()->attachThread();
+
+        DepthTest::OpenGLInfo gl_info;
+        std::cout << "Open GL Info: " << gl_info << "\n";
+
+        gl_testers.front()->detachThread();
+    }
+
+    DepthTest::BatchTester batch_tester{
+        testers,
         opt.depthTestType(),
         opt.near(),
         opt.far(),
         opt.paramC(),
         opt.numPoints(),
-        opt.numPerturbedSamples()
+        opt.numPerturbedSamples(),
+        opt.pipelineDepth(),
+        opt.searchMode()
+    };
+
+    batch_tester.setDepthBuffer( opt.depthFormat(), clip_convention );
+
+    std::unique_ptr< DepthTest::ResultWriter > result_writer;
+
+    if ( !opt.outputPath().empty() ) {
+
+        result_writer = std::make_unique< DepthTest::ResultWriter >(
+            opt.outputPath(),
+            opt.outputFormat(),
+            opt.depthTestType(),
+            opt.near(),
+            opt.far(),
+            opt.paramC(),
+            opt.numPerturbedSamples()
+        );
+        batch_tester.setResultWriter( result_writer.get() );
+    }
+
+    DepthTest::AnalyticDepthModel model{
+        opt.depthTestType(),
+        opt.depthFormat(),
+        opt.near(),
+        opt.far(),
+        opt.paramC(),
+        clip_convention
     };
 
+    if ( opt.modelInitialGap() ) {
+
+        batch_tester.setAnalyticModel( &model );
+    }
+
+    batch_tester.setEarlyStopping( opt.earlyStopConfidence() );
+    batch_tester.setPerturbation( opt.perturbation(), opt.seed() );
+    batch_tester.setAdaptiveSampling( opt.refineTolerance() );
+    batch_tester.setStackPlanes( opt.stackPlanes() );
+
+    std::unique_ptr< DepthTest::Checkpoint > checkpoint;
+
+    if ( !opt.checkpointPath().empty() ) {
+
+        checkpoint = std::make_unique< DepthTest::Checkpoint >(
+            opt.checkpointPath(),
+            opt.resume(),
+            opt.depthTestType(),
+            opt.near(),
+            opt.far(),
+            opt.paramC(),
+            opt.numPoints(),
+            opt.numPerturbedSamples(),
+            opt.searchMode(),
+            opt.earlyStopConfidence(),
+            opt.perturbation(),
+            opt.seed(),
+            opt.depthFormat(),
+            clip_convention,
+            opt.stackPlanes(),
+            opt.modelInitialGap()
+        );
+        batch_tester.setCheckpoint( checkpoint.get() );
+    }
+
     auto start = high_resolution_clock::now();
 
-    tester.run();
+    batch_tester.run();
+
+    if ( result_writer ) {
+        result_writer->close();
+    }
 
     auto stop = high_resolution_clock::now();
     auto duration = duration_cast<seconds>(stop - start);
 
-    // you can retrieve the results from:
-    // tester.m_sample_points and tester.m_results.
+    // the results per sample point are in the records of -output.
 
     std::cerr << "Test finished in " << duration.count() << " seconds\n";
 
-    glfwDestroyWindow( window );
-    glfwTerminate();
+    if ( !profilers.empty() ) {
+
+        DepthTest::StageProfiler profile;
+
+        for ( const auto& profiler : profilers ) {
+            profile.merge( *profiler );
+        }
+
+        profile.printSummary( std::cerr, duration_cast< std::chrono::duration< double > >( stop - start ).count() );
+    }
+
+    for ( const auto& cross_check_tester : cross_check_testers ) {
+
+        cross_check_tester->report( std::cerr );
+    }
+
     return 0;
 }
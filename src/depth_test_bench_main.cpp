@@ -0,0 +1,387 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <functional>
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "headless_context.hpp"
+#include "context_bound_tester.hpp"
+#include "square_renderer.hpp"
+#include "opengl_util.hpp"
+#include "png_util.hpp"
+#include "font_runtime_helper.hpp"
+#include "text_renderer_line.hpp"
+#include "bench_option_parser.hpp"
+#include "batch_tester.hpp"
+
+using namespace std::chrono;
+
+// Micro-benchmarks of the hot paths, one CSV row per benchmark, so that
+// the throughput can be compared across the driver updates.
+// The rows are written to stdout or -output, and the rest to stderr.
+
+static const DepthTest::DepthTester::DepthTestType DEPTH_TEST_TYPES[] = {
+    DepthTest::DepthTester::PERSPECTIVE,
+    DepthTest::DepthTester::LOG_DEPTH_FN,
+    DepthTest::DepthTester::LOG_DEPTH_CF
+};
+
+static const char* depthTestTypeName( const DepthTest::DepthTester::DepthTestType depth_test_type )
+{
+    switch ( depth_test_type ) {
+
+      case DepthTest::DepthTester::PERSPECTIVE:
+        return "perspective";
+
+      case DepthTest::DepthTester::LOG_DEPTH_FN:
+        return "logfn";
+
+      case DepthTest::DepthTester::LOG_DEPTH_CF:
+        return "logcf";
+
+      default:
+        return "unknown";
+    }
+}
+
+// the shaders of SquareRenderer::test() and testBatch() for the depth type.
+static void shadersOf(
+    const DepthTest::DepthTester::DepthTestType depth_test_type,
+    std::string& vert_str,
+    std::string& frag_str,
+    std::string& frag_str_batch
+) {
+    DepthTest::visitDepthEncoding( depth_test_type, [ & ]( auto encoding ) {
+
+        using Encoding = decltype( encoding );
+
+        vert_str       = DepthTest::vertStrOf< Encoding >();
+        frag_str       = DepthTest::fragStrOf< Encoding >();
+        frag_str_batch = DepthTest::fragStrBatchOf< Encoding >();
+    } );
+}
+
+// one row of the CSV.
+// units: the work of one iteration, e.g. the test cases, in unit.
+class BenchReport {
+
+  public:
+
+    explicit BenchReport( std::ostream& os )
+        :m_os{ os }
+    {
+        m_os << "benchmark,depth_type,z,iterations,mean_us,p50_us,p99_us,min_us,max_us,units_per_iteration,unit,units_per_sec\n";
+    }
+
+    void add(
+        const std::string&    benchmark,
+        const std::string&    depth_type,
+        const float           z,
+        std::vector< double > microseconds,
+        const double          units,
+        const std::string&    unit
+    ) {
+        if ( microseconds.empty() ) {
+            return;
+        }
+
+        std::sort( microseconds.begin(), microseconds.end() );
+
+        double sum = 0.0;
+
+        for ( const auto t : microseconds ) {
+            sum += t;
+        }
+
+        const double mean = sum / static_cast<double>( microseconds.size() );
+
+        m_os << benchmark << ","
+             << depth_type << ","
+             << z << ","
+             << microseconds.size() << ","
+             << mean << ","
+             << percentile( microseconds, 0.5 ) << ","
+             << percentile( microseconds, 0.99 ) << ","
+             << microseconds.front() << ","
+             << microseconds.back() << ","
+             << units << ","
+             << unit << ","
+             << ( mean > 0.0 ? units * 1.0e6 / mean : 0.0 ) << "\n";
+
+        m_os.flush();
+
+        std::cerr << benchmark << ( depth_type.empty() ? "" : " " + depth_type ) << ": p50 "
+                  << percentile( microseconds, 0.5 ) << " us\n";
+    }
+
+  private:
+
+    // nearest rank.
+    static double percentile( const std::vector< double >& sorted, const double p )
+    {
+        const auto rank = static_cast< size_t >( ceil( p * static_cast<double>( sorted.size() ) ) );
+
+        return sorted[ std::min( sorted.size(), std::max< size_t >( 1, rank ) ) - 1 ];
+    }
+
+    std::ostream& m_os;
+};
+
+static double timeMicroseconds( const std::function< void() >& f )
+{
+    const auto start = steady_clock::now();
+
+    f();
+
+    return duration_cast< duration< double, std::micro > >( steady_clock::now() - start ).count();
+}
+
+int main( int argc, char* argv[] )
+{
+    DepthTest::BenchOptionParser opt{ argc, argv };
+
+    std::ofstream output_file;
+
+    if ( !opt.outputPath().empty() ) {
+
+        output_file.open( opt.outputPath() );
+
+        if ( !output_file ) {
+
+            std::cerr << "cannot open " << opt.outputPath() << "\n";
+            return 1;
+        }
+    }
+
+    BenchReport report{ opt.outputPath().empty() ? std::cout : output_file };
+
+    const float near    = opt.near();
+    const float far     = opt.far();
+    const float param_c = opt.paramC();
+
+    // the sample points at 10%, 50%, and 90% of the range in the log scale.
+    std::vector< float > sample_points;
+
+    for ( const float alpha : { 0.1f, 0.5f, 0.9f } ) {
+
+        sample_points.push_back( exp( log( near ) + alpha * ( log( far ) - log( near ) ) ) );
+    }
+
+    const float z_mid = sample_points[1];
+
+    std::cerr << "Context: " << DepthTest::HeadlessContext::backendName() << "\n";
+
+    for ( const auto depth_test_type : DEPTH_TEST_TYPES ) {
+
+        const std::string type_name = depthTestTypeName( depth_test_type );
+
+        // a resolvable pair of planes around z_mid.
+        const float plane_1 = z_mid * 0.99f;
+        const float plane_2 = z_mid * 1.01f;
+
+        bool plane_1_detected;
+        bool plane_2_detected;
+
+        // the setup of a fresh context and its renderer, and its first test,
+        // which includes the lazy work of the driver.
+        std::vector< double > setup_times;
+        std::vector< double > cold_times;
+
+        for ( int i = 0; i < opt.coldIterations(); i++ ) {
+
+            std::unique_ptr< DepthTest::ContextBoundTester > tester;
+
+            setup_times.push_back( timeMicroseconds( [ & ]() {
+                tester = std::make_unique< DepthTest::ContextBoundTester >( depth_test_type );
+            } ) );
+
+            tester->attachThread();
+
+            cold_times.push_back( timeMicroseconds( [ & ]() {
+                tester->renderer().test( near, far, param_c, plane_1, plane_2, plane_1_detected, plane_2_detected );
+            } ) );
+
+            tester->detachThread();
+        }
+
+        report.add( "renderer_setup", type_name, 0.0f, setup_times, 1.0, "renderer" );
+        report.add( "test_cold",      type_name, z_mid, cold_times, 1.0, "test" );
+
+        DepthTest::ContextBoundTester tester{ depth_test_type };
+
+        tester.attachThread();
+
+        if ( depth_test_type == DEPTH_TEST_TYPES[0] ) {
+
+            DepthTest::OpenGLInfo gl_info;
+            std::cerr << "Open GL Info: " << gl_info << "\n";
+        }
+
+        // SquareRenderer::test() after warming up.
+        std::vector< double > warm_times;
+
+        for ( int i = 0; i < 10; i++ ) {
+            tester.renderer().test( near, far, param_c, plane_1, plane_2, plane_1_detected, plane_2_detected );
+        }
+
+        for ( int i = 0; i < opt.iterations(); i++ ) {
+
+            warm_times.push_back( timeMicroseconds( [ & ]() {
+                tester.renderer().test( near, far, param_c, plane_1, plane_2, plane_1_detected, plane_2_detected );
+            } ) );
+        }
+
+        report.add( "test_warm", type_name, z_mid, warm_times, 1.0, "test" );
+
+        // compileAndLink() of the programs of the renderer.
+        // the driver may cache the compiled shaders, e.g. Mesa unless
+        // MESA_SHADER_CACHE_DISABLE=true.
+        std::string vert_str;
+        std::string frag_str;
+        std::string frag_str_batch;
+
+        shadersOf( depth_test_type, vert_str, frag_str, frag_str_batch );
+
+        std::vector< double > compile_times;
+        std::vector< double > compile_batch_times;
+
+        for ( int i = 0; i < opt.coldIterations(); i++ ) {
+
+            GLuint prog_id = 0;
+
+            compile_times.push_back( timeMicroseconds( [ & ]() {
+                prog_id = DepthTest::compileAndLink( vert_str, frag_str, std::cerr );
+            } ) );
+            glDeleteProgram( prog_id );
+
+            compile_batch_times.push_back( timeMicroseconds( [ & ]() {
+                prog_id = DepthTest::compileAndLink( DepthTest::VERT_STR_BATCH, frag_str_batch, std::cerr );
+            } ) );
+            glDeleteProgram( prog_id );
+        }
+
+        report.add( "compile_link",       type_name, 0.0f, compile_times,       1.0, "program" );
+        report.add( "compile_link_batch", type_name, 0.0f, compile_batch_times, 1.0, "program" );
+
+        // the same from the program binary cache, saved by the first one.
+        std::vector< double > cached_times;
+
+        DepthTest::setProgramBinaryCache( opt.shaderCache() );
+
+        glDeleteProgram( DepthTest::compileAndLink( vert_str, frag_str, std::cerr ) );
+
+        for ( int i = 0; i < opt.coldIterations(); i++ ) {
+
+            GLuint prog_id = 0;
+
+            cached_times.push_back( timeMicroseconds( [ & ]() {
+                prog_id = DepthTest::compileAndLink( vert_str, frag_str, std::cerr );
+            } ) );
+            glDeleteProgram( prog_id );
+        }
+
+        DepthTest::setProgramBinaryCache( "" );
+
+        report.add( "compile_link_cached", type_name, 0.0f, cached_times, 1.0, "program" );
+
+        tester.detachThread();
+
+        // the whole search of a sample point, with the batched tests.
+        std::vector< DepthTest::DepthTester* > testers{ &tester };
+
+        DepthTest::BatchTester batch_tester{
+            testers,
+            depth_test_type,
+            near,
+            far,
+            param_c,
+            1,
+            opt.numPerturbedSamples()
+        };
+
+        for ( const auto z : sample_points ) {
+
+            std::vector< double > search_times;
+            double                probes = 0.0;
+
+            for ( int i = 0; i < opt.coldIterations(); i++ ) {
+
+                const auto record = batch_tester.testOneSamplePoint( z );
+
+                search_times.push_back( record.m_wall_time * 1.0e6 );
+                probes = record.m_num_probes;
+            }
+
+            report.add( "sample_point", type_name, z, search_times, probes, "probe" );
+        }
+    }
+
+    // the font setup of the interactive tools, except TextRendererOpenGL,
+    // which needs a GLFW window: the metrics, the texture, and the typesetting.
+    std::vector< double > metrics_times;
+    std::unique_ptr< Font::RuntimeHelper > font_helper;
+
+    for ( int i = 0; i < opt.coldIterations(); i++ ) {
+
+        metrics_times.push_back( timeMicroseconds( [ & ]() {
+            font_helper = std::make_unique< Font::RuntimeHelper >( opt.fontPath() + ".txt" );
+        } ) );
+    }
+
+    report.add( "font_metrics", "", 0.0f, metrics_times, font_helper->glyphs().size(), "glyph" );
+
+    DepthTest::HeadlessContext context;
+
+    std::vector< double > texture_times;
+    double                num_texels = 0.0;
+
+    for ( int i = 0; i < opt.coldIterations(); i++ ) {
+
+        GLuint texture = 0;
+
+        texture_times.push_back( timeMicroseconds( [ & ]() {
+
+            DepthTest::PNG png{ opt.fontPath() + ".png" };
+
+            texture = DepthTest::generateFontTexture( png.width(), png.height(), png.data() );
+            glFinish();
+
+            num_texels = static_cast<double>( png.width() ) * png.height();
+        } ) );
+
+        glDeleteTextures( 1, &texture );
+    }
+
+    report.add( "font_texture", "", 0.0f, texture_times, num_texels, "texel" );
+
+    const std::string line_str = "Z-Fighting: near 0.1 far 1000.0 gap 0.000123";
+
+    std::vector< double > line_times;
+
+    for ( int i = 0; i < opt.iterations(); i++ ) {
+
+        line_times.push_back( timeMicroseconds( [ & ]() {
+
+            DepthTest::TextRendererLine line{
+                *font_helper,
+                line_str,
+                1.0f,
+                glm::vec4{ 1.0f, 1.0f, 1.0f, 1.0f },
+                glm::vec4{ 0.0f, 0.0f, 0.0f, 1.0f }
+            };
+        } ) );
+    }
+
+    report.add( "text_line", "", 0.0f, line_times, line_str.size(), "glyph" );
+
+    return 0;
+}
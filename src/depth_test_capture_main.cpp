@@ -0,0 +1,214 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "headless_context.hpp"
+#include "square_renderer.hpp"
+#include "depth_math_capture.hpp"
+#include "capture_option_parser.hpp"
+
+using namespace std::chrono;
+
+// Pushes the float planes in [near, far] through the depth math of the
+// shaders with DepthMathCapture, and diffs the results against the CPU
+// model of DepthPipelineEmulator (Encoding::shaderDepth()) in ulps, and
+// against the closed form in double (Encoding::depth()).
+// The planes off by more than -max_ulps are written to stdout or -output
+// as CSV, and the histograms to stderr.
+
+// the signed distance in ulps from b to a.
+static int64_t ulpDistance( const float a, const float b )
+{
+    int32_t ia, ib;
+
+    memcpy( &ia, &a, sizeof(float) );
+    memcpy( &ib, &b, sizeof(float) );
+
+    // to the two's complement order.
+    if ( ia < 0 ) {
+        ia = INT32_MIN - ia;
+    }
+    if ( ib < 0 ) {
+        ib = INT32_MIN - ib;
+    }
+    return static_cast<int64_t>( ia ) - static_cast<int64_t>( ib );
+}
+
+class UlpHistogram {
+
+  public:
+
+    // -MAX_BIN and MAX_BIN collect the ones beyond.
+    static constexpr int MAX_BIN = 4;
+
+    UlpHistogram()
+        :m_counts   ( 2 * MAX_BIN + 1, 0 )
+        ,m_max_ulps { 0 }
+    {
+        ;
+    }
+
+    void add( const int64_t ulps )
+    {
+        const int64_t bin = std::max( -1 * (int64_t)MAX_BIN, std::min( (int64_t)MAX_BIN, ulps ) );
+
+        m_counts[ bin + MAX_BIN ]++;
+        m_max_ulps = std::max( m_max_ulps, std::abs( ulps ) );
+    }
+
+    void print( std::ostream& os, const std::string& name ) const
+    {
+        os << name << " ulps:";
+
+        for ( int i = -1 * MAX_BIN; i <= MAX_BIN; i++ ) {
+
+            os << " " << ( i == -1 * MAX_BIN ? "<=" : ( i == MAX_BIN ? ">=" : "" ) )
+               << i << ":" << m_counts[ i + MAX_BIN ];
+        }
+        os << " max:" << m_max_ulps << "\n";
+    }
+
+  private:
+
+    std::vector< long > m_counts;
+    int64_t             m_max_ulps;
+};
+
+int main( int argc, char* argv[] )
+{
+    DepthTest::CaptureOptionParser opt{ argc, argv };
+
+    const float near    = opt.near();
+    const float far     = opt.far();
+    const float param_c = opt.paramC();
+
+    // spread evenly over the float bits, i.e. roughly evenly on log z.
+    uint32_t near_bits, far_bits;
+
+    memcpy( &near_bits, &near, sizeof(float) );
+    memcpy( &far_bits,  &far,  sizeof(float) );
+
+    const uint64_t num_floats = static_cast<uint64_t>( far_bits - near_bits ) + 1;
+    const int      num_planes = static_cast<int>( std::min( num_floats, static_cast<uint64_t>( opt.numPlanes() ) ) );
+
+    std::vector< float > planes( num_planes );
+
+    for ( int i = 0; i < num_planes; i++ ) {
+
+        const uint32_t bits = ( num_planes == 1 ) ? near_bits
+                            : near_bits + static_cast<uint32_t>( i * ( num_floats - 1 ) / ( num_planes - 1 ) );
+
+        memcpy( &planes[i], &bits, sizeof(float) );
+    }
+
+    DepthTest::HeadlessContext context;
+
+    std::cerr << "Context: " << DepthTest::HeadlessContext::backendName() << "\n";
+
+    std::vector< float > gpu_ndc_z;
+    std::vector< float > gpu_depths;
+
+    DepthTest::DepthMathCapture capture{ opt.depthTestType() };
+
+    auto start = high_resolution_clock::now();
+
+    capture.capture( near, far, param_c, planes, gpu_ndc_z, gpu_depths );
+
+    auto stop = high_resolution_clock::now();
+
+    const double elapsed = duration_cast< std::chrono::duration< double > >( stop - start ).count();
+
+    std::ofstream output_file;
+
+    if ( !opt.outputPath().empty() ) {
+
+        output_file.open( opt.outputPath() );
+
+        if ( !output_file ) {
+
+            std::cerr << "Could not open " << opt.outputPath() << "\n";
+            return 1;
+        }
+    }
+
+    std::ostream& os = opt.outputPath().empty() ? std::cout : output_file;
+
+    os << std::setprecision( 9 );
+
+    os << "z,gpu_ndc_z,cpu_ndc_z,ndc_z_ulps,gpu_depth,cpu_depth,depth_ulps,double_depth\n";
+
+    UlpHistogram ndc_z_histogram;
+    UlpHistogram depth_histogram;
+    double       max_gpu_error = 0.0;
+    double       max_cpu_error = 0.0;
+    long         num_written   = 0;
+
+    DepthTest::visitDepthEncoding( opt.depthTestType(), [ & ]( auto encoding ) {
+
+        using Encoding = decltype( encoding );
+
+        const auto  Mproj = DepthTest::SquareRenderer::testProjection( near, far );
+        const float P22   = Mproj[2][2];
+        const float P32   = Mproj[3][2];
+
+        float depth_params[2];
+
+        Encoding::params( near, far, param_c, depth_params );
+
+        for ( int i = 0; i < num_planes; i++ ) {
+
+            // the same expressions as DepthPipelineEmulator::depthCodeOf().
+            const float z      = -1.0f * planes[i];
+            const float w      = -1.0f * z;
+            const float z_clip = P22 * z + P32;
+
+            const float cpu_ndc_z = z_clip * ( 1.0f / w );
+            const float cpu_depth = Encoding::shaderDepth( z, z_clip, w, depth_params );
+
+            const double double_depth = Encoding::depth( z, near, far, param_c );
+
+            const auto ndc_z_ulps = ulpDistance( gpu_ndc_z[i],  cpu_ndc_z );
+            const auto depth_ulps = ulpDistance( gpu_depths[i], cpu_depth );
+
+            ndc_z_histogram.add( ndc_z_ulps );
+            depth_histogram.add( depth_ulps );
+
+            max_gpu_error = std::max( max_gpu_error, fabs( gpu_depths[i] - double_depth ) );
+            max_cpu_error = std::max( max_cpu_error, fabs( cpu_depth     - double_depth ) );
+
+            if ( std::abs( ndc_z_ulps ) > opt.maxUlps() || std::abs( depth_ulps ) > opt.maxUlps() ) {
+
+                os << planes[i] << ","
+                   << gpu_ndc_z[i] << "," << cpu_ndc_z << "," << ndc_z_ulps << ","
+                   << gpu_depths[i] << "," << cpu_depth << "," << depth_ulps << ","
+                   << std::setprecision( 17 ) << double_depth << std::setprecision( 9 ) << "\n";
+
+                num_written++;
+            }
+        }
+    } );
+
+    std::cerr << "Planes: " << num_planes << " Written: " << num_written << "\n";
+
+    ndc_z_histogram.print( std::cerr, "ndc z (GPU - CPU)" );
+    depth_histogram.print( std::cerr, "depth (GPU - CPU)" );
+
+    std::cerr << "Max abs error of depth against double: GPU " << max_gpu_error
+              << " CPU " << max_cpu_error << "\n";
+
+    std::cerr << "Capture finished in " << elapsed << " seconds ("
+              << static_cast<double>( num_planes ) / std::max( 1.0e-9, elapsed ) << " planes/sec)\n";
+
+    return 0;
+}
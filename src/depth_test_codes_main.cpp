@@ -0,0 +1,126 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <memory>
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "headless_context.hpp"
+#include "context_bound_tester.hpp"
+#include "depth_pipeline_emulator.hpp"
+#include "codes_option_parser.hpp"
+#include "depth_code_table.hpp"
+
+using namespace std::chrono;
+
+// The depth codes of every float plane in [near, far], summarized into the
+// resolvable gap over log z, i.e. the curve that depth_test_batch samples.
+// The table is written to stdout or -output, and the rest to stderr.
+
+int main( int argc, char* argv[] )
+{
+    DepthTest::CodesOptionParser opt{ argc, argv };
+
+    const bool use_gl = opt.backend() == DepthTest::CodesOptionParser::OPENGL;
+
+    DepthTest::setProgramBinaryCache( opt.shaderCache() );
+
+    // one tester per worker thread.
+    std::vector< std::unique_ptr< DepthTest::ContextBoundTester > >    gl_testers;
+    std::vector< std::unique_ptr< DepthTest::DepthPipelineEmulator > > cpu_testers;
+    std::vector< DepthTest::DepthTester* >                             testers;
+
+    for ( int i = 0; i < opt.numThreads(); i++ ) {
+
+        if ( use_gl ) {
+
+            gl_testers.push_back(
+                std::make_unique< DepthTest::ContextBoundTester >( opt.depthTestType(), opt.depthFormat() )
+            );
+            testers.push_back( gl_testers.back().get() );
+        }
+        else {
+            cpu_testers.push_back(
+                std::make_unique< DepthTest::DepthPipelineEmulator >( opt.depthTestType(), opt.depthFormat() )
+            );
+            testers.push_back( cpu_testers.back().get() );
+        }
+    }
+
+    DepthTest::DepthCodeTable table{ testers, opt.near(), opt.far(), opt.paramC(), opt.numBins() };
+
+    std::ofstream output_file;
+
+    if ( !opt.outputPath().empty() ) {
+
+        output_file.open( opt.outputPath() );
+
+        if ( !output_file ) {
+
+            std::cerr << "Could not open " << opt.outputPath() << "\n";
+            return 1;
+        }
+    }
+
+    std::ostream& os = opt.outputPath().empty() ? std::cout : output_file;
+
+    os << std::setprecision( 9 );
+
+    if ( !opt.queries().empty() ) {
+
+        os << "z,code,step_first,step_next,step,gap\n";
+
+        for ( const auto z : opt.queries() ) {
+
+            float      gap;
+            const auto step = table.query( z, gap );
+
+            os << z << ","
+               << step.m_code << ","
+               << step.m_first << ","
+               << step.m_next << ","
+               << static_cast<double>( step.m_next ) - static_cast<double>( step.m_first ) << ","
+               << gap << "\n";
+        }
+
+        return 0;
+    }
+
+    auto start = high_resolution_clock::now();
+
+    table.build();
+
+    auto stop = high_resolution_clock::now();
+
+    const double elapsed = duration_cast< std::chrono::duration< double > >( stop - start ).count();
+
+    os << "z_low,z_high,num_steps,num_descents,min_step,mean_step,max_step\n";
+
+    for ( const auto& bin : table.bins() ) {
+
+        os << bin.m_z_low << "," << bin.m_z_high << "," << bin.m_num_steps << "," << bin.m_num_descents << ",";
+
+        if ( bin.m_num_steps == 0 ) {
+            os << ",,\n";
+        }
+        else {
+            os << bin.m_min_step << ","
+               << bin.m_sum_step / static_cast<double>( bin.m_num_steps ) << ","
+               << bin.m_max_step << "\n";
+        }
+    }
+
+    std::cerr << "Planes: "   << table.numPlanes()
+              << " Steps: "    << table.numSteps()
+              << " Descents: " << table.numDescents() << "\n";
+
+    std::cerr << "Table finished in " << elapsed << " seconds ("
+              << static_cast<double>( table.numPlanes() ) / std::max( 1.0e-9, elapsed ) << " planes/sec)\n";
+
+    return 0;
+}
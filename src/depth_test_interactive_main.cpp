@@ -11,6 +11,7 @@
 #include "glfw_window.hpp"
 #include "glfw_user_input_interactive.hpp"
 #include "ui_text_interactive.hpp"
+#include "interactive_option_parser.hpp"
 
 #include "square_renderer.hpp"
 
@@ -20,6 +21,8 @@ static const std::string WINDOW_TITLE  = "Depth Test";
 
 int main( int argc, char* argv[] )
 {
+    DepthTest::InteractiveOptionParser opt{ argc, argv };
+
     if( !glfwInit() ) {
         exit(1);
     }
@@ -35,6 +38,8 @@ int main( int argc, char* argv[] )
         exit(1);
     }
 
+    DepthTest::setProgramBinaryCache( opt.shaderCache() );
+
     DepthTest::OpenGLInfo gl_info;
     std::cout << "Open GL Info: " << gl_info << "\n";
 
@@ -14,6 +14,7 @@
 #include "glfw_user_input_shader_comparator.hpp"
 #include "ui_text_shader_comparator.hpp"
 #include "cylinders_renderer.hpp"
+#include "interactive_option_parser.hpp"
 
 static constexpr int     WINDOW_WIDTH  = 1024;
 static constexpr int     WINDOW_HEIGHT = 768;
@@ -29,6 +30,8 @@ static constexpr int   NUM_EDGES_CYLINDER_2 = 10;
 
 int main( int argc, char* argv[] )
 {
+    DepthTest::InteractiveOptionParser opt{ argc, argv };
+
     if( !glfwInit() ) {
         exit(1);
     }
@@ -44,6 +47,8 @@ int main( int argc, char* argv[] )
         exit(1);
     }
 
+    DepthTest::setProgramBinaryCache( opt.shaderCache() );
+
     DepthTest::OpenGLInfo gl_info;
     std::cout << "Open GL Info: " << gl_info << "\n";
 
@@ -0,0 +1,363 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "headless_context.hpp"
+#include "context_bound_tester.hpp"
+#include "square_renderer.hpp"
+#include "depth_pipeline_emulator.hpp"
+#include "cross_check_tester.hpp"
+#include "sweep_option_parser.hpp"
+#include "sweep_manifest.hpp"
+#include "batch_tester.hpp"
+#include "layered_batch_tester.hpp"
+
+using namespace std::chrono;
+
+// The testers of one depth type, depth format and clip convention, one per
+// worker thread. They are created at the first configuration of the kind,
+// and reused by the following ones, so the shaders are compiled only once.
+struct TesterSet {
+    std::vector< std::unique_ptr< DepthTest::ContextBoundTester > >    m_gl_testers;
+    std::vector< std::unique_ptr< DepthTest::DepthPipelineEmulator > > m_cpu_testers;
+    std::vector< std::unique_ptr< DepthTest::CrossCheckTester > >      m_cross_check_testers;
+    std::vector< DepthTest::DepthTester* >                             m_testers;
+
+    // the one in effect, after the fallback of the renderers.
+    DepthTest::DepthTester::ClipConvention                             m_clip_convention;
+};
+
+typedef std::tuple<
+    DepthTest::DepthTester::DepthTestType,
+    DepthTest::DepthTester::DepthFormat,
+    DepthTest::DepthTester::ClipConvention
+> TesterSetKey;
+
+// Runs the configurations of group together with LayeredBatchTester.
+// returns false if a result file cannot be opened.
+static bool runLayered(
+    const DepthTest::SweepOptionParser&                           opt,
+    const std::vector< DepthTest::SweepManifest::Configuration >& configs,
+    const std::vector< size_t >&                                  group,
+    const TesterSet&                                              set
+) {
+    const auto& first = configs[ group.front() ];
+
+    std::vector< float >                                      params_c;
+    std::vector< std::unique_ptr< std::ofstream > >           files;
+    std::vector< std::ostream* >                              streams;
+    std::vector< std::unique_ptr< DepthTest::ResultWriter > > result_writers;
+    std::vector< DepthTest::ResultWriter* >                   writers;
+
+    for ( const auto i : group ) {
+
+        const auto& config    = configs[i];
+        const auto  file_path = opt.outputDir() + "/results_" + config.m_name + ".txt";
+
+        files.push_back( std::make_unique< std::ofstream >( file_path ) );
+
+        if ( !*files.back() ) {
+
+            std::cerr << "cannot open " << file_path << "\n";
+            return false;
+        }
+
+        streams.push_back( files.back().get() );
+        params_c.push_back( config.m_param_c );
+
+        if ( opt.writeRecords() ) {
+
+            const char* extensions[] = { ".bin", ".csv", ".npy" };
+
+            result_writers.push_back( std::make_unique< DepthTest::ResultWriter >(
+                opt.outputDir() + "/results_" + config.m_name + extensions[ opt.outputFormat() ],
+                opt.outputFormat(),
+                config.m_depth_test_type,
+                config.m_near,
+                config.m_far,
+                config.m_param_c,
+                config.m_num_perturbed_samples
+            ) );
+            writers.push_back( result_writers.back().get() );
+        }
+    }
+
+    DepthTest::LayeredBatchTester layered_tester{
+        set.m_testers,
+        first.m_depth_test_type,
+        first.m_near,
+        first.m_far,
+        params_c,
+        first.m_num_points,
+        first.m_num_perturbed_samples
+    };
+
+    layered_tester.setPerturbation( opt.perturbation(), opt.seed() );
+    layered_tester.setDepthBuffer( first.m_depth_format, set.m_clip_convention );
+    layered_tester.setResultWriters( writers );
+    layered_tester.run( streams );
+
+    return true;
+}
+
+int main( int argc, char* argv[] )
+{
+    DepthTest::SweepOptionParser opt{ argc, argv };
+
+    DepthTest::SweepManifest manifest{ opt.manifestPath() };
+
+    const bool standard_clip_only =    opt.searchMode() == DepthTest::BatchTester::DEPTH_CODE_SEARCH
+                                    || opt.searchMode() == DepthTest::BatchTester::STACK_SEARCH;
+
+    for ( const auto& config : manifest.configurations() ) {
+
+        if ( standard_clip_only && config.m_clip_convention != DepthTest::DepthTester::CLIP_STANDARD ) {
+
+            std::cerr << config.m_name << ": the search needs the standard clip convention\n";
+            return 1;
+        }
+    }
+
+    const bool use_gl  = opt.backend() != DepthTest::SweepOptionParser::CPU_EMULATION;
+    const bool use_cpu = opt.backend() != DepthTest::SweepOptionParser::OPENGL;
+
+    // the programs of the renderers are loaded from the binaries of the previous runs.
+    DepthTest::setProgramBinaryCache( opt.shaderCache() );
+
+    // one context per worker thread, shared by the depth types.
+    std::vector< std::shared_ptr< DepthTest::HeadlessContext > > contexts;
+
+    if ( use_gl ) {
+
+        for ( int i = 0; i < opt.numThreads(); i++ ) {
+
+            contexts.push_back( std::make_shared< DepthTest::HeadlessContext >() );
+            contexts.back()->releaseCurrent();
+        }
+
+        std::cout << "Context: " << DepthTest::HeadlessContext::backendName() << "\n";
+
+        contexts.front()->makeCurrent();
+
+        DepthTest::OpenGLInfo gl_info;
+        std::cout << "Open GL Info: " << gl_info << "\n";
+
+        contexts.front()->releaseCurrent();
+    }
+
+    std::map< TesterSetKey, TesterSet > tester_sets;
+
+    auto testers_for = [ & ]( const DepthTest::SweepManifest::Configuration& config ) -> TesterSet& {
+
+        auto& set = tester_sets[ TesterSetKey{ config.m_depth_test_type, config.m_depth_format, config.m_clip_convention } ];
+
+        if ( !set.m_testers.empty() ) {
+            return set;
+        }
+
+        set.m_clip_convention = config.m_clip_convention;
+
+        for ( int i = 0; i < opt.numThreads(); i++ ) {
+
+            if ( use_gl ) {
+
+                set.m_gl_testers.push_back( std::make_unique< DepthTest::ContextBoundTester >(
+                    contexts[i],
+                    config.m_depth_test_type,
+                    config.m_depth_format,
+                    config.m_clip_convention
+                ) );
+                set.m_gl_testers.back()->renderer().setDetectionMode( opt.detectionMode() );
+
+                set.m_clip_convention = set.m_gl_testers.back()->renderer().clipConvention();
+            }
+
+            if ( use_cpu ) {
+
+                set.m_cpu_testers.push_back( std::make_unique< DepthTest::DepthPipelineEmulator >(
+                    config.m_depth_test_type,
+                    config.m_depth_format,
+                    set.m_clip_convention
+                ) );
+            }
+
+            if ( use_gl && use_cpu ) {
+
+                set.m_cross_check_testers.push_back(
+                    std::make_unique< DepthTest::CrossCheckTester >( *set.m_gl_testers.back(), *set.m_cpu_testers.back() )
+                );
+                set.m_testers.push_back( set.m_cross_check_testers.back().get() );
+            }
+            else if ( use_gl ) {
+
+                set.m_testers.push_back( set.m_gl_testers.back().get() );
+            }
+            else {
+                set.m_testers.push_back( set.m_cpu_testers.back().get() );
+            }
+        }
+
+        return set;
+    };
+
+    const auto& configs = manifest.configurations();
+
+    // the configurations tested together by LayeredBatchTester, in the order
+    // of the manifest. they differ only in C. one each without -layers.
+    std::vector< std::vector< size_t > > groups;
+
+    for ( size_t i = 0; i < configs.size(); i++ ) {
+
+        const auto& config = configs[i];
+
+        auto group = std::find_if( groups.begin(), groups.end(), [ & ]( const std::vector< size_t >& g ) {
+
+            const auto& first = configs[ g.front() ];
+
+            return    static_cast<int>( g.size() ) < opt.maxLayers()
+                   && first.m_depth_test_type       == config.m_depth_test_type
+                   && first.m_near                  == config.m_near
+                   && first.m_far                   == config.m_far
+                   && first.m_num_points            == config.m_num_points
+                   && first.m_num_perturbed_samples == config.m_num_perturbed_samples
+                   && first.m_depth_format          == config.m_depth_format
+                   && first.m_clip_convention       == config.m_clip_convention;
+        } );
+
+        if ( group != groups.end() ) {
+            group->push_back( i );
+        }
+        else {
+            groups.push_back( { i } );
+        }
+    }
+
+    auto sweep_start = high_resolution_clock::now();
+
+    for ( const auto& group : groups ) {
+
+        if ( group.size() > 1 ) {
+
+            auto start = high_resolution_clock::now();
+
+            auto& set = testers_for( configs[ group.front() ] );
+
+            if ( !runLayered( opt, configs, group, set ) ) {
+                return 1;
+            }
+
+            auto stop = high_resolution_clock::now();
+            auto duration = duration_cast<milliseconds>(stop - start);
+
+            for ( const auto i : group ) {
+
+                std::cerr << configs[i].m_name << ": " << opt.outputDir() << "/results_" << configs[i].m_name
+                          << ".txt in " << duration.count() << " milliseconds (" << group.size() << " layers)\n";
+            }
+            continue;
+        }
+
+        const auto& config = configs[ group.front() ];
+
+        const auto file_path = opt.outputDir() + "/results_" + config.m_name + ".txt";
+
+        std::ofstream os( file_path );
+
+        if ( !os ) {
+
+            std::cerr << "cannot open " << file_path << "\n";
+            return 1;
+        }
+
+        auto start = high_resolution_clock::now();
+
+        auto& set = testers_for( config );
+
+        DepthTest::BatchTester batch_tester{
+            set.m_testers,
+            config.m_depth_test_type,
+            config.m_near,
+            config.m_far,
+            config.m_param_c,
+            config.m_num_points,
+            config.m_num_perturbed_samples,
+            opt.pipelineDepth(),
+            opt.searchMode()
+        };
+
+        batch_tester.setDepthBuffer( config.m_depth_format, set.m_clip_convention );
+
+        DepthTest::AnalyticDepthModel model{
+            config.m_depth_test_type,
+            config.m_depth_format,
+            config.m_near,
+            config.m_far,
+            config.m_param_c,
+            set.m_clip_convention
+        };
+
+        if ( opt.modelInitialGap() ) {
+
+            batch_tester.setAnalyticModel( &model );
+        }
+
+        batch_tester.setEarlyStopping( opt.earlyStopConfidence() );
+        batch_tester.setPerturbation( opt.perturbation(), opt.seed() );
+        batch_tester.setAdaptiveSampling( opt.refineTolerance() );
+        batch_tester.setStackPlanes( opt.stackPlanes() );
+
+        std::unique_ptr< DepthTest::ResultWriter > result_writer;
+
+        if ( opt.writeRecords() ) {
+
+            const char* extensions[] = { ".bin", ".csv", ".npy" };
+
+            result_writer = std::make_unique< DepthTest::ResultWriter >(
+                opt.outputDir() + "/results_" + config.m_name + extensions[ opt.outputFormat() ],
+                opt.outputFormat(),
+                config.m_depth_test_type,
+                config.m_near,
+                config.m_far,
+                config.m_param_c,
+                config.m_num_perturbed_samples
+            );
+            batch_tester.setResultWriter( result_writer.get() );
+        }
+
+        batch_tester.run( os );
+
+        auto stop = high_resolution_clock::now();
+        auto duration = duration_cast<milliseconds>(stop - start);
+
+        std::cerr << config.m_name << ": " << file_path << " in " << duration.count() << " milliseconds\n";
+    }
+
+    auto sweep_stop = high_resolution_clock::now();
+    auto sweep_duration = duration_cast<seconds>(sweep_stop - sweep_start);
+
+    std::cerr << "Sweep finished in " << sweep_duration.count() << " seconds\n";
+
+    for ( const auto& key_and_set : tester_sets ) {
+
+        for ( const auto& cross_check_tester : key_and_set.second.m_cross_check_testers ) {
+
+            cross_check_tester->report( std::cerr );
+        }
+    }
+
+    // the testers must go before their contexts.
+    tester_sets.clear();
+
+    return 0;
+}
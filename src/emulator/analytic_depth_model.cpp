@@ -0,0 +1,91 @@
+#include <cmath>
+#include <algorithm>
+
+#include "depth_encoding.hpp"
+#include "analytic_depth_model.hpp"
+
+namespace DepthTest {
+
+AnalyticDepthModel::AnalyticDepthModel(
+    const DepthTester::DepthTestType  depth_test_type,
+    const DepthTester::DepthFormat    depth_format,
+    const float                       near,
+    const float                       far,
+    const float                       param_c,
+    const DepthTester::ClipConvention clip_convention
+)
+    :m_depth_test_type { depth_test_type }
+    ,m_depth_format    { depth_format }
+    ,m_near            { near }
+    ,m_far             { far }
+    ,m_param_c         { param_c }
+    ,m_clip_convention { clip_convention }
+    ,m_depth           { nullptr }
+    ,m_abs_derivative  { nullptr }
+{
+    visitDepthEncoding( m_depth_test_type, [ this ]( auto encoding ) {
+
+        using Encoding = decltype( encoding );
+
+        m_depth          = &Encoding::depth;
+        m_abs_derivative = &Encoding::absDerivative;
+    } );
+}
+
+double AnalyticDepthModel::depth( const double z_vcs ) const
+{
+    const double depth = m_depth( z_vcs, m_near, m_far, m_param_c );
+
+    return ( m_clip_convention == DepthTester::CLIP_STANDARD ) ? depth : 1.0 - depth;
+}
+
+double AnalyticDepthModel::absDerivative( const double z_vcs ) const
+{
+    return m_abs_derivative( z_vcs, m_near, m_far, m_param_c );
+}
+
+double AnalyticDepthModel::depthResolution( const double depth ) const
+{
+    double resolution;
+
+    switch( m_depth_format ) {
+
+      case DepthTester::DEPTH_D16:
+        resolution = 1.0 / 65535.0;
+        break;
+
+      case DepthTester::DEPTH_D32F:
+        {
+            // the float spacing at depth.
+            const float d = static_cast<float>( depth );
+            resolution = static_cast<double>( nextafterf( d, 2.0f ) ) - static_cast<double>( d );
+        }
+        break;
+
+      default:
+        resolution = 1.0 / 16777215.0;
+    }
+
+    if ( m_clip_convention == DepthTester::CLIP_REVERSED_DEPTH_RANGE ) {
+
+        // depth = -0.5 * z_ndc + 0.5, z_ndc in float.
+        const float  z_ndc = static_cast<float>( fabs( 1.0 - 2.0 * depth ) );
+        const double ulp_z = static_cast<double>( nextafterf( z_ndc, 2.0f ) ) - static_cast<double>( z_ndc );
+
+        resolution = std::max( resolution, 0.5 * ulp_z );
+    }
+
+    return resolution;
+}
+
+double AnalyticDepthModel::minGap( const double z_vcs ) const
+{
+    const double gap_code = depthResolution( depth( z_vcs ) ) / absDerivative( z_vcs );
+
+    const float  z       = static_cast<float>( fabs( z_vcs ) );
+    const double gap_ulp = static_cast<double>( nextafterf( z, INFINITY ) ) - static_cast<double>( z );
+
+    return std::max( gap_code, gap_ulp );
+}
+
+} // namespace DepthTest
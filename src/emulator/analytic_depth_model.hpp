@@ -0,0 +1,65 @@
+#ifndef __DEPTH_TEST_ANALYTIC_DEPTH_MODEL_HPP__
+#define __DEPTH_TEST_ANALYTIC_DEPTH_MODEL_HPP__
+
+#include "depth_tester.hpp"
+
+namespace DepthTest {
+
+// Closed forms of the depth functions F(z), |dF(z)/dz|, and the theoretical
+// minimum gap, ported from python/vcs_to_scs_functions.py. F(z) and
+// |dF(z)/dz| are the ones of the depth encoding in depth_encoding.hpp.
+//
+// The minimum gap is the step of the depth buffer format at F(z) over
+// |dF(z)/dz|, and no less than the float spacing of the planes at z.
+// It does not model the rounding of the shaders, so the gap found by the
+// tests is typically within a factor of 2 of it.
+//
+// Under the reversed clip conventions F(z) is 1 - F(z) of the encoding.
+// With CLIP_REVERSED_DEPTH_RANGE the step is also no less than the float
+// spacing of the normalized z in [-1, 1], so the float depth gains nothing
+// near 0 there.
+//
+// z_vcs is the z in the view coordinate system, i.e. negative in front of
+// the camera.
+class AnalyticDepthModel {
+
+  public:
+
+    AnalyticDepthModel(
+        const DepthTester::DepthTestType  depth_test_type,
+        const DepthTester::DepthFormat    depth_format,
+        const float                       near,
+        const float                       far,
+        const float                       param_c,
+        const DepthTester::ClipConvention clip_convention = DepthTester::CLIP_STANDARD
+    );
+
+    // F(z), the depth in [0, 1] written to the depth buffer.
+    double depth( const double z_vcs ) const;
+
+    // |dF(z)/dz|
+    double absDerivative( const double z_vcs ) const;
+
+    // the difference of the depth between the adjacent codes at depth.
+    double depthResolution( const double depth ) const;
+
+    // the smallest gap between two planes around z_vcs that get different
+    // depth codes.
+    double minGap( const double z_vcs ) const;
+
+  private:
+
+    const DepthTester::DepthTestType  m_depth_test_type;
+    const DepthTester::DepthFormat    m_depth_format;
+    const double                      m_near;
+    const double                      m_far;
+    const double                      m_param_c;
+    const DepthTester::ClipConvention m_clip_convention;
+
+    double ( *m_depth )( const double, const double, const double, const double );
+    double ( *m_abs_derivative )( const double, const double, const double, const double );
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_ANALYTIC_DEPTH_MODEL_HPP__*/
@@ -0,0 +1,222 @@
+#ifndef __DEPTH_TEST_CROSS_CHECK_TESTER_HPP__
+#define __DEPTH_TEST_CROSS_CHECK_TESTER_HPP__
+
+#include <iostream>
+#include <vector>
+
+#include "depth_tester.hpp"
+
+namespace DepthTest {
+
+// Runs every batch on two testers, e.g. SquareRenderer and
+// DepthPipelineEmulator, and records the cases where they disagree.
+// The results of the reference are returned.
+class CrossCheckTester : public DepthTester {
+
+  public:
+
+    static constexpr int MAX_RECORDED_MISMATCHES = 20;
+
+    explicit CrossCheckTester( DepthTester& reference, DepthTester& candidate ) noexcept
+        :m_reference      { reference }
+        ,m_candidate      { candidate }
+        ,m_num_tested     { 0 }
+        ,m_num_mismatches { 0 }
+        ,m_num_codes_tested    { 0 }
+        ,m_num_code_mismatches { 0 }
+        ,m_num_stacks_tested    { 0 }
+        ,m_num_stack_mismatches { 0 }
+    {
+    }
+
+    void attachThread() override
+    {
+        m_reference.attachThread();
+        m_candidate.attachThread();
+    }
+
+    void detachThread() override
+    {
+        m_reference.detachThread();
+        m_candidate.detachThread();
+    }
+
+    void testBatch(
+        const std::vector< TestCase >& test_cases,
+        std::vector< TestResult >&     results
+    ) override {
+
+        m_reference.testBatch( test_cases, results );
+        m_candidate.testBatch( test_cases, m_candidate_results );
+
+        for ( size_t i = 0; i < test_cases.size(); i++ ) {
+
+            const auto& r = results[i];
+            const auto& c = m_candidate_results[i];
+
+            if (    r.m_plane_1_detected != c.m_plane_1_detected
+                 || r.m_plane_2_detected != c.m_plane_2_detected ) {
+
+                if ( m_num_mismatches < MAX_RECORDED_MISMATCHES ) {
+                    m_mismatches.push_back( test_cases[i] );
+                }
+                m_num_mismatches++;
+            }
+        }
+
+        m_num_tested += test_cases.size();
+    }
+
+    // the mismatches are counted and recorded as the ones of testBatch().
+    void testLayers(
+        const std::vector< Layer >&     layers,
+        const std::vector< PlanePair >& pairs,
+        std::vector< TestResult >&      results
+    ) override {
+
+        m_reference.testLayers( layers, pairs, results );
+        m_candidate.testLayers( layers, pairs, m_candidate_results );
+
+        for ( size_t i = 0; i < results.size(); i++ ) {
+
+            const auto& r = results[i];
+            const auto& c = m_candidate_results[i];
+
+            if (    r.m_plane_1_detected != c.m_plane_1_detected
+                 || r.m_plane_2_detected != c.m_plane_2_detected ) {
+
+                if ( m_num_mismatches < MAX_RECORDED_MISMATCHES ) {
+
+                    const auto& layer = layers[ i / pairs.size() ];
+                    const auto& pair  = pairs [ i % pairs.size() ];
+
+                    m_mismatches.push_back( { layer.m_near, layer.m_far, layer.m_param_c, pair.m_plane_1, pair.m_plane_2 } );
+                }
+                m_num_mismatches++;
+            }
+        }
+
+        m_num_tested += results.size();
+    }
+
+    void readDepthCodes(
+        const float                 near,
+        const float                 far,
+        const float                 param_c,
+        const std::vector< float >& planes,
+        std::vector< uint32_t >&    codes
+    ) override {
+
+        m_reference.readDepthCodes( near, far, param_c, planes, codes );
+        m_candidate.readDepthCodes( near, far, param_c, planes, m_candidate_codes );
+
+        for ( size_t i = 0; i < planes.size(); i++ ) {
+
+            if ( codes[i] != m_candidate_codes[i] ) {
+
+                if ( m_num_code_mismatches < MAX_RECORDED_MISMATCHES ) {
+                    m_code_mismatches.push_back( { near, far, param_c, planes[i], codes[i], m_candidate_codes[i] } );
+                }
+                m_num_code_mismatches++;
+            }
+        }
+
+        m_num_codes_tested += planes.size();
+    }
+
+    void testStacks(
+        const float                 near,
+        const float                 far,
+        const float                 param_c,
+        const StackDepthFunc        depth_func,
+        const int                   num_planes,
+        const std::vector< float >& planes,
+        std::vector< int >&         winners
+    ) override {
+
+        m_reference.testStacks( near, far, param_c, depth_func, num_planes, planes, winners );
+        m_candidate.testStacks( near, far, param_c, depth_func, num_planes, planes, m_candidate_winners );
+
+        for ( size_t i = 0; i < winners.size(); i++ ) {
+
+            if ( winners[i] != m_candidate_winners[i] ) {
+                m_num_stack_mismatches++;
+            }
+        }
+
+        m_num_stacks_tested += winners.size();
+    }
+
+    long long numTested() const
+    {
+        return m_num_tested;
+    }
+
+    long long numMismatches() const
+    {
+        return m_num_mismatches;
+    }
+
+    void report( std::ostream& os ) const
+    {
+        os << "Cross check: " << m_num_mismatches << " mismatches in " << m_num_tested << " test cases.\n";
+
+        for ( const auto& m : m_mismatches ) {
+
+            os << "    near: " << m.m_near << " far: " << m.m_far << " c: " << m.m_param_c
+               << " plane_1: " << m.m_plane_1 << " plane_2: " << m.m_plane_2 << "\n";
+        }
+
+        if ( m_num_codes_tested > 0 ) {
+
+            os << "Cross check: " << m_num_code_mismatches << " mismatches in " << m_num_codes_tested << " depth codes.\n";
+
+            for ( const auto& m : m_code_mismatches ) {
+
+                os << "    near: " << m.m_near << " far: " << m.m_far << " c: " << m.m_param_c
+                   << " plane: " << m.m_plane << " reference: " << m.m_reference_code
+                   << " candidate: " << m.m_candidate_code << "\n";
+            }
+        }
+
+        if ( m_num_stacks_tested > 0 ) {
+
+            os << "Cross check: " << m_num_stack_mismatches << " mismatches in " << m_num_stacks_tested << " stacks.\n";
+        }
+    }
+
+  private:
+
+    struct CodeMismatch {
+        float    m_near;
+        float    m_far;
+        float    m_param_c;
+        float    m_plane;
+        uint32_t m_reference_code;
+        uint32_t m_candidate_code;
+    };
+
+    DepthTester& m_reference;
+    DepthTester& m_candidate;
+
+    long long    m_num_tested;
+    long long    m_num_mismatches;
+
+    std::vector< TestCase >   m_mismatches;
+    std::vector< TestResult > m_candidate_results;
+
+    long long    m_num_codes_tested;
+    long long    m_num_code_mismatches;
+
+    std::vector< CodeMismatch > m_code_mismatches;
+    std::vector< uint32_t >     m_candidate_codes;
+
+    long long    m_num_stacks_tested;
+    long long    m_num_stack_mismatches;
+
+    std::vector< int >          m_candidate_winners;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_CROSS_CHECK_TESTER_HPP__*/
@@ -0,0 +1,467 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#include "depth_encoding.hpp"
+#include "depth_pipeline_emulator.hpp"
+
+namespace DepthTest {
+
+// vector extension of GCC and Clang.
+typedef float   FloatLanes __attribute__(( vector_size( DepthPipelineEmulator::LANES * sizeof(float)   ) ));
+typedef int32_t IntLanes   __attribute__(( vector_size( DepthPipelineEmulator::LANES * sizeof(int32_t) ) ));
+
+static inline FloatLanes splat( const float v )
+{
+    FloatLanes lanes;
+    for ( int i = 0; i < DepthPipelineEmulator::LANES; i++ ) {
+        lanes[i] = v;
+    }
+    return lanes;
+}
+
+static inline IntLanes splat( const int32_t v )
+{
+    IntLanes lanes;
+    for ( int i = 0; i < DepthPipelineEmulator::LANES; i++ ) {
+        lanes[i] = v;
+    }
+    return lanes;
+}
+
+// mask is all ones or all zeros per lane, as produced by the comparisons.
+static inline IntLanes select( const IntLanes mask, const IntLanes a, const IntLanes b )
+{
+    return ( mask & a ) | ( ~mask & b );
+}
+
+static inline FloatLanes select( const IntLanes mask, const FloatLanes a, const FloatLanes b )
+{
+    return (FloatLanes)select( mask, (IntLanes)a, (IntLanes)b );
+}
+
+// NaN goes to 0 as it fails all the comparisons, like max( v, 0 ) of the
+// clamp on llvmpipe, so that it never reaches the conversion to the codes.
+static inline FloatLanes clamp01( const FloatLanes v )
+{
+    const auto zero = splat( 0.0f );
+    const auto one  = splat( 1.0f );
+
+    return select( v >= zero, select( v > one, one, v ), zero );
+}
+
+// round to nearest even for 0 <= v <= 2^24.
+// values at or above 2^23 are already integers.
+static inline FloatLanes roundToNearest( const FloatLanes v )
+{
+    const auto magic   = splat( 8388608.0f ); // 2^23
+    const auto rounded = ( v + magic ) - magic;
+
+    return select( v < magic, rounded, v );
+}
+
+// the z row of the projection of SquareRenderer, glm::frustum() or the
+// reversed one. the x and y terms of the clip z are zero.
+static inline void projectionZ(
+    const DepthTester::ClipConvention clip_convention,
+    const float                       near,
+    const float                       far,
+    float&                            P22,
+    float&                            P32
+) {
+    if ( clip_convention == DepthTester::CLIP_REVERSED ) {
+
+        P22 = near / ( far - near );
+        P32 = ( far * near ) / ( far - near );
+    }
+    else {
+        P22 = -( far + near ) / ( far - near );
+        P32 = -( 2.0f * far * near ) / ( far - near );
+    }
+}
+
+static inline void projectionZ(
+    const DepthTester::ClipConvention clip_convention,
+    const FloatLanes                  near,
+    const FloatLanes                  far,
+    FloatLanes&                       P22,
+    FloatLanes&                       P32
+) {
+    if ( clip_convention == DepthTester::CLIP_REVERSED ) {
+
+        P22 = near / ( far - near );
+        P32 = ( far * near ) / ( far - near );
+    }
+    else {
+        P22 = -( far + near ) / ( far - near );
+        P32 = -( splat( 2.0f ) * far * near ) / ( far - near );
+    }
+}
+
+// GL_LESS, or GL_GREATER under the reversed clip conventions.
+static inline IntLanes passesDepthTest(
+    const DepthTester::ClipConvention clip_convention,
+    const IntLanes                    code,
+    const IntLanes                    stored
+) {
+    if ( clip_convention == DepthTester::CLIP_STANDARD ) {
+        return code < stored;
+    }
+    return code > stored;
+}
+
+// the codes of the planes in the depth buffer format, and whether they
+// are inside the clip volume. the plane is at z = -plane in VCS.
+template< class Encoding >
+static inline IntLanes depthCodeLanes(
+    const DepthTester::DepthFormat    depth_format,
+    const DepthTester::ClipConvention clip_convention,
+    const FloatLanes                  P22,
+    const FloatLanes                  P32,
+    const float                       depth_params[][2],
+    const FloatLanes                  plane,
+    IntLanes&                         inside
+) {
+    // M translates the square to z = -plane. V is identity.
+    const auto z      = splat( -1.0f ) * plane;
+    const auto w      = splat( -1.0f ) * z;
+    const auto z_clip = P22 * z + P32;
+
+    FloatLanes depth;
+
+    switch( clip_convention ) {
+
+      case DepthTester::CLIP_REVERSED:
+        // the clip z is in [0, w], and the depth range [0, 1] takes the
+        // normalized z as it is.
+        inside = ( z_clip >= splat( 0.0f ) ) & ( z_clip <= w );
+        depth  = z_clip * ( splat( 1.0f ) / w );
+        break;
+
+      case DepthTester::CLIP_REVERSED_DEPTH_RANGE:
+        // the viewport transform into glDepthRange( 1, 0 ).
+        inside = ( z_clip >= -w ) & ( z_clip <= w );
+        depth  = z_clip * ( splat( 1.0f ) / w ) * splat( -0.5f ) + splat( 0.5f );
+        break;
+
+      default:
+        inside = ( z_clip >= -w ) & ( z_clip <= w );
+
+        // inlined per encoding. the compiler vectorizes the perspective one.
+        // the log depth types stay per lane on std::log2(), as a vector log2
+        // would not round the same as it, and the emulator has to match the
+        // scalar depthCodeOf() bit by bit.
+        for ( int i = 0; i < DepthPipelineEmulator::LANES; i++ ) {
+            depth[i] = Encoding::shaderDepth( z[i], z_clip[i], w[i], depth_params[i] );
+        }
+    }
+
+    depth = clamp01( depth );
+
+    switch( depth_format ) {
+
+      case DepthTester::DEPTH_D16:
+        return __builtin_convertvector( roundToNearest( depth * splat( 65535.0f ) ), IntLanes );
+
+      case DepthTester::DEPTH_D32F:
+        // non-negative floats compare in the same order as their bits.
+        return (IntLanes)depth;
+
+      default:
+        return __builtin_convertvector( roundToNearest( depth * splat( 16777215.0f ) ), IntLanes );
+    }
+}
+
+DepthPipelineEmulator::DepthPipelineEmulator(
+    const DepthTestType  depth_test_type,
+    const DepthFormat    depth_format,
+    const ClipConvention clip_convention
+)
+    :m_depth_test_type { depth_test_type }
+    ,m_depth_format    { depth_format }
+    ,m_clip_convention { clip_convention }
+    ,m_depth_code      { nullptr }
+    ,m_test_lanes      { nullptr }
+    ,m_read_depth_codes{ nullptr }
+{
+    if ( m_clip_convention != CLIP_STANDARD && m_depth_test_type != PERSPECTIVE ) {
+
+        throw std::runtime_error( "the reversed clip conventions are for the perspective depth only" );
+    }
+
+    visitDepthEncoding( m_depth_test_type, [ this ]( auto encoding ) {
+
+        using Encoding = decltype( encoding );
+
+        m_depth_code = &DepthPipelineEmulator::depthCodeOf< Encoding >;
+        m_test_lanes = &DepthPipelineEmulator::testLanes< Encoding >;
+
+        m_read_depth_codes = &DepthPipelineEmulator::readDepthCodesOf< Encoding >;
+    } );
+}
+
+DepthPipelineEmulator::~DepthPipelineEmulator()
+{
+}
+
+uint32_t DepthPipelineEmulator::clearCode() const
+{
+    if ( m_clip_convention != CLIP_STANDARD ) {
+        return 0;
+    }
+
+    switch( m_depth_format ) {
+
+      case DEPTH_D16:
+        return 0xffff;
+
+      case DEPTH_D32F:
+        {
+            const float one = 1.0f;
+            uint32_t    code;
+            memcpy( &code, &one, sizeof(code) );
+            return code;
+        }
+
+      default:
+        return 0xffffff;
+    }
+}
+
+bool DepthPipelineEmulator::depthCode(
+    const float near,
+    const float far,
+    const float param_c,
+    const float plane,
+    uint32_t&   code
+) const {
+    return ( this->*m_depth_code )( near, far, param_c, plane, code );
+}
+
+template< class Encoding >
+bool DepthPipelineEmulator::depthCodeOf(
+    const float near,
+    const float far,
+    const float param_c,
+    const float plane,
+    uint32_t&   code
+) const {
+    // M translates the square to z = -plane. V is identity.
+    const float z = -1.0f * plane;
+    const float w = -1.0f * z;
+
+    float P22, P32;
+    projectionZ( m_clip_convention, near, far, P22, P32 );
+
+    const float z_clip = P22 * z + P32;
+    const float z_min  = ( m_clip_convention == CLIP_REVERSED ) ? 0.0f : -w;
+
+    if ( z_clip < z_min || w < z_clip ) {
+        return false;
+    }
+
+    float depth_params[2];
+    Encoding::params( near, far, param_c, depth_params );
+
+    float depth;
+
+    switch( m_clip_convention ) {
+
+      case CLIP_REVERSED:
+        depth = z_clip * ( 1.0f / w );
+        break;
+
+      case CLIP_REVERSED_DEPTH_RANGE:
+        depth = z_clip * ( 1.0f / w ) * -0.5f + 0.5f;
+        break;
+
+      default:
+        depth = Encoding::shaderDepth( z, z_clip, w, depth_params );
+    }
+
+    depth = std::min( 1.0f, std::max( 0.0f, depth ) );
+
+    switch( m_depth_format ) {
+
+      case DEPTH_D16:
+        code = static_cast< uint32_t >( std::nearbyint( depth * 65535.0f ) );
+        break;
+
+      case DEPTH_D32F:
+        memcpy( &code, &depth, sizeof(code) );
+        break;
+
+      default:
+        code = static_cast< uint32_t >( std::nearbyint( depth * 16777215.0f ) );
+    }
+
+    return ( m_clip_convention == CLIP_STANDARD ) ? code < clearCode() : code > clearCode();
+}
+
+void DepthPipelineEmulator::readDepthCodes(
+    const float                 near,
+    const float                 far,
+    const float                 param_c,
+    const std::vector< float >& planes,
+    std::vector< uint32_t >&    codes
+) {
+    ( this->*m_read_depth_codes )( near, far, param_c, planes, codes );
+}
+
+template< class Encoding >
+void DepthPipelineEmulator::readDepthCodesOf(
+    const float                 near,
+    const float                 far,
+    const float                 param_c,
+    const std::vector< float >& planes,
+    std::vector< uint32_t >&    codes
+) const {
+    const size_t num_planes = planes.size();
+
+    codes.resize( num_planes );
+
+    if ( num_planes == 0 ) {
+        return;
+    }
+
+    // the same values as depthCode() in all the lanes.
+    const auto near_lanes = splat( near );
+    const auto far_lanes  = splat( far );
+
+    FloatLanes P22, P32;
+    projectionZ( m_clip_convention, near_lanes, far_lanes, P22, P32 );
+
+    float depth_params[ LANES ][2];
+
+    for ( int i = 0; i < LANES; i++ ) {
+
+        Encoding::params( near, far, param_c, depth_params[i] );
+    }
+
+    const auto clear = splat( static_cast< int32_t >( clearCode() ) );
+
+    for ( size_t i = 0; i < num_planes; i += LANES ) {
+
+        // the last group is padded with copies of the last plane.
+        FloatLanes plane;
+
+        for ( int j = 0; j < LANES; j++ ) {
+
+            plane[j] = planes[ std::min( i + j, num_planes - 1 ) ];
+        }
+
+        IntLanes   inside;
+        const auto code    = depthCodeLanes< Encoding >(
+                                 m_depth_format, m_clip_convention, P22, P32, depth_params, plane, inside );
+        const auto visible = select( inside & passesDepthTest( m_clip_convention, code, clear ), code, clear );
+
+        for ( int j = 0; j < LANES && i + j < num_planes; j++ ) {
+
+            codes[ i + j ] = static_cast< uint32_t >( visible[j] );
+        }
+    }
+}
+
+void DepthPipelineEmulator::testStacks(
+    const float                 near,
+    const float                 far,
+    const float                 param_c,
+    const StackDepthFunc        depth_func,
+    const int                   num_planes,
+    const std::vector< float >& planes,
+    std::vector< int >&         winners
+) {
+    // the default orders the planes by their codes as GL_LESS does.
+    if ( m_clip_convention != CLIP_STANDARD ) {
+
+        throw std::runtime_error( "the stack test is for the standard clip convention only" );
+    }
+
+    DepthTester::testStacks( near, far, param_c, depth_func, num_planes, planes, winners );
+}
+
+void DepthPipelineEmulator::testBatch(
+    const std::vector< TestCase >& test_cases,
+    std::vector< TestResult >&     results
+) {
+    const int num_test_cases = static_cast<int>( test_cases.size() );
+
+    results.resize( test_cases.size() );
+
+    int i = 0;
+
+    for ( ; i + LANES <= num_test_cases; i += LANES ) {
+
+        ( this->*m_test_lanes )( &test_cases[i], &results[i] );
+    }
+
+    if ( i < num_test_cases ) {
+
+        // pad the last group with copies of the last case.
+        TestCase   tail_cases  [ LANES ];
+        TestResult tail_results[ LANES ];
+
+        for ( int j = 0; j < LANES; j++ ) {
+
+            tail_cases[j] = test_cases[ std::min( i + j, num_test_cases - 1 ) ];
+        }
+
+        ( this->*m_test_lanes )( tail_cases, tail_results );
+
+        for ( int j = 0; i + j < num_test_cases; j++ ) {
+
+            results[ i + j ] = tail_results[j];
+        }
+    }
+}
+
+template< class Encoding >
+void DepthPipelineEmulator::testLanes( const TestCase* test_cases, TestResult* results ) const
+{
+    FloatLanes near, far, param_c, plane_1, plane_2;
+
+    for ( int i = 0; i < LANES; i++ ) {
+
+        near   [i] = test_cases[i].m_near;
+        far    [i] = test_cases[i].m_far;
+        param_c[i] = test_cases[i].m_param_c;
+        plane_1[i] = test_cases[i].m_plane_1;
+        plane_2[i] = test_cases[i].m_plane_2;
+    }
+
+    FloatLanes P22, P32;
+    projectionZ( m_clip_convention, near, far, P22, P32 );
+
+    // the uniforms as set in SquareRenderer::test().
+    float depth_params[ LANES ][2];
+
+    for ( int i = 0; i < LANES; i++ ) {
+
+        Encoding::params( near[i], far[i], param_c[i], depth_params[i] );
+    }
+
+    const FloatLanes planes[2] = { plane_1, plane_2 };
+    IntLanes         inside[2];
+    IntLanes         codes [2];
+
+    for ( int p = 0; p < 2; p++ ) {
+
+        codes[p] = depthCodeLanes< Encoding >(
+                       m_depth_format, m_clip_convention, P22, P32, depth_params, planes[p], inside[p] );
+    }
+
+    // GL_LESS or GL_GREATER against the cleared buffer, plane_1 first.
+    const auto clear     = splat( static_cast< int32_t >( clearCode() ) );
+    const auto visible_1 = inside[0] & passesDepthTest( m_clip_convention, codes[0], clear );
+    const auto depth_1   = select( visible_1, codes[0], clear );
+    const auto visible_2 = inside[1] & passesDepthTest( m_clip_convention, codes[1], depth_1 );
+
+    for ( int i = 0; i < LANES; i++ ) {
+
+        results[i].m_plane_1_detected = visible_1[i] != 0 && visible_2[i] == 0;
+        results[i].m_plane_2_detected = visible_2[i] != 0;
+    }
+}
+
+} // namespace DepthTest
@@ -0,0 +1,120 @@
+#ifndef __DEPTH_TEST_DEPTH_PIPELINE_EMULATOR_HPP__
+#define __DEPTH_TEST_DEPTH_PIPELINE_EMULATOR_HPP__
+
+#include <cstdint>
+#include <vector>
+
+#include "depth_tester.hpp"
+
+namespace DepthTest {
+
+// CPU emulation of the depth pipeline of SquareRenderer::test().
+//
+// It reproduces the single precision operations of the shaders, i.e.
+// shaderDepth() of the depth encoding in depth_encoding.hpp, the clipping,
+// the viewport transform to the default depth range [0, 1], the
+// quantization into the depth buffer format, and the GL_LESS comparison
+// against the cleared buffer, or the GL_GREATER comparison under the
+// reversed clip conventions.
+//
+// The conventions follow the common hardware behavior, which Mesa llvmpipe
+// reproduces exactly for the perspective depth:
+// - no FMA contraction in the matrix product,
+// - the perspective division is done by multiplying 1/w,
+// - fixed-point depth is round-to-nearest( z * ( 2^N - 1 ) ) in float.
+// The log depth types depend on the precision of log() on the driver.
+// The emulator takes it as log2() of the C library scaled by ln(2), which
+// is how GPUs implement it, but the last bits of log2() vary by driver.
+//
+// The test cases are processed in groups of LANES with the vector
+// extension of GCC and Clang, which is lowered to SSE/AVX or NEON.
+class DepthPipelineEmulator : public DepthTester {
+
+  public:
+
+    static constexpr int LANES = 8;
+
+    // the reversed clip conventions are for PERSPECTIVE only.
+    explicit DepthPipelineEmulator(
+        const DepthTestType  depth_test_type,
+        const DepthFormat    depth_format    = DEPTH_D24,
+        const ClipConvention clip_convention = CLIP_STANDARD
+    );
+
+    ~DepthPipelineEmulator() override;
+
+    void testBatch(
+        const std::vector< TestCase >& test_cases,
+        std::vector< TestResult >&     results
+    ) override;
+
+    void readDepthCodes(
+        const float                 near,
+        const float                 far,
+        const float                 param_c,
+        const std::vector< float >& planes,
+        std::vector< uint32_t >&    codes
+    ) override;
+
+    // the default of DepthTester for the standard clip convention only.
+    void testStacks(
+        const float                 near,
+        const float                 far,
+        const float                 param_c,
+        const StackDepthFunc        depth_func,
+        const int                   num_planes,
+        const std::vector< float >& planes,
+        std::vector< int >&         winners
+    ) override;
+
+    // scalar reference of one plane drawn alone.
+    // returns false if the plane is clipped away or does not pass the
+    // depth test against the cleared buffer.
+    bool depthCode(
+        const float near,
+        const float far,
+        const float param_c,
+        const float plane,
+        uint32_t&   code
+    ) const;
+
+    uint32_t clearCode() const;
+
+  private:
+
+    template< class Encoding >
+    bool depthCodeOf(
+        const float near,
+        const float far,
+        const float param_c,
+        const float plane,
+        uint32_t&   code
+    ) const;
+
+    template< class Encoding >
+    void testLanes( const TestCase* test_cases, TestResult* results ) const;
+
+    template< class Encoding >
+    void readDepthCodesOf(
+        const float                 near,
+        const float                 far,
+        const float                 param_c,
+        const std::vector< float >& planes,
+        std::vector< uint32_t >&    codes
+    ) const;
+
+    const DepthTestType  m_depth_test_type;
+    const DepthFormat    m_depth_format;
+    const ClipConvention m_clip_convention;
+
+    // the specializations for the depth encoding, chosen at construction.
+    bool ( DepthPipelineEmulator::*m_depth_code )(
+        const float, const float, const float, const float, uint32_t& ) const;
+    void ( DepthPipelineEmulator::*m_test_lanes )( const TestCase*, TestResult* ) const;
+    void ( DepthPipelineEmulator::*m_read_depth_codes )(
+        const float, const float, const float, const std::vector< float >&, std::vector< uint32_t >& ) const;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_DEPTH_PIPELINE_EMULATOR_HPP__*/
@@ -0,0 +1,132 @@
+#ifndef __DEPTH_TEST_CONTEXT_BOUND_TESTER_HPP__
+#define __DEPTH_TEST_CONTEXT_BOUND_TESTER_HPP__
+
+#include <memory>
+
+#include "headless_context.hpp"
+#include "square_renderer.hpp"
+
+namespace DepthTest {
+
+// SquareRenderer with its own OpenGL context, so that each worker thread
+// of BatchTester can render independently.
+// The context is made current on the worker thread in attachThread().
+// The testers of the different depth types used on the same thread can
+// share one context.
+class ContextBoundTester : public DepthTester {
+
+  public:
+
+    explicit ContextBoundTester(
+        const DepthTestType  depth_test_type,
+        const DepthFormat    depth_format    = DEPTH_D24,
+        const ClipConvention clip_convention = CLIP_STANDARD
+    )
+        :ContextBoundTester{ std::make_shared< HeadlessContext >(), depth_test_type, depth_format, clip_convention }
+    {
+    }
+
+    explicit ContextBoundTester(
+        std::shared_ptr< HeadlessContext > context,
+        const DepthTestType                depth_test_type,
+        const DepthFormat                  depth_format    = DEPTH_D24,
+        const ClipConvention               clip_convention = CLIP_STANDARD
+    )
+        :m_context { std::move( context ) }
+    {
+        m_context->makeCurrent();
+        m_renderer = std::make_unique< SquareRenderer >( depth_test_type, depth_format, clip_convention );
+        m_context->releaseCurrent();
+    }
+
+    ~ContextBoundTester() override
+    {
+        // the GL objects must be deleted in their context.
+        m_context->makeCurrent();
+        m_renderer.reset();
+        m_context->releaseCurrent();
+    }
+
+    void attachThread() override
+    {
+        m_context->makeCurrent();
+    }
+
+    void detachThread() override
+    {
+        m_context->releaseCurrent();
+    }
+
+    void testBatch(
+        const std::vector< TestCase >& test_cases,
+        std::vector< TestResult >&     results
+    ) override {
+
+        m_renderer->testBatch( test_cases, results );
+    }
+
+    void readDepthCodes(
+        const float                 near,
+        const float                 far,
+        const float                 param_c,
+        const std::vector< float >& planes,
+        std::vector< uint32_t >&    codes
+    ) override {
+
+        m_renderer->readDepthCodes( near, far, param_c, planes, codes );
+    }
+
+    void testStacks(
+        const float                 near,
+        const float                 far,
+        const float                 param_c,
+        const StackDepthFunc        depth_func,
+        const int                   num_planes,
+        const std::vector< float >& planes,
+        std::vector< int >&         winners
+    ) override {
+
+        m_renderer->testStacks( near, far, param_c, depth_func, num_planes, planes, winners );
+    }
+
+    void testLayers(
+        const std::vector< Layer >&     layers,
+        const std::vector< PlanePair >& pairs,
+        std::vector< TestResult >&      results
+    ) override {
+
+        m_renderer->testLayers( layers, pairs, results );
+    }
+
+    void submitBatch(
+        const std::vector< TestCase >& test_cases,
+        Callback                       callback
+    ) override {
+
+        m_renderer->submitBatch( test_cases, std::move( callback ) );
+    }
+
+    int pollCompleted( const bool wait ) override
+    {
+        return m_renderer->pollCompleted( wait );
+    }
+
+    int numInFlight() const override
+    {
+        return m_renderer->numInFlight();
+    }
+
+    SquareRenderer& renderer()
+    {
+        return *m_renderer;
+    }
+
+  private:
+
+    std::shared_ptr< HeadlessContext > m_context;
+    std::unique_ptr< SquareRenderer >  m_renderer;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_CONTEXT_BOUND_TESTER_HPP__*/
@@ -0,0 +1,348 @@
+#include <string>
+#include <mutex>
+#include <stdexcept>
+
+#include "headless_context.hpp"
+
+namespace DepthTest {
+
+// The display connection (EGL) and the library (GLFW) are shared by all the
+// contexts of the process, and torn down with the last one.
+static std::mutex s_mutex;
+static int        s_num_contexts = 0;
+static bool       s_glew_initialized = false;
+
+void HeadlessContext::initGLEW()
+{
+    if ( s_glew_initialized ) {
+        return;
+    }
+
+    glewExperimental = GL_TRUE;
+
+    const auto err = glewInit();
+
+#if defined( DEPTH_TEST_CONTEXT_OSMESA )
+
+    // GLEW built for GLX loads the entry points with glXGetProcAddress(),
+    // which do not reach the OSMesa context, with or without X.
+    // It has to be built with GLEW_OSMESA to load them with
+    // OSMesaGetProcAddress().
+    const auto osmesa_entry = reinterpret_cast< void* >( OSMesaGetProcAddress( "glGenVertexArrays" ) );
+    const auto glew_entry   = reinterpret_cast< void* >( glGenVertexArrays );
+
+    if ( err != GLEW_OK || glew_entry == nullptr || glew_entry != osmesa_entry ) {
+
+        throw std::runtime_error( "glewInit() failed. OSMesa needs GLEW built with GLEW_OSMESA." );
+    }
+
+#else
+
+    // GLEW built for GLX reports GLEW_ERROR_NO_GLX_DISPLAY without X,
+    // after the GL entry points themselves have been loaded.
+    if ( err != GLEW_OK && err != GLEW_ERROR_NO_GLX_DISPLAY ) {
+
+        throw std::runtime_error( "glewInit() failed." );
+    }
+
+#endif
+
+    s_glew_initialized = true;
+}
+
+#if defined( DEPTH_TEST_CONTEXT_EGL )
+
+static EGLDisplay s_display = EGL_NO_DISPLAY;
+
+static bool hasExtension( const char* extensions, const char* name )
+{
+    if ( extensions == nullptr ) {
+        return false;
+    }
+
+    const std::string list{ extensions };
+    const std::string word{ name };
+
+    size_t pos = 0;
+
+    while ( ( pos = list.find( word, pos ) ) != std::string::npos ) {
+
+        const auto end = pos + word.size();
+
+        if (    ( pos == 0 || list[ pos - 1 ] == ' ' )
+             && ( end == list.size() || list[ end ] == ' ' ) ) {
+
+            return true;
+        }
+        pos = end;
+    }
+    return false;
+}
+
+static EGLDisplay openDisplay()
+{
+    const char* client_extensions = eglQueryString( EGL_NO_DISPLAY, EGL_EXTENSIONS );
+
+    if ( hasExtension( client_extensions, "EGL_MESA_platform_surfaceless" ) ) {
+
+        auto get_platform_display = reinterpret_cast< PFNEGLGETPLATFORMDISPLAYEXTPROC >(
+            eglGetProcAddress( "eglGetPlatformDisplayEXT" )
+        );
+
+        if ( get_platform_display != nullptr ) {
+
+            auto display = get_platform_display( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr );
+
+            if ( display != EGL_NO_DISPLAY ) {
+                return display;
+            }
+        }
+    }
+
+    return eglGetDisplay( EGL_DEFAULT_DISPLAY );
+}
+
+// terminates the display when no context uses it, including when the first
+// context fails to be created.
+static void releaseDisplay()
+{
+    if ( s_num_contexts == 0 && s_display != EGL_NO_DISPLAY ) {
+
+        eglTerminate( s_display );
+        s_display = EGL_NO_DISPLAY;
+    }
+}
+
+HeadlessContext::HeadlessContext()
+    :m_display { EGL_NO_DISPLAY }
+    ,m_context { EGL_NO_CONTEXT }
+{
+    std::lock_guard< std::mutex > lock( s_mutex );
+
+    if ( s_num_contexts == 0 ) {
+
+        s_display = openDisplay();
+
+        EGLint major;
+        EGLint minor;
+
+        if ( s_display == EGL_NO_DISPLAY || !eglInitialize( s_display, &major, &minor ) ) {
+
+            releaseDisplay();
+            throw std::runtime_error( "eglInitialize() failed." );
+        }
+    }
+
+    m_display = s_display;
+
+    if ( !eglBindAPI( EGL_OPENGL_API ) ) {
+
+        releaseDisplay();
+        throw std::runtime_error( "eglBindAPI( EGL_OPENGL_API ) failed." );
+    }
+
+    const EGLint config_attribs[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+
+    EGLConfig config     = nullptr;
+    EGLint    num_config = 0;
+
+    eglChooseConfig( m_display, config_attribs, &config, 1, &num_config );
+
+    if ( num_config == 0 ) {
+
+        // the surfaceless platform exposes no configs. we do not need one
+        // as we render only into framebuffer objects.
+        config = EGL_NO_CONFIG_KHR;
+    }
+
+    const EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION,       3,
+        EGL_CONTEXT_MINOR_VERSION,       3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    m_context = eglCreateContext( m_display, config, EGL_NO_CONTEXT, context_attribs );
+
+    if ( m_context == EGL_NO_CONTEXT ) {
+
+        releaseDisplay();
+        throw std::runtime_error( "eglCreateContext() failed." );
+    }
+
+    s_num_contexts++;
+
+    makeCurrent();
+
+    initGLEW();
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    std::lock_guard< std::mutex > lock( s_mutex );
+
+    eglMakeCurrent( m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+    eglDestroyContext( m_display, m_context );
+
+    s_num_contexts--;
+
+    releaseDisplay();
+}
+
+void HeadlessContext::makeCurrent()
+{
+    // the rendering API is per-thread state in EGL.
+    eglBindAPI( EGL_OPENGL_API );
+
+    if ( !eglMakeCurrent( m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context ) ) {
+
+        throw std::runtime_error( "eglMakeCurrent() failed." );
+    }
+}
+
+void HeadlessContext::releaseCurrent()
+{
+    eglMakeCurrent( m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+}
+
+const char* HeadlessContext::backendName()
+{
+    return "EGL";
+}
+
+#elif defined( DEPTH_TEST_CONTEXT_OSMESA )
+
+HeadlessContext::HeadlessContext()
+    :m_context { nullptr }
+    ,m_buffer  ( 4, 0 )
+{
+    std::lock_guard< std::mutex > lock( s_mutex );
+
+    const int attribs[] = {
+        OSMESA_FORMAT,                OSMESA_RGBA,
+        OSMESA_DEPTH_BITS,            0,
+        OSMESA_STENCIL_BITS,          0,
+        OSMESA_PROFILE,               OSMESA_CORE_PROFILE,
+        OSMESA_CONTEXT_MAJOR_VERSION, 3,
+        OSMESA_CONTEXT_MINOR_VERSION, 3,
+        0
+    };
+
+    m_context = OSMesaCreateContextAttribs( attribs, nullptr );
+
+    if ( m_context == nullptr ) {
+
+        throw std::runtime_error( "OSMesaCreateContextAttribs() failed." );
+    }
+
+    s_num_contexts++;
+
+    makeCurrent();
+
+    initGLEW();
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    std::lock_guard< std::mutex > lock( s_mutex );
+
+    OSMesaDestroyContext( m_context );
+
+    s_num_contexts--;
+}
+
+void HeadlessContext::makeCurrent()
+{
+    // 1x1 client buffer as the default framebuffer.
+    if ( !OSMesaMakeCurrent( m_context, m_buffer.data(), GL_UNSIGNED_BYTE, 1, 1 ) ) {
+
+        throw std::runtime_error( "OSMesaMakeCurrent() failed." );
+    }
+}
+
+void HeadlessContext::releaseCurrent()
+{
+    OSMesaMakeCurrent( nullptr, nullptr, GL_UNSIGNED_BYTE, 0, 0 );
+}
+
+const char* HeadlessContext::backendName()
+{
+    return "OSMesa";
+}
+
+#else
+
+HeadlessContext::HeadlessContext()
+    :m_window{ nullptr }
+{
+    std::lock_guard< std::mutex > lock( s_mutex );
+
+    if ( s_num_contexts == 0 ) {
+
+        if( !glfwInit() ) {
+
+            throw std::runtime_error( "glfwInit() failed." );
+        }
+    }
+
+    glfwWindowHint( GLFW_VISIBLE, GL_FALSE );
+    glfwWindowHint( GLFW_CONTEXT_VERSION_MAJOR, 3 );
+    glfwWindowHint( GLFW_CONTEXT_VERSION_MINOR, 3 );
+    glfwWindowHint( GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE );
+
+#ifdef __APPLE__
+    glfwWindowHint( GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    m_window = glfwCreateWindow( 1, 1, "none", nullptr, nullptr );
+
+    if( m_window == nullptr ) {
+
+        if ( s_num_contexts == 0 ) {
+            glfwTerminate();
+        }
+        throw std::runtime_error( "glfwCreateWindow() failed." );
+    }
+
+    s_num_contexts++;
+
+    makeCurrent();
+
+    initGLEW();
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    std::lock_guard< std::mutex > lock( s_mutex );
+
+    glfwDestroyWindow( m_window );
+
+    s_num_contexts--;
+
+    if ( s_num_contexts == 0 ) {
+
+        glfwTerminate();
+    }
+}
+
+void HeadlessContext::makeCurrent()
+{
+    glfwMakeContextCurrent( m_window );
+}
+
+void HeadlessContext::releaseCurrent()
+{
+    glfwMakeContextCurrent( nullptr );
+}
+
+const char* HeadlessContext::backendName()
+{
+    return "GLFW";
+}
+
+#endif
+
+} // namespace DepthTest
@@ -0,0 +1,70 @@
+#ifndef __DEPTH_TEST_HEADLESS_CONTEXT_HPP__
+#define __DEPTH_TEST_HEADLESS_CONTEXT_HPP__
+
+#include <vector>
+
+#include <GL/glew.h>
+
+#if defined( DEPTH_TEST_CONTEXT_EGL )
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#elif defined( DEPTH_TEST_CONTEXT_OSMESA )
+#include <GL/osmesa.h>
+#else
+#include <GLFW/glfw3.h>
+#endif
+
+namespace DepthTest {
+
+// OpenGL 3.3 core context without a visible window for the batch tools.
+// The backend is selected at build time by DEPTH_TEST_BATCH_CONTEXT in CMake.
+//
+// - EGL    : surfaceless EGL display (EGL_MESA_platform_surfaceless).
+//            no X server needed. e.g. Mesa llvmpipe in a container.
+// - OSMESA : Mesa off-screen rendering into a client memory buffer.
+// - GLFW   : hidden 1x1 GLFW window (default). needs a display.
+//
+// All the rendering is done into framebuffer objects, so the default
+// framebuffer is never used.
+// The context is made current to the calling thread on construction.
+class HeadlessContext {
+
+  public:
+
+    explicit HeadlessContext();
+
+    ~HeadlessContext();
+
+    HeadlessContext( const HeadlessContext& ) = delete;
+    HeadlessContext& operator = ( const HeadlessContext& ) = delete;
+
+    void makeCurrent();
+
+    void releaseCurrent();
+
+    static const char* backendName();
+
+  private:
+
+    static void initGLEW();
+
+#if defined( DEPTH_TEST_CONTEXT_EGL )
+
+    EGLDisplay m_display;
+    EGLContext m_context;
+
+#elif defined( DEPTH_TEST_CONTEXT_OSMESA )
+
+    OSMesaContext                m_context;
+    std::vector< unsigned char > m_buffer;
+
+#else
+
+    GLFWwindow* m_window;
+
+#endif
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_HEADLESS_CONTEXT_HPP__*/
@@ -0,0 +1,64 @@
+#ifndef __DEPTH_TEST_INTERACTIVE_OPTION_PARSE_HPP__
+#define __DEPTH_TEST_INTERACTIVE_OPTION_PARSE_HPP__
+
+#include <string>
+#include <iostream>
+
+#include "shader_cache_option_parser.hpp"
+
+namespace DepthTest {
+
+// for depth_test_interactive and depth_test_shader_comparator.
+class InteractiveOptionParser : public ShaderCacheOptionParser
+{
+
+public:
+
+    explicit InteractiveOptionParser( int argc, char* argv[] ) noexcept
+        :ShaderCacheOptionParser{}
+    {
+        for ( auto i = 1; i < argc ; i++ ) {
+
+            std::string arg( argv[i] );
+
+            if (    arg.compare ( HELP1 ) == 0
+                 || arg.compare ( HELP2 ) == 0
+                 || arg.compare ( HELP3 ) == 0
+                 || i + 1 == argc                ) {
+
+                std::cerr << USAGE;
+                exit(1);
+            }
+
+            std::string arg2( argv[++i] );
+
+            if ( !parseShaderCacheOption( arg, arg2 ) ) {
+
+                std::cerr << USAGE;
+                exit(1);
+            }
+        }
+    }
+
+private:
+
+    static const std::string HELP1;
+    static const std::string HELP2;
+    static const std::string HELP3;
+    static const std::string USAGE;
+};
+
+} // namespace DepthTest {
+
+#endif/*__DEPTH_TEST_INTERACTIVE_OPTION_PARSE_HPP__*/
+
+///////////////////////
+
+namespace DepthTest {
+
+const std::string InteractiveOptionParser::HELP1 = "-h";
+const std::string InteractiveOptionParser::HELP2 = "-help";
+const std::string InteractiveOptionParser::HELP3 = "-H";
+const std::string InteractiveOptionParser::USAGE = "depth_test_interactive/depth_test_shader_comparator -h <for help> [-shader_cache <directory of the program binaries, default shader_cache, \"off\" to always compile>]\n";
+
+} // namespace DepthTest {
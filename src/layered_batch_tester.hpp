@@ -0,0 +1,334 @@
+#ifndef __DEPTH_TEST_LAYERED_BATCH_TESTER_HPP__
+#define __DEPTH_TEST_LAYERED_BATCH_TESTER_HPP__
+
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <limits>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "depth_tester.hpp"
+#include "work_stealing_scheduler.hpp"
+#include "log_bisection_search.hpp"
+#include "perturbation_sequence.hpp"
+#include "result_writer.hpp"
+#include "batch_tester.hpp"
+
+namespace DepthTest {
+
+// BatchTester with LogBisectionSearch for the configurations that differ
+// only in the parameter C, one layer of DepthTester::testLayers() each.
+//
+// They share the sample points, and each round of a sample point draws the
+// pairs of the next gaps of all the configurations, i.e. the same plane
+// pairs, under all of them at once. Each configuration takes the verdict on
+// its own gap, so the gaps are the ones of separate bisections, up to the
+// perturbations drawn.
+class LayeredBatchTester {
+
+public:
+
+    LayeredBatchTester(
+        std::vector< DepthTester* >      testers,
+        const DepthTester::DepthTestType depth_test_type,
+        const float                      near,
+        const float                      far,
+        const std::vector< float >&      params_c,
+        const int                        num_samples,
+        const int                        num_perturbed_samples
+    )
+        :m_scheduler            { static_cast<int>( testers.size() ) }
+        ,m_depth_test_type      { depth_test_type }
+        ,m_near                 { near }
+        ,m_far                  { far }
+        ,m_num_samples          { num_samples }
+        ,m_num_perturbed_samples{ num_perturbed_samples }
+        ,m_perturbation         { PerturbationSequence::RANDOM }
+        ,m_seed                 { std::default_random_engine::default_seed }
+        ,m_depth_format         { DepthTester::DEPTH_D24 }
+        ,m_clip_convention      { DepthTester::CLIP_STANDARD }
+    {
+        if ( testers.empty() ) {
+            throw std::runtime_error( "no tester" );
+        }
+
+        for ( const auto param_c : params_c ) {
+            m_layers.push_back( { near, far, param_c } );
+        }
+
+        for ( auto* tester : testers ) {
+
+            m_workers.emplace_back();
+            m_workers.back().m_tester = tester;
+        }
+    }
+
+    void setPerturbation( const PerturbationSequence::Kind kind, const unsigned int seed )
+    {
+        m_perturbation = kind;
+        m_seed         = seed;
+    }
+
+    // as BatchTester::setDepthBuffer().
+    void setDepthBuffer(
+        const DepthTester::DepthFormat    depth_format,
+        const DepthTester::ClipConvention clip_convention
+    ) {
+        m_depth_format    = depth_format;
+        m_clip_convention = clip_convention;
+    }
+
+    // writers[i] is for the i-th configuration, nullptr for none.
+    void setResultWriters( const std::vector< ResultWriter* >& writers )
+    {
+        m_result_writers = writers;
+    }
+
+    // os[i] receives the parameters and the results of the i-th
+    // configuration, as BatchTester::run() does.
+    void run( const std::vector< std::ostream* >& os )
+    {
+        const int num_layers = static_cast<int>( m_layers.size() );
+
+        m_sample_points = BatchTester::samplePoints( m_near, m_far, m_num_samples );
+
+        const int num_points = static_cast<int>( m_sample_points.size() );
+
+        m_records.assign( static_cast<size_t>( num_layers ) * num_points, ResultWriter::Record{} );
+        m_num_rounds.assign( num_points, 0 );
+
+        for ( auto& worker : m_workers ) {
+
+            worker.m_perturbation = PerturbationSequence{ m_perturbation, m_seed };
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+
+        m_scheduler.run(
+
+            num_points,
+
+            [ this ]( const int worker ) {
+
+                m_workers[ worker ].m_tester->attachThread();
+            },
+
+            [ this ]( const int worker, const int item ) {
+
+                testSamplePoint( m_workers[ worker ], item );
+            },
+
+            [ this ]( const int worker ) {
+
+                m_workers[ worker ].m_tester->detachThread();
+            }
+        );
+
+        const std::chrono::duration< double > elapsed = std::chrono::steady_clock::now() - start;
+
+        for ( int l = 0; l < num_layers; l++ ) {
+
+            printResults( *os[l], l, elapsed.count() );
+
+            if ( l < static_cast<int>( m_result_writers.size() ) && m_result_writers[l] != nullptr ) {
+
+                for ( int i = 0; i < num_points; i++ ) {
+                    m_result_writers[l]->write( m_records[ static_cast<size_t>( l ) * num_points + i ] );
+                }
+            }
+        }
+    }
+
+private:
+
+    struct Worker {
+        DepthTester*                              m_tester;
+        std::default_random_engine                m_rand_gen;
+        PerturbationSequence                      m_perturbation;
+        std::vector< float >                      m_gaps;
+        std::vector< DepthTester::PlanePair >     m_pairs;
+        std::vector< DepthTester::TestResult >    m_results;
+    };
+
+    void testSamplePoint( Worker& worker, const int index )
+    {
+        const int   num_layers   = static_cast<int>( m_layers.size() );
+        const int   num_points   = static_cast<int>( m_sample_points.size() );
+        const float sample_point = m_sample_points[ index ];
+
+        std::vector< LogBisectionSearch > searches;
+
+        for ( int l = 0; l < num_layers; l++ ) {
+            searches.emplace_back( m_near, m_far, sample_point );
+        }
+
+        worker.m_rand_gen.seed( m_seed + index );
+
+        const auto start = std::chrono::steady_clock::now();
+
+        int round = 0;
+
+        while ( true ) {
+
+            // the gaps of the round, each once.
+            auto& gaps = worker.m_gaps;
+
+            gaps.clear();
+
+            for ( const auto& search : searches ) {
+
+                if ( !search.finished() ) {
+                    gaps.push_back( search.nextGap() );
+                }
+            }
+
+            if ( gaps.empty() ) {
+                break;
+            }
+
+            std::sort( gaps.begin(), gaps.end() );
+            gaps.erase( std::unique( gaps.begin(), gaps.end() ), gaps.end() );
+
+            worker.m_perturbation.begin( index, round );
+            worker.m_pairs.clear();
+
+            for ( const auto gap : gaps ) {
+
+                for ( int i = 0; i < m_num_perturbed_samples; i++ ) {
+
+                    const auto perturbation = worker.m_perturbation.next( worker.m_rand_gen, gap );
+
+                    const auto plane_1 = sample_point - 0.5f * ( gap + perturbation );
+                    const auto plane_2 = sample_point + 0.5f * ( gap + perturbation );
+
+                    worker.m_pairs.push_back( { plane_1, plane_2 } );
+                    worker.m_pairs.push_back( { plane_2, plane_1 } );
+                }
+            }
+
+            worker.m_tester->testLayers( m_layers, worker.m_pairs, worker.m_results );
+
+            const auto num_pairs = worker.m_pairs.size();
+
+            for ( int l = 0; l < num_layers; l++ ) {
+
+                auto& search = searches[l];
+
+                if ( search.finished() ) {
+                    continue;
+                }
+
+                const int k = static_cast<int>(
+                                  std::lower_bound( gaps.begin(), gaps.end(), search.nextGap() ) - gaps.begin() );
+
+                const auto* results = &worker.m_results[ l * num_pairs + k * 2 * m_num_perturbed_samples ];
+
+                bool resolved = true;
+
+                for ( int i = 0; i < m_num_perturbed_samples && resolved; i++ ) {
+                    resolved = BatchTester::isSampleResolved( results, i );
+                }
+
+                search.report( resolved );
+            }
+
+            round++;
+        }
+
+        const std::chrono::duration< double > elapsed = std::chrono::steady_clock::now() - start;
+
+        m_num_rounds[ index ] = round;
+
+        for ( int l = 0; l < num_layers; l++ ) {
+
+            const auto& search = searches[l];
+
+            m_records[ static_cast<size_t>( l ) * num_points + index ] = {
+                static_cast< uint32_t >( index ),
+                sample_point,
+                search.result(),
+                static_cast< uint32_t >( search.numRounds() ),
+                static_cast< uint32_t >( search.numProbes() ),
+                elapsed.count(),
+                std::numeric_limits< float >::quiet_NaN()
+            };
+        }
+    }
+
+    void printResults( std::ostream& os, const int layer, const double elapsed ) const
+    {
+        const int num_points = static_cast<int>( m_sample_points.size() );
+
+        BatchTester::printParameters(
+            os,
+            m_depth_test_type,
+            m_near,
+            m_far,
+            m_layers[ layer ].m_param_c,
+            m_depth_format,
+            m_clip_convention,
+            m_num_samples,
+            m_num_perturbed_samples,
+            m_scheduler.numWorkers()
+        );
+
+        os << "    search: bisection\n";
+        os << "    layers: " << m_layers.size() << " (layer " << layer << ")\n";
+        os << "    perturbation: " << PerturbationSequence::kindName( m_perturbation ) << "\n";
+        os << "    seed: " << m_seed << "\n";
+
+        uint64_t total_probes = 0;
+        uint64_t total_rounds = 0;
+        uint64_t total_draws  = 0;
+
+        for ( int i = 0; i < num_points; i++ ) {
+
+            const auto& record = m_records[ static_cast<size_t>( layer ) * num_points + i ];
+
+            os << "sample point [" << i << "]:\t" << record.m_sample_point << "\t" << record.m_min_gap << "\n";
+
+            total_probes += record.m_num_probes;
+            total_rounds += record.m_num_iterations;
+            total_draws  += m_num_rounds[i];
+        }
+
+        const double num_points_f = static_cast<double>( std::max( 1, num_points ) );
+
+        os << "Search summary: bisection, layered\n";
+        os << "    sample points: " << num_points << " of " << num_points << "\n";
+        os << "    probes: " << total_probes << " (" << total_probes / num_points_f << " per sample point)\n";
+        os << "    rounds: " << total_rounds << " (" << total_rounds / num_points_f << " per sample point)\n";
+        os << "    layered rounds: " << total_draws << " (" << total_draws / num_points_f
+           << " per sample point, shared by " << m_layers.size() << " layers)\n";
+        os << "    time: " << elapsed << " seconds for all the layers\n";
+    }
+
+    std::vector< Worker >  m_workers;
+    WorkStealingScheduler  m_scheduler;
+
+    const DepthTester::DepthTestType m_depth_test_type;
+    const float m_near;
+    const float m_far;
+    const int   m_num_samples;
+    const int   m_num_perturbed_samples;
+
+    PerturbationSequence::Kind m_perturbation;
+    unsigned int               m_seed;
+
+    DepthTester::DepthFormat    m_depth_format;
+    DepthTester::ClipConvention m_clip_convention;
+
+    std::vector< DepthTester::Layer >   m_layers;
+    std::vector< float >                m_sample_points;
+    std::vector< ResultWriter::Record > m_records;    // the sample points of a layer one layer after another.
+    std::vector< int >                  m_num_rounds; // the layered rounds of each sample point.
+    std::vector< ResultWriter* >        m_result_writers;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_LAYERED_BATCH_TESTER_HPP__*/
@@ -2,18 +2,28 @@
 #define __DEPTH_TEST_OPTION_PARSE_HPP__
 
 #include <string>
+#include <iostream>
 
-#include "square_renderer.hpp"
+#include "common_option_parser.hpp"
 
 namespace DepthTest {
 
-class OptionParser 
+class OptionParser : public CommonOptionParser
 {
 
 public:
 
     explicit OptionParser( int argc, char* argv[] ) noexcept
-        :m_depth_test_type       { SquareRenderer::UNKNOWN }
+        :CommonOptionParser      {
+             DEPTH_TYPE_OPTION | DEPTH_FORMAT_OPTION | CLIP_OPTION | BACKEND_OPTION | CROSS_CHECK_OPTION
+             | THREADS_OPTION | SEARCH_OPTIONS | SHADER_CACHE_OPTION,
+             OPENGL,
+             USAGE
+         }
+        ,m_output_path           {}
+        ,m_checkpoint_path       {}
+        ,m_resume                { false }
+        ,m_profile               { false }
         ,m_near                  { 0.0f }
         ,m_far                   { 0.0f }
         ,m_param_c               { 0.0f }
@@ -31,46 +41,56 @@ public:
                 std::cerr << USAGE;
                 exit(1);
             }
+            else if ( arg.compare ( PROFILE ) == 0 ) {
+
+                m_profile = true;
+                continue;
+            }
+            else if ( i + 1 == argc ) {
+
+                std::cerr << USAGE;
+                exit(1);
+            }
+
+            std::string arg2( argv[++i] );
+
+            if ( parseCommonOption( arg, arg2 ) ) {
+
+                continue;
+            }
             else if ( arg.compare ( NEAR ) == 0 ) {
 
-                std::string arg2( argv[++i] );
                 m_near = std::stof( arg2 );
             }
             else if ( arg.compare ( FAR ) == 0 ) {
 
-                std::string arg2( argv[++i] );
                 m_far = std::stof( arg2 );
             }
             else if ( arg.compare ( PARAM_C ) == 0 ) {
 
-                std::string arg2( argv[++i] );
                 m_param_c = std::stof( arg2 );
             }
             else if ( arg.compare ( NUM_POINTS ) == 0 ) {
 
-                std::string arg2( argv[++i] );
                 m_num_points = std::stoi( arg2 );
             }
             else if ( arg.compare ( NUM_PERTURBED_SAMPLES ) == 0 ) {
 
-                std::string arg2( argv[++i] );
                 m_num_perturbed_samples = std::stoi( arg2 );
             }
-            else if ( arg.compare ( DEPTH_TYPE ) == 0 ) {
-
-                std::string arg2( argv[++i] );
-                if ( arg2.compare( DEPTH_TYPE_PERSPECTIVE ) == 0 ) {
+            else if ( arg.compare ( OUTPUT ) == 0 ) {
 
-                    m_depth_test_type = SquareRenderer::PERSPECTIVE;
-                }
-                else if ( arg2.compare( DEPTH_TYPE_LOGFN ) == 0 ) {
+                m_output_path = arg2;
+            }
+            else if ( arg.compare ( CHECKPOINT ) == 0 ) {
 
-                    m_depth_test_type = SquareRenderer::LOG_DEPTH_FN;
-                }
-                else if ( arg2.compare( DEPTH_TYPE_LOGCF ) == 0 ) {
+                m_checkpoint_path = arg2;
+                m_resume          = false;
+            }
+            else if ( arg.compare ( RESUME ) == 0 ) {
 
-                    m_depth_test_type = SquareRenderer::LOG_DEPTH_CF;
-                }
+                m_checkpoint_path = arg2;
+                m_resume          = true;
             }
             else {
                 std::cerr << USAGE;
@@ -78,7 +98,7 @@ public:
             }
         }
 
-        if (    m_depth_test_type == SquareRenderer::UNKNOWN
+        if (    depthTestType() == SquareRenderer::UNKNOWN
              || m_near == 0.0f 
              || m_far == 0.0f
              || m_param_c == 0.0f 
@@ -88,11 +108,32 @@ public:
             std::cerr << USAGE;
             exit(1);
         }
+
+        checkCommonOptions();
+    }
+
+    // empty if not specified.
+    const std::string& outputPath() const
+    {
+        return m_output_path;
+    }
+
+    // empty if not specified.
+    const std::string& checkpointPath() const
+    {
+        return m_checkpoint_path;
+    }
+
+    // true if the run continues from checkpointPath().
+    bool resume() const
+    {
+        return m_resume;
     }
 
-    SquareRenderer::DepthTestType depthTestType() const 
+    // true if the stages of the OpenGL testers are timed.
+    bool profile() const
     {
-        return m_depth_test_type;
+        return m_profile;
     }
 
     float near() const
@@ -122,10 +163,10 @@ public:
 
 private:
 
-    static const std::string DEPTH_TYPE;
-    static const std::string DEPTH_TYPE_PERSPECTIVE;
-    static const std::string DEPTH_TYPE_LOGFN;
-    static const std::string DEPTH_TYPE_LOGCF;
+    static const std::string OUTPUT;
+    static const std::string PROFILE;
+    static const std::string CHECKPOINT;
+    static const std::string RESUME;
     static const std::string NEAR;
     static const std::string FAR;
     static const std::string PARAM_C;
@@ -136,7 +177,10 @@ private:
     static const std::string HELP3;
     static const std::string USAGE;
 
-    SquareRenderer::DepthTestType m_depth_test_type;
+    std::string m_output_path;
+    std::string m_checkpoint_path;
+    bool        m_resume;
+    bool        m_profile;
 
     float m_near;
     float m_far;
@@ -153,10 +197,10 @@ private:
 
 namespace DepthTest {
 
-const std::string OptionParser::DEPTH_TYPE            = "-depth_type";
-const std::string OptionParser::DEPTH_TYPE_PERSPECTIVE= "perspective";
-const std::string OptionParser::DEPTH_TYPE_LOGFN      = "logfn";
-const std::string OptionParser::DEPTH_TYPE_LOGCF      = "logcf";
+const std::string OptionParser::OUTPUT                = "-output";
+const std::string OptionParser::PROFILE               = "-profile";
+const std::string OptionParser::CHECKPOINT            = "-checkpoint";
+const std::string OptionParser::RESUME                = "-resume";
 const std::string OptionParser::NEAR                  = "-near";
 const std::string OptionParser::FAR                   = "-far";
 const std::string OptionParser::PARAM_C               = "-c";
@@ -165,6 +209,6 @@ const std::string OptionParser::NUM_PERTURBED_SAMPLES = "-num_perturbed_samples"
 const std::string OptionParser::HELP1                 = "-h";
 const std::string OptionParser::HELP2                 = "-help";
 const std::string OptionParser::HELP3                 = "-H";
-const std::string OptionParser::USAGE                 = "depth_test_batch -h <for help> -depth_type <\"perspective\"(perspective depth test)/\"logfn\"(log depth test of FN-type)/\"logcf\"(log depth test of CF-type)> -near <near(positive)> -far <far(positive)> -c <parameter C for CF-type> -num_points <num points> -num_perturbed_samples <num samples>\n";
+const std::string OptionParser::USAGE                 = "depth_test_batch -h <for help> -depth_type <\"perspective\"(perspective depth test)/\"logfn\"(log depth test of FN-type)/\"logcf\"(log depth test of CF-type)> -near <near(positive)> -far <far(positive)> -c <parameter C for CF-type> -num_points <num points> -num_perturbed_samples <num samples> [-depth_format <\"d16\"/\"d24\"(default)/\"d32f\">] [-clip <\"standard\"(default)/\"reversed\"(reversed-Z with glClipControl, or glDepthRange without it)/\"reversed_range\"(reversed-Z with glDepthRange), perspective only, not with \"codes\" and \"stack\">] [-backend <\"gl\"(OpenGL, default)/\"cpu\"(CPU emulation)/\"check\"(OpenGL checked against CPU emulation)>] [-threads <num worker threads, 0 for all cores>] [-pipeline <num sample points in flight per thread, default 1>] [-detection <\"color\"(color readback, default)/\"query\"(occlusion queries)>] [-search <\"grid\"(pairs of planes, default)/\"bisection\"(log bisection)/\"bracketing\"(exponential bracketing and bisection)/\"ulp\"(walk over the floats)/\"stack\"(stacks of planes, many gaps per render)/\"codes\"(depth buffer codes)>] [-stack_planes <planes per stack of \"stack\", 3 to 255, default 8>] [-output <result file>] [-output_format <\"binary\"(default)/\"csv\"/\"npy\">] [-initial_gap <\"blind\"(default)/\"model\"(analytic minimum gap)>] [-early_stop <confidence in (0.5, 1) to stop the probes early, default 0(off)>] [-perturbation <\"random\"(default)/\"halton\"/\"sobol\">] [-seed <seed of the sample points, default 1>] [-sampling <\"uniform\"(default)/\"adaptive\"(bisects where the curve bends)>] [-refine_tolerance <relative deviation to bisect at, default 0.05>] [-profile(times the stages of the OpenGL testers)] [-shader_cache <directory of the program binaries, default shader_cache, \"off\" to always compile>] [-checkpoint <checkpoint file to start>] [-resume <checkpoint file to continue>]\n";
 
 } // namespace DepthTest {
@@ -0,0 +1,224 @@
+#ifndef __DEPTH_TEST_DEPTH_ENCODING_HPP__
+#define __DEPTH_TEST_DEPTH_ENCODING_HPP__
+
+#include <cmath>
+#include <stdexcept>
+
+#include "depth_tester.hpp"
+
+namespace DepthTest {
+
+// Depth encodings as compile-time policies.
+//
+// Each encoding defines in one place what the backends need:
+//
+//     TYPE:            its DepthTester::DepthTestType.
+//     NUM_PARAMS:      the number of the float parameters of the shader, at most 2.
+//     PARAM_NAMES:     their names in GLSL.
+//     GLSL_FRAG_DEPTH: the statements of the fragment shader that write
+//                      gl_FragDepth from position_vcs_z and the parameters.
+//                      nullptr for the fixed function depth.
+//     params():        the parameters from near, far and C, as uploaded to the
+//                      shaders. the backends must all use these values.
+//     shaderDepth():   the depth of the fragment shader, or of the viewport
+//                      transform, in single precision as the GPUs compute it.
+//     depth(), absDerivative():
+//                      the closed forms F(z) and |dF(z)/dz| in double, as in
+//                      python/vcs_to_scs_functions.py.
+//
+// SquareRenderer generates its shaders, DepthPipelineEmulator its test
+// loop, and AnalyticDepthModel its formulas from the policy, and
+// visitDepthEncoding() picks the policy of a DepthTestType once, outside
+// of their hot loops. A new encoding is a new policy, a new DepthTestType,
+// and a new case in visitDepthEncoding().
+
+// GLSL log() as the GPUs implement it: log2() of the special function unit
+// scaled by ln(2).
+static inline float glslLog( const float x )
+{
+    return std::log2( x ) * 0.69314718f;
+}
+
+// sets the parameters of the shader of an encoding.
+typedef void ( *DepthParamsFunction )( const float near, const float far, const float param_c, float params[2] );
+
+struct PerspectiveEncoding {
+
+    static constexpr DepthTester::DepthTestType TYPE = DepthTester::PERSPECTIVE;
+
+    static constexpr int         NUM_PARAMS     = 0;
+    static constexpr const char* PARAM_NAMES[2] = { nullptr, nullptr };
+
+    static constexpr const char* GLSL_FRAG_DEPTH = nullptr;
+
+    static void params( const float near, const float far, const float param_c, float params[2] )
+    {
+        (void)near;
+        (void)far;
+        (void)param_c;
+
+        params[0] = 0.0f;
+        params[1] = 0.0f;
+    }
+
+    // z_clip * ( 1 / w ), mapped to the depth range [0, 1].
+    static float shaderDepth( const float z_vcs, const float z_clip, const float w, const float params[2] )
+    {
+        (void)z_vcs;
+        (void)params;
+
+        return z_clip * ( 1.0f / w ) * 0.5f + 0.5f;
+    }
+
+    static double depth( const double z_vcs, const double near, const double far, const double param_c )
+    {
+        (void)param_c;
+
+        const double m11 = -1.0 * ( far + near ) / ( far - near );
+        const double m12 = -2.0 * far * near / ( far - near );
+
+        const double z_ndcs = m11 * z_vcs + m12;
+        const double w_ndcs = -1.0 * z_vcs;
+
+        return ( z_ndcs / w_ndcs + 1.0 ) / 2.0;
+    }
+
+    static double absDerivative( const double z_vcs, const double near, const double far, const double param_c )
+    {
+        (void)param_c;
+
+        const double m12 = -2.0 * far * near / ( far - near );
+
+        return fabs( 0.5 * m12 / ( z_vcs * z_vcs ) );
+    }
+};
+
+// ( log( -z ) - log( n ) ) / ( log( f ) - log( n ) )
+struct LogDepthFNEncoding {
+
+    static constexpr DepthTester::DepthTestType TYPE = DepthTester::LOG_DEPTH_FN;
+
+    static constexpr int         NUM_PARAMS     = 2;
+    static constexpr const char* PARAM_NAMES[2] = { "log_near", "log_far" };
+
+    static constexpr const char* GLSL_FRAG_DEPTH = "\
+    float log_z  = log( max( 1.0e-20, -1.0 * position_vcs_z ) );\n\
+    gl_FragDepth = ( log_z - log_near ) / ( log_far - log_near );\n\
+";
+
+    static void params( const float near, const float far, const float param_c, float params[2] )
+    {
+        (void)param_c;
+
+        params[0] = log( near );
+        params[1] = log( far  );
+    }
+
+    static float shaderDepth( const float z_vcs, const float z_clip, const float w, const float params[2] )
+    {
+        (void)z_clip;
+        (void)w;
+
+        const float log_z = glslLog( std::max( 1.0e-20f, -1.0f * z_vcs ) );
+        return ( log_z - params[0] ) / ( params[1] - params[0] );
+    }
+
+    static double depth( const double z_vcs, const double near, const double far, const double param_c )
+    {
+        (void)param_c;
+
+        const double log_n = log( near );
+        const double log_f = log( far );
+        const double log_z = log( -1.0 * z_vcs );
+
+        return ( log_z - log_n ) / ( log_f - log_n );
+    }
+
+    static double absDerivative( const double z_vcs, const double near, const double far, const double param_c )
+    {
+        (void)param_c;
+
+        const double C1 = log( far ) - log( near );
+
+        return fabs( 1.0 / ( C1 * z_vcs ) );
+    }
+};
+
+// log( -C z + 1 ) / log( C f + 1 )
+struct LogDepthCFEncoding {
+
+    static constexpr DepthTester::DepthTestType TYPE = DepthTester::LOG_DEPTH_CF;
+
+    static constexpr int         NUM_PARAMS     = 2;
+    static constexpr const char* PARAM_NAMES[2] = { "param_c", "log_cf_plus_1_inv" };
+
+    static constexpr const char* GLSL_FRAG_DEPTH = "\
+    gl_FragDepth = log( -1.0 * param_c * position_vcs_z + 1.0 )\n\
+                 * log_cf_plus_1_inv;\n\
+";
+
+    static void params( const float near, const float far, const float param_c, float params[2] )
+    {
+        (void)near;
+
+        params[0] = param_c;
+        params[1] = 1.0f / log( param_c * far + 1.0f );
+    }
+
+    static float shaderDepth( const float z_vcs, const float z_clip, const float w, const float params[2] )
+    {
+        (void)z_clip;
+        (void)w;
+
+        return glslLog( -1.0f * params[0] * z_vcs + 1.0f ) * params[1];
+    }
+
+    static double depth( const double z_vcs, const double near, const double far, const double param_c )
+    {
+        (void)near;
+
+        const double log_cf_plus_one       = log( param_c * far + 1.0 );
+        const double log_minus_cz_plus_one = log( -1.0 * param_c * z_vcs + 1.0 );
+
+        return log_minus_cz_plus_one / log_cf_plus_one;
+    }
+
+    static double absDerivative( const double z_vcs, const double near, const double far, const double param_c )
+    {
+        (void)near;
+
+        const double log_cf_plus_one   = log( param_c * far + 1.0 );
+        const double minus_cz_plus_one = -1.0 * param_c * z_vcs + 1.0;
+
+        return fabs( -1.0 * param_c / ( log_cf_plus_one * minus_cz_plus_one ) );
+    }
+};
+
+// calls visitor with a value of the policy of depth_test_type, e.g.
+//
+//     visitDepthEncoding( type, [ & ]( auto encoding ) {
+//         using Encoding = decltype( encoding );
+//         ...
+//     } );
+template< class Visitor >
+auto visitDepthEncoding( const DepthTester::DepthTestType depth_test_type, Visitor&& visitor )
+{
+    switch( depth_test_type ) {
+
+      case DepthTester::PERSPECTIVE:
+        return visitor( PerspectiveEncoding{} );
+
+      case DepthTester::LOG_DEPTH_FN:
+        return visitor( LogDepthFNEncoding{} );
+
+      case DepthTester::LOG_DEPTH_CF:
+        return visitor( LogDepthCFEncoding{} );
+
+      default:
+        throw std::runtime_error("unknown depth type");
+    }
+}
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_DEPTH_ENCODING_HPP__*/
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include "opengl_util.hpp"
+#include "square_renderer.hpp"
+#include "depth_math_capture.hpp"
+
+namespace DepthTest {
+
+DepthMathCapture::DepthMathCapture( const DepthTester::DepthTestType depth_test_type )
+    :m_depth_test_type              { depth_test_type }
+    ,m_gl_prog_id                   { 0 }
+    ,m_gl_vertex_array              { 0 }
+    ,m_gl_vertex_buffer_planes      { 0 }
+    ,m_gl_feedback_buffers          { 0, 0 }
+    ,m_gl_framebuffer               { 0 }
+    ,m_gl_renderbuffer              { 0 }
+    ,m_vertex_location_plane        { 0 }
+    ,m_uniform_location_proj_z      { 0 }
+    ,m_uniform_location_depth_params{ 0, 0 }
+    ,m_num_depth_params             { 0 }
+    ,m_depth_params_function        { nullptr }
+{
+    std::vector< std::string > param_names;
+
+    visitDepthEncoding( m_depth_test_type, [ & ]( auto encoding ) {
+
+        using Encoding = decltype( encoding );
+
+        m_gl_prog_id = compileAndLinkTransformFeedback(
+            vertStrCaptureOf< Encoding >(),
+            { "ndc_z_vout", "depth_vout" },
+            std::cerr
+        );
+
+        m_num_depth_params      = Encoding::NUM_PARAMS;
+        m_depth_params_function = &Encoding::params;
+
+        for ( int i = 0; i < Encoding::NUM_PARAMS; i++ ) {
+            param_names.push_back( Encoding::PARAM_NAMES[i] );
+        }
+    } );
+
+    m_vertex_location_plane   = glGetAttribLocation ( m_gl_prog_id, "plane" );
+    m_uniform_location_proj_z = glGetUniformLocation( m_gl_prog_id, "proj_z" );
+
+    for ( int i = 0; i < m_num_depth_params; i++ ) {
+
+        m_uniform_location_depth_params[i] = glGetUniformLocation( m_gl_prog_id, param_names[i].c_str() );
+    }
+
+    glGenVertexArrays( 1, &m_gl_vertex_array );
+    glGenBuffers( 1, &m_gl_vertex_buffer_planes );
+    glGenBuffers( 2, m_gl_feedback_buffers );
+
+    glBindVertexArray( m_gl_vertex_array );
+    glBindBuffer( GL_ARRAY_BUFFER, m_gl_vertex_buffer_planes );
+    glEnableVertexAttribArray( m_vertex_location_plane );
+    glVertexAttribPointer( m_vertex_location_plane, 1, GL_FLOAT, GL_FALSE, 0, (void*)0 );
+    glBindVertexArray( 0 );
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+    glGenRenderbuffers( 1, &m_gl_renderbuffer );
+    glBindRenderbuffer( GL_RENDERBUFFER, m_gl_renderbuffer );
+    glRenderbufferStorage( GL_RENDERBUFFER, GL_R8, 1, 1 );
+
+    glGenFramebuffers( 1, &m_gl_framebuffer );
+    glBindFramebuffer( GL_FRAMEBUFFER, m_gl_framebuffer );
+    glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_gl_renderbuffer );
+
+    if ( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE ) {
+
+        throw std::runtime_error( "DepthMathCapture: framebuffer incomplete." );
+    }
+
+    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+    glBindRenderbuffer( GL_RENDERBUFFER, 0 );
+}
+
+DepthMathCapture::~DepthMathCapture()
+{
+    glDeleteFramebuffers( 1, &m_gl_framebuffer );
+    glDeleteRenderbuffers( 1, &m_gl_renderbuffer );
+    glDeleteBuffers( 2, m_gl_feedback_buffers );
+    glDeleteBuffers( 1, &m_gl_vertex_buffer_planes );
+    glDeleteVertexArrays( 1, &m_gl_vertex_array );
+    glDeleteProgram( m_gl_prog_id );
+}
+
+void DepthMathCapture::capture(
+    const float                 near,
+    const float                 far,
+    const float                 param_c,
+    const std::vector< float >& planes,
+    std::vector< float >&       ndc_z,
+    std::vector< float >&       depths
+) {
+    const int num_planes = static_cast<int>( planes.size() );
+
+    ndc_z.resize ( num_planes );
+    depths.resize( num_planes );
+
+    if ( num_planes == 0 ) {
+        return;
+    }
+
+    glBindFramebuffer( GL_FRAMEBUFFER, m_gl_framebuffer );
+    glUseProgram( m_gl_prog_id );
+    glBindVertexArray( m_gl_vertex_array );
+
+    // the same values as SquareRenderer::testBatch().
+    const auto Mproj = SquareRenderer::testProjection( near, far );
+
+    glUniform2f( m_uniform_location_proj_z, Mproj[2][2], Mproj[3][2] );
+
+    float depth_params[2];
+
+    m_depth_params_function( near, far, param_c, depth_params );
+
+    for ( int i = 0; i < m_num_depth_params; i++ ) {
+
+        glUniform1f( m_uniform_location_depth_params[i], depth_params[i] );
+    }
+
+    const int draw_size = std::min( num_planes, MAX_PLANES_PER_DRAW );
+
+    glBindBuffer( GL_ARRAY_BUFFER, m_gl_vertex_buffer_planes );
+    glBufferData( GL_ARRAY_BUFFER, draw_size * sizeof(float), nullptr, GL_STREAM_DRAW );
+
+    for ( int i = 0; i < 2; i++ ) {
+
+        glBindBuffer( GL_TRANSFORM_FEEDBACK_BUFFER, m_gl_feedback_buffers[i] );
+        glBufferData( GL_TRANSFORM_FEEDBACK_BUFFER, draw_size * sizeof(float), nullptr, GL_STREAM_READ );
+        glBindBufferBase( GL_TRANSFORM_FEEDBACK_BUFFER, i, m_gl_feedback_buffers[i] );
+    }
+
+    glEnable( GL_RASTERIZER_DISCARD );
+
+    for ( int first = 0; first < num_planes; first += draw_size ) {
+
+        const int count = std::min( draw_size, num_planes - first );
+
+        glBufferSubData( GL_ARRAY_BUFFER, 0, count * sizeof(float), &planes[ first ] );
+
+        glBeginTransformFeedback( GL_POINTS );
+        glDrawArrays( GL_POINTS, 0, count );
+        glEndTransformFeedback();
+
+        glBindBuffer( GL_TRANSFORM_FEEDBACK_BUFFER, m_gl_feedback_buffers[0] );
+        glGetBufferSubData( GL_TRANSFORM_FEEDBACK_BUFFER, 0, count * sizeof(float), &ndc_z[ first ] );
+
+        glBindBuffer( GL_TRANSFORM_FEEDBACK_BUFFER, m_gl_feedback_buffers[1] );
+        glGetBufferSubData( GL_TRANSFORM_FEEDBACK_BUFFER, 0, count * sizeof(float), &depths[ first ] );
+    }
+
+    glDisable( GL_RASTERIZER_DISCARD );
+
+    for ( int i = 0; i < 2; i++ ) {
+        glBindBufferBase( GL_TRANSFORM_FEEDBACK_BUFFER, i, 0 );
+    }
+    glBindBuffer( GL_TRANSFORM_FEEDBACK_BUFFER, 0 );
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+    glBindVertexArray( 0 );
+    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
+
+} // namespace DepthTest
@@ -0,0 +1,120 @@
+#ifndef __DEPTH_TEST_DEPTH_MATH_CAPTURE_HPP__
+#define __DEPTH_TEST_DEPTH_MATH_CAPTURE_HPP__
+
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "depth_tester.hpp"
+#include "depth_encoding.hpp"
+
+namespace DepthTest {
+
+// The vertex shader of DepthMathCapture for a depth encoding.
+// The clip z is the one of VERT_STR_BATCH, and the depth is GLSL_FRAG_DEPTH
+// of the encoding with gl_FragDepth written to depth_vout.
+template< class Encoding >
+std::string vertStrCaptureOf()
+{
+    std::string str = "#version 330 core\n\
+\n\
+in float plane;\n\
+\n\
+out float ndc_z_vout;\n\
+out float depth_vout;\n\
+\n\
+uniform vec2 proj_z;\n";
+
+    for ( int i = 0; i < Encoding::NUM_PARAMS; i++ ) {
+        str += std::string( "uniform float " ) + Encoding::PARAM_NAMES[i] + ";\n";
+    }
+    str += "\n\
+void main() {\n\
+\n\
+    float z = -1.0 * plane;\n\
+    float w = -1.0 * z;\n\
+    gl_Position = vec4( 0.0, 0.0, proj_z.x * z + proj_z.y, w );\n\
+    ndc_z_vout  = gl_Position.z / gl_Position.w;\n";
+
+    if ( Encoding::GLSL_FRAG_DEPTH != nullptr ) {
+
+        std::string depth_str = Encoding::GLSL_FRAG_DEPTH;
+
+        const std::string frag_depth = "gl_FragDepth";
+
+        for ( auto pos = depth_str.find( frag_depth ); pos != std::string::npos; pos = depth_str.find( frag_depth, pos ) ) {
+            depth_str.replace( pos, frag_depth.size(), "depth_vout" );
+        }
+
+        str += "    float position_vcs_z = z;\n";
+        str += depth_str;
+    }
+    else {
+        // the viewport transform to the depth range [0, 1].
+        str += "    depth_vout  = ndc_z_vout * 0.5 + 0.5;\n";
+    }
+    str += "}\n";
+
+    return str;
+}
+
+// Evaluates the depth math of the shaders on the GPU for many planes per
+// draw with transform feedback and GL_RASTERIZER_DISCARD, and reads the
+// results back in bulk, so that the precision of log() and of the division
+// on the driver can be compared with the CPU model.
+//
+// The log depth of SquareRenderer is computed in its fragment shaders.
+// The capture runs the same GLSL statements in a vertex shader instead,
+// which is the same arithmetic on the common GPUs, but a driver may
+// compile the two stages with different precision.
+// Must be used on the thread of the current context.
+class DepthMathCapture {
+
+  public:
+
+    // the planes of one draw. larger arrays are split.
+    static constexpr int MAX_PLANES_PER_DRAW = 1 << 22;
+
+    explicit DepthMathCapture( const DepthTester::DepthTestType depth_test_type );
+
+    ~DepthMathCapture();
+
+    // ndc_z:  gl_Position.z / gl_Position.w of the planes.
+    // depths: the depth of the encoding before the clamp and the
+    //         quantization, i.e. gl_FragDepth or the viewport transform.
+    // both are resized to planes.size().
+    void capture(
+        const float                 near,
+        const float                 far,
+        const float                 param_c,
+        const std::vector< float >& planes,
+        std::vector< float >&       ndc_z,
+        std::vector< float >&       depths
+    );
+
+  private:
+
+    const DepthTester::DepthTestType m_depth_test_type;
+
+    GLuint     m_gl_prog_id;
+    GLuint     m_gl_vertex_array;
+    GLuint     m_gl_vertex_buffer_planes;
+    GLuint     m_gl_feedback_buffers[2]; // ndc_z_vout, depth_vout
+
+    // nothing is rasterized, but the draw needs a complete framebuffer,
+    // and the headless contexts have no default one.
+    GLuint     m_gl_framebuffer;
+    GLuint     m_gl_renderbuffer;
+
+    GLuint     m_vertex_location_plane;
+    GLuint     m_uniform_location_proj_z;
+    GLuint     m_uniform_location_depth_params[2];
+    int        m_num_depth_params;
+    DepthParamsFunction
+               m_depth_params_function;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_DEPTH_MATH_CAPTURE_HPP__*/
@@ -0,0 +1,255 @@
+#ifndef __DEPTH_TEST_DEPTH_TESTER_HPP__
+#define __DEPTH_TEST_DEPTH_TESTER_HPP__
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <stdexcept>
+
+namespace DepthTest {
+
+// Common interface of the back ends that decide which of two planes
+// survives the depth test. SquareRenderer does it on the GPU, and
+// DepthPipelineEmulator emulates the same pipeline on the CPU.
+class DepthTester {
+
+  public:
+
+    typedef enum _DepthTestType {
+        UNKNOWN,
+        PERSPECTIVE,
+        LOG_DEPTH_FN,
+        LOG_DEPTH_CF
+    } DepthTestType;
+
+    typedef enum _DepthFormat {
+        DEPTH_D16,
+        DEPTH_D24,
+        DEPTH_D32F
+    } DepthFormat;
+
+    // how the clip z maps to the depth buffer.
+    // the reversed ones put near at 1 and far at 0, clear to 0, and test
+    // with GL_GREATER. They are for PERSPECTIVE only.
+    typedef enum _ClipConvention {
+        CLIP_STANDARD,             // clip z in [-w, w], depth range [0, 1], GL_LESS.
+        CLIP_REVERSED,             // glClipControl( GL_LOWER_LEFT, GL_ZERO_TO_ONE ) and a reversed projection.
+        CLIP_REVERSED_DEPTH_RANGE  // the standard projection into glDepthRange( 1, 0 ).
+    } ClipConvention;
+
+    // one probe of the batched test.
+    struct TestCase {
+        float m_near;
+        float m_far;
+        float m_param_c;
+        float m_plane_1; // drawn first
+        float m_plane_2; // drawn second
+    };
+
+    struct TestResult {
+        bool m_plane_1_detected;
+        bool m_plane_2_detected;
+    };
+
+    // one camera configuration of testLayers().
+    struct Layer {
+        float m_near;
+        float m_far;
+        float m_param_c;
+    };
+
+    // the planes of a test case of testLayers().
+    struct PlanePair {
+        float m_plane_1; // drawn first
+        float m_plane_2; // drawn second
+    };
+
+    typedef std::function< void( const std::vector< TestResult >& results ) > Callback;
+
+    // the depth test of testStacks().
+    typedef enum _StackDepthFunc {
+        STACK_LESS,    // cleared to 1 as testBatch().
+        STACK_GREATER  // cleared to 0.
+    } StackDepthFunc;
+
+    static const char* depthFormatName( const DepthFormat depth_format )
+    {
+        switch ( depth_format ) {
+          case DEPTH_D16:
+            return "d16";
+          case DEPTH_D32F:
+            return "d32f";
+          default:
+            return "d24";
+        }
+    }
+
+    static const char* clipConventionName( const ClipConvention clip_convention )
+    {
+        switch ( clip_convention ) {
+          case CLIP_REVERSED:
+            return "reversed";
+          case CLIP_REVERSED_DEPTH_RANGE:
+            return "reversed_range";
+          default:
+            return "standard";
+        }
+    }
+
+    virtual ~DepthTester() {}
+
+    // called on the worker thread before and after it uses the tester.
+    virtual void attachThread() {}
+    virtual void detachThread() {}
+
+    // results is resized to test_cases.size().
+    virtual void testBatch(
+        const std::vector< TestCase >& test_cases,
+        std::vector< TestResult >&     results
+    ) = 0;
+
+    // The depth buffer codes of the planes, each drawn alone into its own
+    // pixel. The planes clipped away keep the code of the cleared buffer.
+    // Under the reversed clip conventions it is 0, and the nearer planes
+    // have the larger codes.
+    // codes is resized to planes.size().
+    virtual void readDepthCodes(
+        const float                 near,
+        const float                 far,
+        const float                 param_c,
+        const std::vector< float >& planes,
+        std::vector< uint32_t >&    codes
+    ) {
+        (void)near; (void)far; (void)param_c; (void)planes; (void)codes;
+        throw std::runtime_error( "depth code readback not supported." );
+    }
+
+    // Stacks of num_planes planes, each stack drawn into its own pixel in
+    // the order of its planes. planes has the planes of the stacks one
+    // stack after another.
+    // winners receives the index in its stack of the plane visible at the
+    // end, or -1 if none is, and is resized to the number of stacks.
+    // By default the winners are derived from readDepthCodes().
+    virtual void testStacks(
+        const float                 near,
+        const float                 far,
+        const float                 param_c,
+        const StackDepthFunc        depth_func,
+        const int                   num_planes,
+        const std::vector< float >& planes,
+        std::vector< int >&         winners
+    ) {
+        const int num_stacks = static_cast<int>( planes.size() ) / num_planes;
+
+        // the plane beyond far is clipped away, and keeps the code of the
+        // cleared buffer. the planes with it are taken as clipped.
+        std::vector< float >    stack_planes( planes.begin(), planes.begin() + num_stacks * num_planes );
+        std::vector< uint32_t > codes;
+
+        stack_planes.push_back( 2.0f * far );
+
+        readDepthCodes( near, far, param_c, stack_planes, codes );
+
+        const uint32_t clipped_code = codes.back();
+
+        winners.resize( num_stacks );
+
+        for ( int i = 0; i < num_stacks; i++ ) {
+
+            uint32_t code = ( depth_func == STACK_LESS ) ? clipped_code : 0;
+
+            winners[i] = -1;
+
+            for ( int j = 0; j < num_planes; j++ ) {
+
+                const auto plane_code = codes[ i * num_planes + j ];
+
+                const bool passed = ( depth_func == STACK_LESS ) ? plane_code < code
+                                                                  : plane_code > code && plane_code != clipped_code;
+                if ( passed ) {
+
+                    code       = plane_code;
+                    winners[i] = j;
+                }
+            }
+        }
+    }
+
+    // The same plane pairs under each of the layers.
+    // results is resized to layers.size() * pairs.size(), and has the
+    // results of the pairs one layer after another.
+    // By default the test cases of all the layers are tested with testBatch().
+    virtual void testLayers(
+        const std::vector< Layer >&     layers,
+        const std::vector< PlanePair >& pairs,
+        std::vector< TestResult >&      results
+    ) {
+        std::vector< TestCase > test_cases;
+
+        test_cases.reserve( layers.size() * pairs.size() );
+
+        for ( const auto& layer : layers ) {
+
+            for ( const auto& pair : pairs ) {
+
+                test_cases.push_back( { layer.m_near, layer.m_far, layer.m_param_c, pair.m_plane_1, pair.m_plane_2 } );
+            }
+        }
+
+        testBatch( test_cases, results );
+    }
+
+    // Asynchronous test.
+    // The callback receives the results from pollCompleted() on the same
+    // thread, in the order of submission. pollCompleted() returns the number
+    // of batches delivered. If wait, it blocks until at least one is
+    // delivered, unless none is in flight.
+    // By default the batch is tested synchronously and only the delivery is
+    // deferred. SquareRenderer delivers an empty batch at once instead.
+    virtual void submitBatch(
+        const std::vector< TestCase >& test_cases,
+        Callback                       callback
+    ) {
+        m_pending_batches.emplace_back();
+        testBatch( test_cases, m_pending_batches.back().m_results );
+        m_pending_batches.back().m_callback = std::move( callback );
+    }
+
+    virtual int pollCompleted( const bool wait )
+    {
+        // the batches are tested at the submission, so nothing to wait for.
+        (void)wait;
+
+        int num_completed = 0;
+
+        while ( !m_pending_batches.empty() ) {
+
+            auto batch = std::move( m_pending_batches.front() );
+            m_pending_batches.pop_front();
+
+            batch.m_callback( batch.m_results );
+            num_completed++;
+        }
+
+        return num_completed;
+    }
+
+    virtual int numInFlight() const
+    {
+        return static_cast<int>( m_pending_batches.size() );
+    }
+
+  private:
+
+    struct PendingBatch {
+        std::vector< TestResult > m_results;
+        Callback                  m_callback;
+    };
+
+    std::deque< PendingBatch > m_pending_batches;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_DEPTH_TESTER_HPP__*/
@@ -1,11 +1,45 @@
 #include <cmath>
+#include <cstddef>
+#include <algorithm>
 
 #include "square_renderer.hpp"
 
 namespace DepthTest {
 
-SquareRenderer::SquareRenderer( const DepthTestType depth_test_type )
+// the storage of the depth buffers of a depth format.
+// D16 and D32F come without stencil, which none of the tests uses.
+struct DepthStorage {
+    GLenum m_internal_format;
+    GLenum m_attachment;
+    GLenum m_format; // of the texture images and of the readback
+    GLenum m_type;
+};
+
+static DepthStorage depthStorageOf( const DepthTester::DepthFormat depth_format )
+{
+    switch( depth_format ) {
+
+      case DepthTester::DEPTH_D16:
+        return { GL_DEPTH_COMPONENT16, GL_DEPTH_ATTACHMENT, GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT };
+
+      case DepthTester::DEPTH_D32F:
+        return { GL_DEPTH_COMPONENT32F, GL_DEPTH_ATTACHMENT, GL_DEPTH_COMPONENT, GL_FLOAT };
+
+      default:
+        return { GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL_ATTACHMENT, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8 };
+    }
+}
+
+SquareRenderer::SquareRenderer(
+    const DepthTestType  depth_test_type,
+    const DepthFormat    depth_format,
+    const ClipConvention clip_convention
+)
     :m_depth_test_type             { depth_test_type }
+    ,m_depth_format                { depth_format }
+    ,m_clip_convention             { clip_convention }
+    ,m_clip_control_supported      { GLEW_VERSION_4_5 || GLEW_ARB_clip_control }
+    ,m_detection_mode              { COLOR_READBACK }
     ,m_uniform_M_plane1            { 1.0f }
     ,m_uniform_M_plane2            { 1.0f }
     ,m_uniform_V                   { 1.0f }
@@ -17,29 +51,98 @@ SquareRenderer::SquareRenderer( const DepthTestType depth_test_type )
     ,m_uniform_location_P          { 0 }
     ,m_uniform_location_V          { 0 }
     ,m_uniform_location_M          { 0 }
-    ,m_uniform_location_param_c    { 0 }
-    ,m_uniform_location_log_cf_plus_1_inv
-                                   { 0 }
     ,m_uniform_location_fg_color   { 0 }
+    ,m_uniform_location_depth_params
+                                   { 0, 0 }
+    ,m_num_depth_params            { 0 }
+    ,m_depth_params_function       { nullptr }
+    ,m_gl_prog_id_batch            { 0 }
+    ,m_gl_vertex_array_batch       { 0 }
+    ,m_gl_vertex_buffer_batch_corners
+                                   { 0 }
+    ,m_gl_vertex_buffer_batch_instances
+                                   { 0 }
+    ,m_vertex_location_batch_corner{ 0 }
+    ,m_vertex_location_batch_plane { 0 }
+    ,m_vertex_location_batch_proj_z{ 0 }
+    ,m_vertex_location_batch_depth_params
+                                   { 0 }
+    ,m_uniform_location_batch_grid_width
+                                   { 0 }
+    ,m_uniform_location_batch_grid_wh_inv
+                                   { 0 }
+    ,m_uniform_location_batch_fg_color
+                                   { 0 }
+    ,m_uniform_location_batch_first_instance
+                                   { 0 }
+    ,m_frame_buffer_batch          { 0 }
+    ,m_render_buffer_color_batch   { 0 }
+    ,m_render_buffer_depth_stencil_batch
+                                   { 0 }
+    ,m_batch_width                 { 0 }
+    ,m_batch_height                { 0 }
+    ,m_frame_buffer_depth_codes    { 0 }
+    ,m_texture_depth_codes         { 0 }
+    ,m_depth_codes_width           { 0 }
+    ,m_depth_codes_height          { 0 }
+    ,m_gl_prog_id_layered          { 0 }
+    ,m_gl_vertex_array_layered     { 0 }
+    ,m_gl_vertex_buffer_layered_pairs
+                                   { 0 }
+    ,m_gl_uniform_buffer_layers    { 0 }
+    ,m_vertex_location_layered_corner
+                                   { 0 }
+    ,m_vertex_location_layered_plane
+                                   { 0 }
+    ,m_uniform_location_layered_num_layers
+                                   { 0 }
+    ,m_uniform_location_layered_grid_width
+                                   { 0 }
+    ,m_uniform_location_layered_grid_wh_inv
+                                   { 0 }
+    ,m_uniform_location_layered_fg_color
+                                   { 0 }
+    ,m_frame_buffer_layered        { 0 }
+    ,m_texture_color_layered       { 0 }
+    ,m_texture_depth_stencil_layered
+                                   { 0 }
+    ,m_layered_width               { 0 }
+    ,m_layered_height              { 0 }
+    ,m_layered_num_layers          { 0 }
+    ,m_readback_slots              ( READBACK_RING_SIZE )
+    ,m_readback_head               { 0 }
+    ,m_num_readbacks_in_flight     { 0 }
+    ,m_num_batches_in_flight       { 0 }
+    ,m_submitting                  { false }
+    ,m_profiler                    { nullptr }
 {
-    switch( m_depth_test_type ) {
-
-      case PERSPECTIVE:
-        m_gl_prog_id = compileAndLink( VERT_STR_NORMAL_DEPTH, FRAG_STR_NORMAL_DEPTH, std::cerr );
-        break;
+    if ( m_clip_convention != CLIP_STANDARD && m_depth_test_type != PERSPECTIVE ) {
 
-      case LOG_DEPTH_FN:
-        m_gl_prog_id = compileAndLink( VERT_STR_LOG_DEPTH_FN, FRAG_STR_LOG_DEPTH_FN, std::cerr );
-        break;
+        throw std::runtime_error( "the reversed clip conventions are for the perspective depth only." );
+    }
 
-      case LOG_DEPTH_CF:
-        m_gl_prog_id = compileAndLink( VERT_STR_LOG_DEPTH_CF, FRAG_STR_LOG_DEPTH_CF, std::cerr );
-        break;
+    if ( m_clip_convention == CLIP_REVERSED && !m_clip_control_supported ) {
 
-      default:
-        throw std::runtime_error("unknown depth type");
+        m_clip_convention = CLIP_REVERSED_DEPTH_RANGE;
     }
 
+    std::vector< std::string > param_names;
+
+    visitDepthEncoding( m_depth_test_type, [ & ]( auto encoding ) {
+
+        using Encoding = decltype( encoding );
+
+        m_gl_prog_id       = compileAndLink( vertStrOf< Encoding >(), fragStrOf< Encoding >(), std::cerr );
+        m_gl_prog_id_batch = compileAndLink( VERT_STR_BATCH, fragStrBatchOf< Encoding >(), std::cerr );
+
+        m_num_depth_params      = Encoding::NUM_PARAMS;
+        m_depth_params_function = &Encoding::params;
+
+        for ( int i = 0; i < Encoding::NUM_PARAMS; i++ ) {
+            param_names.push_back( Encoding::PARAM_NAMES[i] );
+        }
+    } );
+
     glGenVertexArrays ( 1, &m_gl_vertex_array  );
 
     glBindVertexArray( m_gl_vertex_array );
@@ -53,23 +156,9 @@ SquareRenderer::SquareRenderer( const DepthTestType depth_test_type )
     m_uniform_location_M           = glGetUniformLocation( m_gl_prog_id, "M" );
     m_uniform_location_fg_color    = glGetUniformLocation( m_gl_prog_id, "fg_color" );
 
-    switch( m_depth_test_type ) {
-
-      case PERSPECTIVE:
-        break;
-
-      case LOG_DEPTH_FN:
-        m_uniform_location_log_near = glGetUniformLocation( m_gl_prog_id, "log_near" );
-        m_uniform_location_log_far  = glGetUniformLocation( m_gl_prog_id, "log_far" );
-        break;
+    for ( int i = 0; i < m_num_depth_params; i++ ) {
 
-      case LOG_DEPTH_CF:
-        m_uniform_location_param_c = glGetUniformLocation( m_gl_prog_id, "param_c" );
-        m_uniform_location_log_cf_plus_1_inv
-                                   = glGetUniformLocation( m_gl_prog_id, "log_cf_plus_1_inv" );
-        break;
-      default:
-        ;
+        m_uniform_location_depth_params[i] = glGetUniformLocation( m_gl_prog_id, param_names[i].c_str() );
     }
 
     glGenBuffers( 1, &m_gl_vertex_buffer );
@@ -84,15 +173,147 @@ SquareRenderer::SquareRenderer( const DepthTestType depth_test_type )
     glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, 1, 1 );
     glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_render_buffer_color_tester );
 
+    const auto depth_storage = depthStorageOf( m_depth_format );
+
     glGenRenderbuffers( 1, &m_render_buffer_depth_stencil_tester );
     glBindRenderbuffer( GL_RENDERBUFFER, m_render_buffer_depth_stencil_tester );
-    glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, 1, 1 );
-    glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_render_buffer_depth_stencil_tester );
+    glRenderbufferStorage( GL_RENDERBUFFER, depth_storage.m_internal_format, 1, 1 );
+    glFramebufferRenderbuffer( GL_FRAMEBUFFER, depth_storage.m_attachment, GL_RENDERBUFFER, m_render_buffer_depth_stencil_tester );
     glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+    // batched test
+
+    glGenVertexArrays( 1, &m_gl_vertex_array_batch );
+    glBindVertexArray( m_gl_vertex_array_batch );
+    glUseProgram( m_gl_prog_id_batch );
+
+    m_vertex_location_batch_corner       = BATCH_LOCATION_CORNER;
+    m_vertex_location_batch_plane        = BATCH_LOCATION_PLANE;
+    m_vertex_location_batch_proj_z       = BATCH_LOCATION_PROJ_Z;
+    m_vertex_location_batch_depth_params = BATCH_LOCATION_DEPTH_PARAMS;
+
+    m_uniform_location_batch_grid_width  = glGetUniformLocation( m_gl_prog_id_batch, "grid_width" );
+    m_uniform_location_batch_grid_wh_inv = glGetUniformLocation( m_gl_prog_id_batch, "grid_wh_inv" );
+    m_uniform_location_batch_fg_color    = glGetUniformLocation( m_gl_prog_id_batch, "fg_color" );
+    m_uniform_location_batch_first_instance
+                                         = glGetUniformLocation( m_gl_prog_id_batch, "first_instance" );
+
+    const glm::vec2 corners[6] = {
+        { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 0.0f, 1.0f },
+        { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f }
+    };
+
+    glGenBuffers( 1, &m_gl_vertex_buffer_batch_corners );
+    glBindBuffer( GL_ARRAY_BUFFER, m_gl_vertex_buffer_batch_corners );
+    glBufferData( GL_ARRAY_BUFFER, 6 * sizeof(glm::vec2), corners, GL_STATIC_DRAW );
+
+    glEnableVertexAttribArray( m_vertex_location_batch_corner );
+    glVertexAttribPointer( m_vertex_location_batch_corner, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0 );
+
+    glGenBuffers( 1, &m_gl_vertex_buffer_batch_instances );
+    glBindBuffer( GL_ARRAY_BUFFER, m_gl_vertex_buffer_batch_instances );
+    glBufferData(
+        GL_ARRAY_BUFFER,
+        MAX_BATCH_GRID_WIDTH * MAX_BATCH_GRID_WIDTH * sizeof(BatchInstance),
+        nullptr,
+        GL_STREAM_DRAW
+    );
+
+    glEnableVertexAttribArray( m_vertex_location_batch_plane );
+    glEnableVertexAttribArray( m_vertex_location_batch_proj_z );
+    glEnableVertexAttribArray( m_vertex_location_batch_depth_params );
+
+    glVertexAttribPointer(
+        m_vertex_location_batch_proj_z,
+        2,
+        GL_FLOAT,
+        GL_FALSE,
+        sizeof(BatchInstance),
+        (void*)offsetof( BatchInstance, m_proj_z )
+    );
+
+    glVertexAttribPointer(
+        m_vertex_location_batch_depth_params,
+        2,
+        GL_FLOAT,
+        GL_FALSE,
+        sizeof(BatchInstance),
+        (void*)offsetof( BatchInstance, m_depth_params )
+    );
+
+    glVertexAttribDivisor( m_vertex_location_batch_plane,        1 );
+    glVertexAttribDivisor( m_vertex_location_batch_proj_z,       1 );
+    glVertexAttribDivisor( m_vertex_location_batch_depth_params, 1 );
+
+    glBindVertexArray( 0 );
+
+    glGenFramebuffers ( 1, &m_frame_buffer_batch );
+    glGenRenderbuffers( 1, &m_render_buffer_color_batch );
+    glGenRenderbuffers( 1, &m_render_buffer_depth_stencil_batch );
+
+    glGenFramebuffers( 1, &m_frame_buffer_depth_codes );
+    glGenTextures    ( 1, &m_texture_depth_codes );
+
+    // asynchronous readback
+    for ( auto& slot : m_readback_slots ) {
+
+        glGenBuffers( 1, &slot.m_pixel_buffer );
+        glBindBuffer( GL_PIXEL_PACK_BUFFER, slot.m_pixel_buffer );
+        glBufferData(
+            GL_PIXEL_PACK_BUFFER,
+            MAX_BATCH_GRID_WIDTH * MAX_BATCH_GRID_WIDTH * 4,
+            nullptr,
+            GL_STREAM_READ
+        );
+    }
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
 }
 
 SquareRenderer::~SquareRenderer()
 {
+    if ( m_profiler != nullptr ) {
+        m_profiler->releaseQueries();
+    }
+
+    for ( auto& slot : m_readback_slots ) {
+
+        if ( slot.m_fence != nullptr ) {
+            glDeleteSync( slot.m_fence );
+        }
+        glDeleteBuffers( 1, &slot.m_pixel_buffer );
+
+        if ( !slot.m_queries.empty() ) {
+            glDeleteQueries( slot.m_queries.size(), slot.m_queries.data() );
+        }
+    }
+
+    if ( !m_batch_queries.empty() ) {
+        glDeleteQueries( m_batch_queries.size(), m_batch_queries.data() );
+    }
+
+    if ( m_gl_prog_id_layered != 0 ) {
+
+        glDeleteTextures     ( 1, &m_texture_depth_stencil_layered );
+        glDeleteTextures     ( 1, &m_texture_color_layered );
+        glDeleteFramebuffers ( 1, &m_frame_buffer_layered );
+        glDeleteBuffers      ( 1, &m_gl_uniform_buffer_layers );
+        glDeleteBuffers      ( 1, &m_gl_vertex_buffer_layered_pairs );
+        glDeleteProgram      (     m_gl_prog_id_layered );
+        glDeleteVertexArrays ( 1, &m_gl_vertex_array_layered );
+    }
+
+    glDeleteTextures     ( 1, &m_texture_depth_codes );
+    glDeleteFramebuffers ( 1, &m_frame_buffer_depth_codes );
+
+    glDeleteRenderbuffers( 1, &m_render_buffer_depth_stencil_batch );
+    glDeleteRenderbuffers( 1, &m_render_buffer_color_batch );
+    glDeleteFramebuffers ( 1, &m_frame_buffer_batch );
+
+    glDeleteBuffers      ( 1, &m_gl_vertex_buffer_batch_instances );
+    glDeleteBuffers      ( 1, &m_gl_vertex_buffer_batch_corners );
+    glDeleteProgram      (     m_gl_prog_id_batch       );
+    glDeleteVertexArrays ( 1, &m_gl_vertex_array_batch  );
+
     glDeleteRenderbuffers( 1, &m_render_buffer_depth_stencil_tester );
     glDeleteRenderbuffers( 1, &m_render_buffer_color_tester );
     glDeleteFramebuffers( 1, &m_frame_buffer_tester );
@@ -162,25 +383,7 @@ void SquareRenderer::renderInteractive(
     glUniformMatrix4fv( m_uniform_location_M, 1, GL_FALSE, &Mmodel_1[0][0] );
     glUniform4fv( m_uniform_location_fg_color, 1, &(color_1[0] ) );
 
-    switch( m_depth_test_type ) {
-
-      case PERSPECTIVE:
-        break;
-
-      case LOG_DEPTH_FN:
-
-        glUniform1f( m_uniform_location_log_near, log( near ) );
-        glUniform1f( m_uniform_location_log_far,  log( far  ) );
-        break;
-
-      case LOG_DEPTH_CF:
-        glUniform1f( m_uniform_location_param_c, param_c );
-        glUniform1f( m_uniform_location_log_cf_plus_1_inv, 1.0f / log( param_c * far + 1.0f ) ); 
-        break;
-
-      default:
-        ;
-    }
+    setDepthParamUniforms( near, far, param_c );
 
     glEnableVertexAttribArray( m_vertex_location_position_lcs );
 
@@ -214,13 +417,23 @@ void SquareRenderer::test(
     bool&       plane_2_detected
 ) {
 
+    if ( m_profiler != nullptr ) {
+        m_profiler->beginProbe();
+    }
+
     glBindFramebuffer( GL_FRAMEBUFFER, m_frame_buffer_tester );
 
-    glClearColor( 0.0f, 0.0f, 0.0f, 0.0f );
-    glClear( GL_COLOR_BUFFER_BIT );
-    glClear( GL_DEPTH_BUFFER_BIT );
-    glStencilMask( 0xff );
-    glClear( GL_STENCIL_BUFFER_BIT );
+    applyClipConvention();
+
+    {
+        StageProfiler::Scope scope( m_profiler, StageProfiler::CLEAR );
+
+        glClearColor( 0.0f, 0.0f, 0.0f, 0.0f );
+        glClear( GL_COLOR_BUFFER_BIT );
+        glClear( GL_DEPTH_BUFFER_BIT );
+        glStencilMask( 0xff );
+        glClear( GL_STENCIL_BUFFER_BIT );
+    }
     glDisable( GL_BLEND );
     glEnable( GL_DEPTH_TEST );
     glDisable( GL_CULL_FACE );
@@ -233,17 +446,9 @@ void SquareRenderer::test(
 
     const float fovy_half = 0.22f * M_PI;
     const float top  = atan( fovy_half * 0.5f ) * near;
-    const float edge_one_pixel = top / 512.0f; // assuming 1024 pixels.
 
     glm::mat4 Mview{1.0f};
-    glm::mat4 Mproj = glm::frustum(
-        -0.5f * edge_one_pixel,
-         0.5f * edge_one_pixel,
-        -0.5f * edge_one_pixel,
-         0.5f * edge_one_pixel,
-         near,
-         far 
-    );
+    glm::mat4 Mproj = testProjection( near, far, m_clip_convention );
 
     glm::mat4 Mmodel_1{1.0f};
     Mmodel_1[3][2] = -1.0 * plane_1;
@@ -277,25 +482,7 @@ void SquareRenderer::test(
     glUniformMatrix4fv( m_uniform_location_M, 1, GL_FALSE, &Mmodel_1[0][0] );
     glUniform4fv( m_uniform_location_fg_color, 1, &(color_1[0] ) );
 
-    switch( m_depth_test_type ) {
-
-      case PERSPECTIVE:
-        break;
-
-      case LOG_DEPTH_FN:
-
-        glUniform1f( m_uniform_location_log_near, log( near ) );
-        glUniform1f( m_uniform_location_log_far,  log( far  ) );
-        break;
-
-      case LOG_DEPTH_CF:
-        glUniform1f( m_uniform_location_param_c, param_c );
-        glUniform1f( m_uniform_location_log_cf_plus_1_inv, 1.0f / log( param_c * far + 1.0f ) ); 
-        break;
-
-      default:
-        ;
-    }
+    setDepthParamUniforms( near, far, param_c );
 
     glEnableVertexAttribArray( m_vertex_location_position_lcs );
 
@@ -308,26 +495,1261 @@ void SquareRenderer::test(
         (void*)0
     );
 
-    glDrawArrays( GL_TRIANGLES, 0, 6 );
+    {
+        StageProfiler::Scope scope( m_profiler, StageProfiler::DRAW_PLANE_1 );
+
+        glDrawArrays( GL_TRIANGLES, 0, 6 );
+    }
 
     glUniformMatrix4fv( m_uniform_location_M, 1, GL_FALSE, &Mmodel_2[0][0] );
     glUniform4fv( m_uniform_location_fg_color, 1, &(color_2[0] ) );
 
-    glDrawArrays( GL_TRIANGLES, 0, 6 );
+    {
+        StageProfiler::Scope scope( m_profiler, StageProfiler::DRAW_PLANE_2 );
+
+        glDrawArrays( GL_TRIANGLES, 0, 6 );
+    }
 
     glDisableVertexAttribArray( m_vertex_location_position_lcs );
 
-    glFlush();
-    glFinish();
+    {
+        StageProfiler::Scope scope( m_profiler, StageProfiler::FINISH );
+
+        glFlush();
+        glFinish();
+    }
     glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
 
     unsigned char pixel_read[4];
-    glReadPixels( 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel_read );
+    {
+        StageProfiler::Scope scope( m_profiler, StageProfiler::READBACK );
+
+        glReadPixels( 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel_read );
+    }
     glBindFramebuffer( GL_FRAMEBUFFER, 0 );
 
+    if ( m_profiler != nullptr ) {
+
+        m_profiler->endProbe( 1 );
+        m_profiler->resolveOldest();
+    }
+
     plane_1_detected = ( pixel_read[0] == 255 && pixel_read[1] == 0 );
 
     plane_2_detected = ( pixel_read[1] == 255 && pixel_read[0] == 0 );
 }
 
+
+glm::mat4 SquareRenderer::testProjection(
+    const float          near,
+    const float          far,
+    const ClipConvention clip_convention
+) {
+    const float fovy_half = 0.22f * M_PI;
+    const float top  = atan( fovy_half * 0.5f ) * near;
+    const float edge_one_pixel = top / 512.0f; // assuming 1024 pixels.
+
+    auto Mproj = glm::frustum(
+        -0.5f * edge_one_pixel,
+         0.5f * edge_one_pixel,
+        -0.5f * edge_one_pixel,
+         0.5f * edge_one_pixel,
+         near,
+         far 
+    );
+
+    if ( clip_convention == CLIP_REVERSED ) {
+
+        // z_clip / w is 1 at near and 0 at far.
+        Mproj[2][2] = near / ( far - near );
+        Mproj[3][2] = ( far * near ) / ( far - near );
+    }
+
+    return Mproj;
+}
+
+void SquareRenderer::applyClipConvention() const
+{
+    const bool reversed = ( m_clip_convention != CLIP_STANDARD );
+
+    if ( m_clip_control_supported ) {
+
+        glClipControl( GL_LOWER_LEFT, ( m_clip_convention == CLIP_REVERSED ) ? GL_ZERO_TO_ONE : GL_NEGATIVE_ONE_TO_ONE );
+    }
+
+    if ( m_clip_convention == CLIP_REVERSED_DEPTH_RANGE ) {
+        glDepthRange( 1.0, 0.0 );
+    }
+    else {
+        glDepthRange( 0.0, 1.0 );
+    }
+
+    glClearDepth( reversed ? 0.0 : 1.0 );
+    glDepthFunc( reversed ? GL_GREATER : GL_LESS );
+}
+
+void SquareRenderer::setDepthParamUniforms( const float near, const float far, const float param_c ) const
+{
+    float depth_params[2];
+
+    m_depth_params_function( near, far, param_c, depth_params );
+
+    for ( int i = 0; i < m_num_depth_params; i++ ) {
+
+        glUniform1f( m_uniform_location_depth_params[i], depth_params[i] );
+    }
+}
+
+void SquareRenderer::setDepthParams( BatchInstance& instance, const TestCase& test_case ) const
+{
+    // the same values as the uniforms set in test().
+    m_depth_params_function( test_case.m_near, test_case.m_far, test_case.m_param_c, instance.m_depth_params );
+}
+
+void SquareRenderer::resizeBatchFrameBuffer( const int width, const int height )
+{
+    if ( width <= m_batch_width && height <= m_batch_height ) {
+        return;
+    }
+
+    m_batch_width  = std::max( width,  m_batch_width  );
+    m_batch_height = std::max( height, m_batch_height );
+
+    glBindFramebuffer( GL_FRAMEBUFFER, m_frame_buffer_batch );
+
+    glBindRenderbuffer( GL_RENDERBUFFER, m_render_buffer_color_batch );
+    glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, m_batch_width, m_batch_height );
+    glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_render_buffer_color_batch );
+
+    const auto depth_storage = depthStorageOf( m_depth_format );
+
+    glBindRenderbuffer( GL_RENDERBUFFER, m_render_buffer_depth_stencil_batch );
+    glRenderbufferStorage( GL_RENDERBUFFER, depth_storage.m_internal_format, m_batch_width, m_batch_height );
+    glFramebufferRenderbuffer( GL_FRAMEBUFFER, depth_storage.m_attachment, GL_RENDERBUFFER, m_render_buffer_depth_stencil_batch );
+
+    if ( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE ) {
+
+        throw std::runtime_error( "batch framebuffer incomplete." );
+    }
+
+    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
+
+void SquareRenderer::testBatch(
+    const std::vector< TestCase >& test_cases,
+    std::vector< TestResult >&     results
+) {
+    const int num_test_cases = static_cast<int>( test_cases.size() );
+    const int max_chunk      = MAX_BATCH_GRID_WIDTH * MAX_BATCH_GRID_WIDTH;
+
+    results.resize( test_cases.size() );
+
+    if ( m_profiler != nullptr ) {
+        m_profiler->beginProbe();
+    }
+
+    for ( int start = 0; start < num_test_cases; start += max_chunk ) {
+
+        testBatchChunk(
+            &test_cases[ start ],
+            std::min( max_chunk, num_test_cases - start ),
+            &results[ start ]
+        );
+    }
+
+    if ( m_profiler != nullptr ) {
+
+        // the results are read back. the queries are available.
+        m_profiler->endProbe( num_test_cases );
+        m_profiler->resolveOldest();
+    }
+}
+
+void SquareRenderer::testBatchChunk(
+    const TestCase* test_cases,
+    const int       num_test_cases,
+    TestResult*     results
+) {
+    int width;
+    int height;
+
+    if ( m_detection_mode == OCCLUSION_QUERY ) {
+
+        reserveQueries( m_batch_queries, num_test_cases );
+
+        drawBatchChunk( test_cases, num_test_cases, m_batch_queries.data(), width, height );
+        glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+        StageProfiler::Scope scope( m_profiler, StageProfiler::READBACK );
+
+        decodeBatchQueries( m_batch_queries.data(), num_test_cases, results );
+        return;
+    }
+
+    drawBatchChunk( test_cases, num_test_cases, nullptr, width, height );
+
+    m_batch_pixels.resize( width * height * 4 );
+
+    {
+        StageProfiler::Scope scope( m_profiler, StageProfiler::READBACK );
+
+        glReadPixels( 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, m_batch_pixels.data() );
+    }
+    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+    decodeBatchPixels( m_batch_pixels.data(), num_test_cases, results );
+}
+
+void SquareRenderer::drawBatchChunk(
+    const TestCase* test_cases,
+    const int       num_test_cases,
+    const GLuint*   queries,
+    int&            width,
+    int&            height
+) {
+    width  = std::min( num_test_cases, MAX_BATCH_GRID_WIDTH );
+    height = ( num_test_cases + width - 1 ) / width;
+
+    resizeBatchFrameBuffer( width, height );
+
+    glBindFramebuffer( GL_FRAMEBUFFER, m_frame_buffer_batch );
+
+    applyClipConvention();
+
+    {
+        StageProfiler::Scope scope( m_profiler, StageProfiler::CLEAR );
+
+        glClearColor( 0.0f, 0.0f, 0.0f, 0.0f );
+        glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+    }
+    glDisable( GL_BLEND );
+    glEnable( GL_DEPTH_TEST );
+    glDisable( GL_CULL_FACE );
+    glDisable( GL_STENCIL_TEST );
+
+    glViewport( 0, 0, width, height );
+
+    glBindVertexArray( m_gl_vertex_array_batch );
+    glUseProgram( m_gl_prog_id_batch );
+
+    glUniform1i( m_uniform_location_batch_grid_width, width );
+    glUniform2f(
+        m_uniform_location_batch_grid_wh_inv,
+        1.0f / static_cast<float>( width ),
+        1.0f / static_cast<float>( height )
+    );
+
+    uploadBatchInstances( test_cases, num_test_cases );
+
+    if ( queries != nullptr ) {
+
+        drawBatchQueries( num_test_cases, queries );
+        return;
+    }
+
+    glUniform1i( m_uniform_location_batch_first_instance, 0 );
+
+    const glm::vec4 color_1{ 1.0f, 0.0f, 0.0f, 1.0f};
+    const glm::vec4 color_2{ 0.0f, 1.0f, 0.0f, 1.0f};
+
+    glVertexAttribPointer(
+        m_vertex_location_batch_plane,
+        1,
+        GL_FLOAT,
+        GL_FALSE,
+        sizeof(BatchInstance),
+        (void*)offsetof( BatchInstance, m_plane_1 )
+    );
+    glUniform4fv( m_uniform_location_batch_fg_color, 1, &(color_1[0] ) );
+    {
+        StageProfiler::Scope scope( m_profiler, StageProfiler::DRAW_PLANE_1 );
+
+        glDrawArraysInstanced( GL_TRIANGLES, 0, 6, num_test_cases );
+    }
+
+    glVertexAttribPointer(
+        m_vertex_location_batch_plane,
+        1,
+        GL_FLOAT,
+        GL_FALSE,
+        sizeof(BatchInstance),
+        (void*)offsetof( BatchInstance, m_plane_2 )
+    );
+    glUniform4fv( m_uniform_location_batch_fg_color, 1, &(color_2[0] ) );
+    {
+        StageProfiler::Scope scope( m_profiler, StageProfiler::DRAW_PLANE_2 );
+
+        glDrawArraysInstanced( GL_TRIANGLES, 0, 6, num_test_cases );
+    }
+
+    glBindVertexArray( 0 );
+}
+
+void SquareRenderer::uploadBatchInstances( const TestCase* test_cases, const int num_test_cases )
+{
+    m_batch_instances.resize( num_test_cases );
+
+    for ( int i = 0; i < num_test_cases; i++ ) {
+
+        const auto& test_case = test_cases[i];
+        auto&       instance  = m_batch_instances[i];
+
+        const auto Mproj = testProjection( test_case.m_near, test_case.m_far, m_clip_convention );
+
+        instance.m_plane_1   = test_case.m_plane_1;
+        instance.m_plane_2   = test_case.m_plane_2;
+        instance.m_proj_z[0] = Mproj[2][2];
+        instance.m_proj_z[1] = Mproj[3][2];
+
+        setDepthParams( instance, test_case );
+    }
+
+    glBindBuffer( GL_ARRAY_BUFFER, m_gl_vertex_buffer_batch_instances );
+    glBufferSubData( GL_ARRAY_BUFFER, 0, num_test_cases * sizeof(BatchInstance), m_batch_instances.data() );
+}
+
+void SquareRenderer::readDepthCodes(
+    const float                 near,
+    const float                 far,
+    const float                 param_c,
+    const std::vector< float >& planes,
+    std::vector< uint32_t >&    codes
+) {
+    const int num_planes = static_cast<int>( planes.size() );
+    const int max_chunk  = MAX_BATCH_GRID_WIDTH * MAX_BATCH_GRID_WIDTH;
+
+    codes.resize( planes.size() );
+
+    for ( int start = 0; start < num_planes; start += max_chunk ) {
+
+        const int num_in_chunk = std::min( max_chunk, num_planes - start );
+
+        m_depth_code_cases.resize( num_in_chunk );
+
+        for ( int i = 0; i < num_in_chunk; i++ ) {
+
+            const auto plane = planes[ start + i ];
+            m_depth_code_cases[i] = { near, far, param_c, plane, plane };
+        }
+
+        readDepthCodesChunk( m_depth_code_cases.data(), num_in_chunk, &codes[ start ] );
+    }
+}
+
+void SquareRenderer::readDepthCodesChunk(
+    const TestCase* test_cases,
+    const int       num_test_cases,
+    uint32_t*       codes
+) {
+    const int width  = std::min( num_test_cases, MAX_BATCH_GRID_WIDTH );
+    const int height = ( num_test_cases + width - 1 ) / width;
+
+    resizeDepthCodeFrameBuffer( width, height );
+
+    glBindFramebuffer( GL_FRAMEBUFFER, m_frame_buffer_depth_codes );
+
+    applyClipConvention();
+
+    glClear( GL_DEPTH_BUFFER_BIT );
+    glDisable( GL_BLEND );
+    glEnable( GL_DEPTH_TEST );
+    glDisable( GL_CULL_FACE );
+    glDisable( GL_STENCIL_TEST );
+
+    glViewport( 0, 0, width, height );
+
+    glBindVertexArray( m_gl_vertex_array_batch );
+    glUseProgram( m_gl_prog_id_batch );
+
+    glUniform1i( m_uniform_location_batch_grid_width, width );
+    glUniform2f(
+        m_uniform_location_batch_grid_wh_inv,
+        1.0f / static_cast<float>( width ),
+        1.0f / static_cast<float>( height )
+    );
+    glUniform1i( m_uniform_location_batch_first_instance, 0 );
+
+    uploadBatchInstances( test_cases, num_test_cases );
+
+    pointBatchInstanceAttributes( 0, offsetof( BatchInstance, m_plane_1 ) );
+
+    glDrawArraysInstanced( GL_TRIANGLES, 0, 6, num_test_cases );
+
+    glBindVertexArray( 0 );
+
+    // the codes as they are in the buffer.
+    switch( m_depth_format ) {
+
+      case DEPTH_D16:
+        m_depth_code_pixels_16.resize( width * height );
+
+        glPixelStorei( GL_PACK_ALIGNMENT, 2 );
+        glReadPixels( 0, 0, width, height, GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT, m_depth_code_pixels_16.data() );
+
+        for ( int i = 0; i < num_test_cases; i++ ) {
+
+            codes[i] = m_depth_code_pixels_16[i];
+        }
+        break;
+
+      case DEPTH_D32F:
+        // the bits of the floats. non-negative floats compare in the same
+        // order as their bits.
+        m_depth_code_pixels.resize( width * height );
+
+        glPixelStorei( GL_PACK_ALIGNMENT, 4 );
+        glReadPixels( 0, 0, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, m_depth_code_pixels.data() );
+
+        std::copy( m_depth_code_pixels.begin(), m_depth_code_pixels.begin() + num_test_cases, codes );
+        break;
+
+      default:
+        // D24S8. the depth code is in the upper 24 bits.
+        m_depth_code_pixels.resize( width * height );
+
+        glPixelStorei( GL_PACK_ALIGNMENT, 4 );
+        glReadPixels( 0, 0, width, height, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, m_depth_code_pixels.data() );
+
+        for ( int i = 0; i < num_test_cases; i++ ) {
+
+            codes[i] = m_depth_code_pixels[i] >> 8;
+        }
+    }
+    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
+
+void SquareRenderer::resizeDepthCodeFrameBuffer( const int width, const int height )
+{
+    if ( width <= m_depth_codes_width && height <= m_depth_codes_height ) {
+        return;
+    }
+
+    m_depth_codes_width  = std::max( width,  m_depth_codes_width  );
+    m_depth_codes_height = std::max( height, m_depth_codes_height );
+
+    const auto depth_storage = depthStorageOf( m_depth_format );
+
+    glBindTexture( GL_TEXTURE_2D, m_texture_depth_codes );
+    glTexImage2D(
+        GL_TEXTURE_2D,
+        0,
+        depth_storage.m_internal_format,
+        m_depth_codes_width,
+        m_depth_codes_height,
+        0,
+        depth_storage.m_format,
+        depth_storage.m_type,
+        nullptr
+    );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+    glBindTexture( GL_TEXTURE_2D, 0 );
+
+    glBindFramebuffer( GL_FRAMEBUFFER, m_frame_buffer_depth_codes );
+    glFramebufferTexture2D( GL_FRAMEBUFFER, depth_storage.m_attachment, GL_TEXTURE_2D, m_texture_depth_codes, 0 );
+
+    // depth only.
+    glDrawBuffer( GL_NONE );
+    glReadBuffer( GL_NONE );
+
+    if ( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE ) {
+
+        throw std::runtime_error( "depth code framebuffer incomplete." );
+    }
+
+    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
+
+void SquareRenderer::testStacks(
+    const float                 near,
+    const float                 far,
+    const float                 param_c,
+    const StackDepthFunc        depth_func,
+    const int                   num_planes,
+    const std::vector< float >& planes,
+    std::vector< int >&         winners
+) {
+    if ( num_planes < 1 || num_planes > MAX_STACK_PLANES ) {
+
+        throw std::runtime_error( "stack size out of range." );
+    }
+
+    if ( m_clip_convention != CLIP_STANDARD ) {
+
+        throw std::runtime_error( "the stack test is for the standard clip convention only." );
+    }
+
+    const int num_stacks = static_cast<int>( planes.size() ) / num_planes;
+
+    // the instance buffer holds one instance per plane.
+    const int max_chunk  = ( MAX_BATCH_GRID_WIDTH * MAX_BATCH_GRID_WIDTH ) / num_planes;
+
+    winners.resize( num_stacks );
+
+    for ( int start = 0; start < num_stacks; start += max_chunk ) {
+
+        testStacksChunk(
+            near,
+            far,
+            param_c,
+            depth_func,
+            num_planes,
+            &planes[ start * num_planes ],
+            std::min( max_chunk, num_stacks - start ),
+            &winners[ start ]
+        );
+    }
+}
+
+void SquareRenderer::testStacksChunk(
+    const float          near,
+    const float          far,
+    const float          param_c,
+    const StackDepthFunc depth_func,
+    const int            num_planes,
+    const float*         planes,
+    const int            num_stacks,
+    int*                 winners
+) {
+    const int width  = std::min( num_stacks, MAX_BATCH_GRID_WIDTH );
+    const int height = ( num_stacks + width - 1 ) / width;
+
+    resizeBatchFrameBuffer( width, height );
+
+    glBindFramebuffer( GL_FRAMEBUFFER, m_frame_buffer_batch );
+
+    const bool greater = ( depth_func == STACK_GREATER );
+
+    applyClipConvention();
+
+    glClearColor( 0.0f, 0.0f, 0.0f, 0.0f );
+    glClearDepth( greater ? 0.0 : 1.0 );
+    glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+    glDisable( GL_BLEND );
+    glEnable( GL_DEPTH_TEST );
+    glDepthFunc( greater ? GL_GREATER : GL_LESS );
+    glDisable( GL_CULL_FACE );
+    glDisable( GL_STENCIL_TEST );
+
+    glViewport( 0, 0, width, height );
+
+    glBindVertexArray( m_gl_vertex_array_batch );
+    glUseProgram( m_gl_prog_id_batch );
+
+    glUniform1i( m_uniform_location_batch_grid_width, width );
+    glUniform2f(
+        m_uniform_location_batch_grid_wh_inv,
+        1.0f / static_cast<float>( width ),
+        1.0f / static_cast<float>( height )
+    );
+    glUniform1i( m_uniform_location_batch_first_instance, 0 );
+
+    // the j-th draw takes the instances from num_stacks * j on.
+    m_stack_cases.resize( num_stacks * num_planes );
+
+    for ( int j = 0; j < num_planes; j++ ) {
+
+        for ( int i = 0; i < num_stacks; i++ ) {
+
+            const auto plane = planes[ i * num_planes + j ];
+            m_stack_cases[ j * num_stacks + i ] = { near, far, param_c, plane, plane };
+        }
+    }
+
+    uploadBatchInstances( m_stack_cases.data(), num_stacks * num_planes );
+
+    for ( int j = 0; j < num_planes; j++ ) {
+
+        const glm::vec4 color_id{ static_cast<float>( j + 1 ) / 255.0f, 0.0f, 0.0f, 1.0f };
+
+        pointBatchInstanceAttributes( j * num_stacks, offsetof( BatchInstance, m_plane_1 ) );
+        glUniform4fv( m_uniform_location_batch_fg_color, 1, &(color_id[0] ) );
+
+        glDrawArraysInstanced( GL_TRIANGLES, 0, 6, num_stacks );
+    }
+
+    // restore the pointers of the instanced draws. the other tests set
+    // their depth test in applyClipConvention().
+    pointBatchInstanceAttributes( 0, offsetof( BatchInstance, m_plane_1 ) );
+
+    glBindVertexArray( 0 );
+
+    m_batch_pixels.resize( width * height * 4 );
+
+    glReadPixels( 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, m_batch_pixels.data() );
+    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+    for ( int i = 0; i < num_stacks; i++ ) {
+
+        // 0 is the cleared color.
+        winners[i] = static_cast<int>( m_batch_pixels[ 4 * i ] ) - 1;
+    }
+}
+
+void SquareRenderer::testLayers(
+    const std::vector< Layer >&     layers,
+    const std::vector< PlanePair >& pairs,
+    std::vector< TestResult >&      results
+) {
+    const int num_layers = static_cast<int>( layers.size() );
+    const int num_pairs  = static_cast<int>( pairs.size() );
+    const int max_chunk  = MAX_BATCH_GRID_WIDTH * MAX_BATCH_GRID_WIDTH;
+
+    results.resize( layers.size() * pairs.size() );
+
+    if ( m_gl_prog_id_layered == 0 ) {
+        setUpLayers();
+    }
+
+    for ( int first_layer = 0; first_layer < num_layers; first_layer += MAX_LAYERS ) {
+
+        const int layers_in_chunk = std::min( MAX_LAYERS, num_layers - first_layer );
+
+        for ( int start = 0; start < num_pairs; start += max_chunk ) {
+
+            const int pairs_in_chunk = std::min( max_chunk, num_pairs - start );
+
+            testLayersChunk(
+                &layers[ first_layer ],
+                layers_in_chunk,
+                &pairs[ start ],
+                pairs_in_chunk,
+                num_pairs,
+                &results[ static_cast<size_t>( first_layer ) * num_pairs + start ]
+            );
+        }
+    }
+}
+
+void SquareRenderer::setUpLayers()
+{
+    visitDepthEncoding( m_depth_test_type, [ & ]( auto encoding ) {
+
+        using Encoding = decltype( encoding );
+
+        m_gl_prog_id_layered = compileAndLinkGeometry(
+            VERT_STR_LAYERED,
+            GEOM_STR_LAYERED,
+            fragStrBatchOf< Encoding >(),
+            std::cerr
+        );
+    } );
+
+    glUseProgram( m_gl_prog_id_layered );
+
+    m_vertex_location_layered_corner       = glGetAttribLocation ( m_gl_prog_id_layered, "corner" );
+    m_vertex_location_layered_plane        = glGetAttribLocation ( m_gl_prog_id_layered, "plane" );
+    m_uniform_location_layered_num_layers  = glGetUniformLocation( m_gl_prog_id_layered, "num_layers" );
+    m_uniform_location_layered_grid_width  = glGetUniformLocation( m_gl_prog_id_layered, "grid_width" );
+    m_uniform_location_layered_grid_wh_inv = glGetUniformLocation( m_gl_prog_id_layered, "grid_wh_inv" );
+    m_uniform_location_layered_fg_color    = glGetUniformLocation( m_gl_prog_id_layered, "fg_color" );
+
+    glUniformBlockBinding( m_gl_prog_id_layered, glGetUniformBlockIndex( m_gl_prog_id_layered, "Layers" ), 0 );
+
+    glGenBuffers( 1, &m_gl_uniform_buffer_layers );
+    glBindBuffer( GL_UNIFORM_BUFFER, m_gl_uniform_buffer_layers );
+    glBufferData( GL_UNIFORM_BUFFER, MAX_LAYERS * 4 * sizeof(float), nullptr, GL_STREAM_DRAW );
+    glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+
+    glGenVertexArrays( 1, &m_gl_vertex_array_layered );
+    glBindVertexArray( m_gl_vertex_array_layered );
+
+    glBindBuffer( GL_ARRAY_BUFFER, m_gl_vertex_buffer_batch_corners );
+    glEnableVertexAttribArray( m_vertex_location_layered_corner );
+    glVertexAttribPointer( m_vertex_location_layered_corner, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0 );
+
+    glGenBuffers( 1, &m_gl_vertex_buffer_layered_pairs );
+    glBindBuffer( GL_ARRAY_BUFFER, m_gl_vertex_buffer_layered_pairs );
+    glBufferData(
+        GL_ARRAY_BUFFER,
+        MAX_BATCH_GRID_WIDTH * MAX_BATCH_GRID_WIDTH * sizeof(PlanePair),
+        nullptr,
+        GL_STREAM_DRAW
+    );
+    glEnableVertexAttribArray( m_vertex_location_layered_plane );
+
+    glBindVertexArray( 0 );
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+    glGenFramebuffers( 1, &m_frame_buffer_layered );
+    glGenTextures    ( 1, &m_texture_color_layered );
+    glGenTextures    ( 1, &m_texture_depth_stencil_layered );
+}
+
+void SquareRenderer::testLayersChunk(
+    const Layer*     layers,
+    const int        num_layers,
+    const PlanePair* pairs,
+    const int        num_pairs,
+    const int        layer_stride,
+    TestResult*      results
+) {
+    resizeLayeredFrameBuffer(
+        std::min( num_pairs, MAX_BATCH_GRID_WIDTH ),
+        ( num_pairs + MAX_BATCH_GRID_WIDTH - 1 ) / MAX_BATCH_GRID_WIDTH,
+        num_layers
+    );
+
+    // the grid is as wide as the array, so that the pairs of a layer are
+    // contiguous in the read back.
+    const int width  = m_layered_width;
+    const int height = ( num_pairs + width - 1 ) / width;
+
+    // the same values as uploadBatchInstances().
+    m_layer_params.resize( num_layers * 4 );
+
+    for ( int i = 0; i < num_layers; i++ ) {
+
+        const auto Mproj = testProjection( layers[i].m_near, layers[i].m_far, m_clip_convention );
+
+        m_layer_params[ i * 4     ] = Mproj[2][2];
+        m_layer_params[ i * 4 + 1 ] = Mproj[3][2];
+
+        m_depth_params_function( layers[i].m_near, layers[i].m_far, layers[i].m_param_c, &m_layer_params[ i * 4 + 2 ] );
+    }
+
+    glBindBuffer( GL_UNIFORM_BUFFER, m_gl_uniform_buffer_layers );
+    glBufferSubData( GL_UNIFORM_BUFFER, 0, m_layer_params.size() * sizeof(float), m_layer_params.data() );
+    glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+    glBindBufferBase( GL_UNIFORM_BUFFER, 0, m_gl_uniform_buffer_layers );
+
+    glBindFramebuffer( GL_FRAMEBUFFER, m_frame_buffer_layered );
+
+    applyClipConvention();
+
+    glClearColor( 0.0f, 0.0f, 0.0f, 0.0f );
+    glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+    glDisable( GL_BLEND );
+    glEnable( GL_DEPTH_TEST );
+    glDisable( GL_CULL_FACE );
+    glDisable( GL_STENCIL_TEST );
+
+    glViewport( 0, 0, width, height );
+
+    glBindVertexArray( m_gl_vertex_array_layered );
+    glUseProgram( m_gl_prog_id_layered );
+
+    glUniform1i( m_uniform_location_layered_num_layers, num_layers );
+    glUniform1i( m_uniform_location_layered_grid_width, width );
+    glUniform2f(
+        m_uniform_location_layered_grid_wh_inv,
+        1.0f / static_cast<float>( width ),
+        1.0f / static_cast<float>( height )
+    );
+
+    glBindBuffer( GL_ARRAY_BUFFER, m_gl_vertex_buffer_layered_pairs );
+    glBufferSubData( GL_ARRAY_BUFFER, 0, num_pairs * sizeof(PlanePair), pairs );
+
+    // a pair for num_layers instances in a row.
+    glVertexAttribDivisor( m_vertex_location_layered_plane, num_layers );
+
+    const glm::vec4 color_1{ 1.0f, 0.0f, 0.0f, 1.0f};
+    const glm::vec4 color_2{ 0.0f, 1.0f, 0.0f, 1.0f};
+
+    glVertexAttribPointer(
+        m_vertex_location_layered_plane,
+        1,
+        GL_FLOAT,
+        GL_FALSE,
+        sizeof(PlanePair),
+        (void*)offsetof( PlanePair, m_plane_1 )
+    );
+    glUniform4fv( m_uniform_location_layered_fg_color, 1, &(color_1[0] ) );
+    glDrawArraysInstanced( GL_TRIANGLES, 0, 6, num_pairs * num_layers );
+
+    glVertexAttribPointer(
+        m_vertex_location_layered_plane,
+        1,
+        GL_FLOAT,
+        GL_FALSE,
+        sizeof(PlanePair),
+        (void*)offsetof( PlanePair, m_plane_2 )
+    );
+    glUniform4fv( m_uniform_location_layered_fg_color, 1, &(color_2[0] ) );
+    glDrawArraysInstanced( GL_TRIANGLES, 0, 6, num_pairs * num_layers );
+
+    glBindVertexArray( 0 );
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+    // all the layers of the array at once.
+    const size_t layer_size = static_cast<size_t>( m_layered_width ) * m_layered_height * 4;
+
+    m_layered_pixels.resize( layer_size * m_layered_num_layers );
+
+    glBindTexture( GL_TEXTURE_2D_ARRAY, m_texture_color_layered );
+    glGetTexImage( GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_layered_pixels.data() );
+    glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
+
+    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+    for ( int i = 0; i < num_layers; i++ ) {
+
+        decodeBatchPixels(
+            &m_layered_pixels[ i * layer_size ],
+            num_pairs,
+            &results[ static_cast<size_t>( i ) * layer_stride ]
+        );
+    }
+}
+
+void SquareRenderer::resizeLayeredFrameBuffer( const int width, const int height, const int num_layers )
+{
+    if ( width <= m_layered_width && height <= m_layered_height && num_layers <= m_layered_num_layers ) {
+        return;
+    }
+
+    m_layered_width      = std::max( width,      m_layered_width      );
+    m_layered_height     = std::max( height,     m_layered_height     );
+    m_layered_num_layers = std::max( num_layers, m_layered_num_layers );
+
+    glBindTexture( GL_TEXTURE_2D_ARRAY, m_texture_color_layered );
+    glTexImage3D(
+        GL_TEXTURE_2D_ARRAY,
+        0,
+        GL_RGBA8,
+        m_layered_width,
+        m_layered_height,
+        m_layered_num_layers,
+        0,
+        GL_RGBA,
+        GL_UNSIGNED_BYTE,
+        nullptr
+    );
+    glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+
+    const auto depth_storage = depthStorageOf( m_depth_format );
+
+    glBindTexture( GL_TEXTURE_2D_ARRAY, m_texture_depth_stencil_layered );
+    glTexImage3D(
+        GL_TEXTURE_2D_ARRAY,
+        0,
+        depth_storage.m_internal_format,
+        m_layered_width,
+        m_layered_height,
+        m_layered_num_layers,
+        0,
+        depth_storage.m_format,
+        depth_storage.m_type,
+        nullptr
+    );
+    glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+    glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
+
+    // layered attachments, selected by gl_Layer.
+    glBindFramebuffer( GL_FRAMEBUFFER, m_frame_buffer_layered );
+    glFramebufferTexture( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,        m_texture_color_layered,         0 );
+    glFramebufferTexture( GL_FRAMEBUFFER, depth_storage.m_attachment,  m_texture_depth_stencil_layered, 0 );
+
+    if ( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE ) {
+
+        throw std::runtime_error( "layered framebuffer incomplete." );
+    }
+
+    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
+
+void SquareRenderer::drawBatchQueries( const int num_test_cases, const GLuint* queries )
+{
+    // the pixels of the test cases are independent. all the plane_1 are
+    // drawn before all the plane_2 as in the color readback.
+    glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+
+    const size_t plane_offsets[2] = {
+        offsetof( BatchInstance, m_plane_1 ),
+        offsetof( BatchInstance, m_plane_2 )
+    };
+
+    for ( int p = 0; p < 2; p++ ) {
+
+        StageProfiler::Scope scope(
+            m_profiler, ( p == 0 ) ? StageProfiler::DRAW_PLANE_1 : StageProfiler::DRAW_PLANE_2 );
+
+        for ( int i = 0; i < num_test_cases; i++ ) {
+
+            // glDrawArraysInstancedBaseInstance() is not in 3.3.
+            // the attributes are pointed at the instance instead.
+            pointBatchInstanceAttributes( i, plane_offsets[p] );
+            glUniform1i( m_uniform_location_batch_first_instance, i );
+
+            glBeginQuery( GL_ANY_SAMPLES_PASSED, queries[ 2 * i + p ] );
+            glDrawArraysInstanced( GL_TRIANGLES, 0, 6, 1 );
+            glEndQuery( GL_ANY_SAMPLES_PASSED );
+        }
+    }
+
+    // restore the pointers of the instanced draws.
+    pointBatchInstanceAttributes( 0, plane_offsets[0] );
+
+    glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+    glBindVertexArray( 0 );
+}
+
+void SquareRenderer::pointBatchInstanceAttributes( const int instance, const size_t plane_offset )
+{
+    const size_t base = instance * sizeof(BatchInstance);
+
+    glVertexAttribPointer(
+        m_vertex_location_batch_plane,
+        1,
+        GL_FLOAT,
+        GL_FALSE,
+        sizeof(BatchInstance),
+        (void*)( base + plane_offset )
+    );
+
+    glVertexAttribPointer(
+        m_vertex_location_batch_proj_z,
+        2,
+        GL_FLOAT,
+        GL_FALSE,
+        sizeof(BatchInstance),
+        (void*)( base + offsetof( BatchInstance, m_proj_z ) )
+    );
+
+    glVertexAttribPointer(
+        m_vertex_location_batch_depth_params,
+        2,
+        GL_FLOAT,
+        GL_FALSE,
+        sizeof(BatchInstance),
+        (void*)( base + offsetof( BatchInstance, m_depth_params ) )
+    );
+}
+
+void SquareRenderer::reserveQueries( std::vector< GLuint >& queries, const int num_test_cases )
+{
+    const size_t num_queries = 2 * num_test_cases;
+
+    if ( queries.size() >= num_queries ) {
+        return;
+    }
+
+    const auto num_existing = queries.size();
+
+    queries.resize( num_queries );
+
+    glGenQueries( num_queries - num_existing, &queries[ num_existing ] );
+}
+
+void SquareRenderer::decodeBatchQueries(
+    const GLuint* queries,
+    const int     num_test_cases,
+    TestResult*   results
+) {
+    for ( int i = 0; i < num_test_cases; i++ ) {
+
+        GLuint passed_1;
+        GLuint passed_2;
+
+        // blocks until the result is available.
+        glGetQueryObjectuiv( queries[ 2 * i     ], GL_QUERY_RESULT, &passed_1 );
+        glGetQueryObjectuiv( queries[ 2 * i + 1 ], GL_QUERY_RESULT, &passed_2 );
+
+        // plane_1 is visible unless plane_2 passes over it.
+        results[i].m_plane_1_detected = passed_1 != 0 && passed_2 == 0;
+        results[i].m_plane_2_detected = passed_2 != 0;
+    }
+}
+
+void SquareRenderer::setProfiler( StageProfiler* profiler )
+{
+    if ( m_profiler != nullptr && m_profiler != profiler ) {
+        m_profiler->releaseQueries();
+    }
+    m_profiler = profiler;
+}
+
+void SquareRenderer::setDetectionMode( const DetectionMode mode )
+{
+    if ( m_num_readbacks_in_flight > 0 ) {
+
+        throw std::runtime_error( "detection mode changed with batches in flight." );
+    }
+
+    m_detection_mode = mode;
+}
+
+void SquareRenderer::decodeBatchPixels(
+    const unsigned char* pixels,
+    const int            num_test_cases,
+    TestResult*          results
+) {
+    for ( int i = 0; i < num_test_cases; i++ ) {
+
+        const unsigned char* pixel_read = &pixels[ i * 4 ];
+
+        results[i].m_plane_1_detected = ( pixel_read[0] == 255 && pixel_read[1] == 0 );
+        results[i].m_plane_2_detected = ( pixel_read[1] == 255 && pixel_read[0] == 0 );
+    }
+}
+
+void SquareRenderer::submitBatch(
+    const std::vector< TestCase >& test_cases,
+    Callback                       callback
+) {
+    const int num_test_cases = static_cast<int>( test_cases.size() );
+    const int max_chunk      = MAX_BATCH_GRID_WIDTH * MAX_BATCH_GRID_WIDTH;
+
+    auto results = std::make_shared< std::vector< TestResult > >( num_test_cases );
+
+    // nothing to draw. delivered at once without a slot, or after the
+    // batches completing in the submission this is called back from.
+    if ( num_test_cases == 0 ) {
+
+        if ( m_submitting ) {
+
+            m_num_batches_in_flight++;
+            m_completed_while_submitting.push_back( { std::move( callback ), results } );
+        }
+        else if ( callback ) {
+            callback( *results );
+        }
+        return;
+    }
+
+    m_num_batches_in_flight++;
+    m_submitting = true;
+
+    int first = 0;
+
+    do {
+        const int  chunk = std::min( max_chunk, num_test_cases - first );
+        const bool last  = ( first + chunk == num_test_cases );
+
+        submitChunk( test_cases.data() + first, chunk, results, first, last ? std::move( callback ) : Callback{} );
+
+        first += chunk;
+
+    } while ( first < num_test_cases );
+
+    m_submitting = false;
+
+    // the callbacks may submit again, which appends to the queue.
+    while ( !m_completed_while_submitting.empty() ) {
+
+        auto batch = std::move( m_completed_while_submitting.front() );
+        m_completed_while_submitting.pop_front();
+
+        m_num_batches_in_flight--;
+
+        if ( batch.m_callback ) {
+            batch.m_callback( *batch.m_results );
+        }
+    }
+}
+
+void SquareRenderer::submitChunk(
+    const TestCase*                                     test_cases,
+    const int                                           num_test_cases,
+    const std::shared_ptr< std::vector< TestResult > >& results,
+    const int                                           first_test_case,
+    Callback                                            callback
+) {
+    // a callback called here may fill the ring again.
+    while ( m_num_readbacks_in_flight == READBACK_RING_SIZE ) {
+
+        bool delivered;
+
+        completeOldestReadback( true, delivered );
+    }
+
+    auto& slot = m_readback_slots[
+        ( m_readback_head + m_num_readbacks_in_flight ) % READBACK_RING_SIZE
+    ];
+
+    int width;
+    int height;
+
+    slot.m_num_test_cases  = num_test_cases;
+    slot.m_first_test_case = first_test_case;
+    slot.m_results         = results;
+    slot.m_callback        = std::move( callback );
+
+    if ( m_profiler != nullptr ) {
+        m_profiler->beginProbe();
+    }
+
+    if ( m_detection_mode == OCCLUSION_QUERY ) {
+
+        reserveQueries( slot.m_queries, num_test_cases );
+
+        drawBatchChunk( test_cases, num_test_cases, slot.m_queries.data(), width, height );
+        glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+        if ( m_profiler != nullptr ) {
+            m_profiler->endProbe( num_test_cases );
+        }
+
+        glFlush();
+
+        m_num_readbacks_in_flight++;
+        return;
+    }
+
+    drawBatchChunk( test_cases, num_test_cases, nullptr, width, height );
+
+    // the copy into the pixel buffer is queued after the draws.
+    // the framebuffer can be reused by the next batch right away.
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, slot.m_pixel_buffer );
+    {
+        StageProfiler::Scope scope( m_profiler, StageProfiler::READBACK );
+
+        glReadPixels( 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0 );
+    }
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+    if ( m_profiler != nullptr ) {
+        m_profiler->endProbe( num_test_cases );
+    }
+
+    slot.m_fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+
+    glFlush();
+
+    m_num_readbacks_in_flight++;
+}
+
+int SquareRenderer::pollCompleted( const bool wait )
+{
+    int num_completed = 0;
+
+    while ( m_num_readbacks_in_flight > 0 ) {
+
+        bool delivered;
+
+        if ( !completeOldestReadback( wait && num_completed == 0, delivered ) ) {
+            break;
+        }
+
+        if ( delivered ) {
+            num_completed++;
+        }
+    }
+
+    return num_completed;
+}
+
+int SquareRenderer::numInFlight() const
+{
+    return m_num_batches_in_flight;
+}
+
+bool SquareRenderer::completeOldestReadback( const bool wait, bool& delivered )
+{
+    auto& slot = m_readback_slots[ m_readback_head ];
+
+    delivered = false;
+
+    TestResult* results = slot.m_results->data() + slot.m_first_test_case;
+
+    const auto wait_start = std::chrono::steady_clock::now();
+
+    if ( m_detection_mode == OCCLUSION_QUERY ) {
+
+        // the queries of a batch complete in order. the last one tells.
+        GLuint available = GL_FALSE;
+
+        if ( !wait ) {
+
+            glGetQueryObjectuiv(
+                slot.m_queries[ 2 * slot.m_num_test_cases - 1 ],
+                GL_QUERY_RESULT_AVAILABLE,
+                &available
+            );
+
+            if ( available == GL_FALSE ) {
+                return false;
+            }
+        }
+
+        decodeBatchQueries( slot.m_queries.data(), slot.m_num_test_cases, results );
+
+        if ( m_profiler != nullptr ) {
+            m_profiler->addCpuTime( StageProfiler::READBACK, std::chrono::steady_clock::now() - wait_start );
+        }
+    }
+    else {
+        const GLuint64 timeout = wait ? 1000000000ull : 0; // 1 sec.
+
+        while ( true ) {
+
+            const auto status = glClientWaitSync( slot.m_fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout );
+
+            if ( status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED ) {
+                break;
+            }
+
+            if ( status == GL_WAIT_FAILED ) {
+
+                throw std::runtime_error( "glClientWaitSync() failed." );
+            }
+
+            if ( !wait ) {
+                return false;
+            }
+        }
+
+        glDeleteSync( slot.m_fence );
+        slot.m_fence = nullptr;
+
+        const auto map_start = std::chrono::steady_clock::now();
+
+        glBindBuffer( GL_PIXEL_PACK_BUFFER, slot.m_pixel_buffer );
+
+        const auto* pixels = static_cast< const unsigned char* >(
+            glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, slot.m_num_test_cases * 4, GL_MAP_READ_BIT )
+        );
+
+        if ( pixels == nullptr ) {
+
+            throw std::runtime_error( "glMapBufferRange() failed." );
+        }
+
+        decodeBatchPixels( pixels, slot.m_num_test_cases, results );
+
+        glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+        glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+        if ( m_profiler != nullptr ) {
+            m_profiler->addCpuTime( StageProfiler::FINISH,   map_start - wait_start );
+            m_profiler->addCpuTime( StageProfiler::READBACK, std::chrono::steady_clock::now() - map_start );
+        }
+    }
+
+    if ( m_profiler != nullptr ) {
+        m_profiler->resolveOldest();
+    }
+
+    // release the slot before the callback, which may submit the next batch
+    // into it.
+    auto callback      = std::move( slot.m_callback );
+    auto batch_results = std::move( slot.m_results );
+
+    const bool last_chunk = ( slot.m_first_test_case + slot.m_num_test_cases == static_cast<int>( batch_results->size() ) );
+
+    m_readback_head = ( m_readback_head + 1 ) % READBACK_RING_SIZE;
+    m_num_readbacks_in_flight--;
+
+    if ( last_chunk && m_submitting ) {
+
+        // delivered at the end of submitBatch(), before any batch its
+        // callback submits.
+        m_completed_while_submitting.push_back( { std::move( callback ), std::move( batch_results ) } );
+    }
+    else if ( last_chunk ) {
+
+        m_num_batches_in_flight--;
+        delivered = true;
+
+        if ( callback ) {
+            callback( *batch_results );
+        }
+    }
+
+    return true;
+}
+
 } // namespace DepthTest
@@ -3,19 +3,37 @@
 
 #include <cstdint>
 #include <cmath>
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "opengl_util.hpp"
+#include "depth_tester.hpp"
+#include "depth_encoding.hpp"
+#include "stage_profiler.hpp"
 
 namespace DepthTest {
 
-static constexpr const char* VERT_STR_NORMAL_DEPTH = "#version 330 core\n\
+// The shaders of test() and renderInteractive() for a depth encoding of
+// depth_encoding.hpp. The encodings that write gl_FragDepth get the VCS z
+// and their parameters as the uniforms PARAM_NAMES.
+template< class Encoding >
+std::string vertStrOf()
+{
+    const bool frag_depth = Encoding::GLSL_FRAG_DEPTH != nullptr;
+
+    std::string str = "#version 330 core\n\
 \n\
 in  vec4 position_lcs;\n\
-\n\
-uniform mat4 P;\n\
+\n";
+    if ( frag_depth ) {
+        str += "out float position_vcs_z;\n\n";
+    }
+    str += "uniform mat4 P;\n\
 uniform mat4 V;\n\
 uniform mat4 M;\n\
 \n\
@@ -23,113 +41,219 @@ void main() {\n\
 \n\
     vec4 position_wcs = M * position_lcs;\n\
     vec4 position_vcs = V * position_wcs;\n\
-    gl_Position  = P * position_vcs;\n\
-}\n\
-";
+    gl_Position  = P * position_vcs;\n";
+    if ( frag_depth ) {
+        str += "    position_vcs_z = position_vcs.z;\n";
+    }
+    str += "}\n";
 
-static constexpr const char* FRAG_STR_NORMAL_DEPTH = "#version 330 core\n\
-\n\
-out vec4 color_fout;\n\
-\n\
-uniform vec4 fg_color;\n\
+    return str;
+}
+
+template< class Encoding >
+std::string fragStrOf()
+{
+    std::string str = "#version 330 core\n\n";
+
+    if ( Encoding::GLSL_FRAG_DEPTH != nullptr ) {
+        str += "in float position_vcs_z;\n\n";
+    }
+    str += "out vec4 color_fout;\n\n";
+
+    for ( int i = 0; i < Encoding::NUM_PARAMS; i++ ) {
+        str += std::string( "uniform float " ) + Encoding::PARAM_NAMES[i] + ";\n";
+    }
+    str += "uniform vec4 fg_color;\n\
 \n\
 void main()\n\
-{\n\
-    color_fout = fg_color;\n\
-}\n\
-";
+{\n";
+    if ( Encoding::GLSL_FRAG_DEPTH != nullptr ) {
+        str += Encoding::GLSL_FRAG_DEPTH;
+    }
+    str += "    color_fout = fg_color;\n\
+}\n";
+
+    return str;
+}
+
+// Batched test shaders.
+// Each instance is one test case rendered into its own pixel of the
+// batch framebuffer. The quad covers exactly that pixel, and the plane
+// is at the same VCS z for all the vertices, so the depth at the pixel
+// center is the same as the one produced by test() for the 1x1 buffer.
+// first_instance places a draw of a single instance at its own pixel for the
+// occlusion queries.
+// The attributes are at fixed locations, as depth_params is inactive for the
+// encodings without parameters, and glGetAttribLocation() gives -1 for it.
+static constexpr GLuint BATCH_LOCATION_CORNER       = 0;
+static constexpr GLuint BATCH_LOCATION_PLANE        = 1;
+static constexpr GLuint BATCH_LOCATION_PROJ_Z       = 2;
+static constexpr GLuint BATCH_LOCATION_DEPTH_PARAMS = 3;
 
-static constexpr const char* VERT_STR_LOG_DEPTH_FN = "#version 330 core\n\
+static constexpr const char* VERT_STR_BATCH = "#version 330 core\n\
 \n\
-in  vec4 position_lcs;\n\
+layout(location = 0) in vec2  corner;\n\
+layout(location = 1) in float plane;\n\
+layout(location = 2) in vec2  proj_z;\n\
+layout(location = 3) in vec2  depth_params;\n\
 \n\
-out vec4  color_vout;\n\
 out float position_vcs_z;\n\
+flat out vec2 depth_params_vout;\n\
 \n\
-uniform mat4 P;\n\
-uniform mat4 V;\n\
-uniform mat4 M;\n\
+uniform int grid_width;\n\
+uniform vec2 grid_wh_inv;\n\
+uniform int first_instance;\n\
 \n\
 void main() {\n\
 \n\
-    vec4 position_wcs = M * position_lcs;\n\
-    vec4 position_vcs = V * position_wcs;\n\
-    gl_Position  = P * position_vcs;\n\
-    position_vcs_z = position_vcs.z;\n\
+    float z = -1.0 * plane;\n\
+    float w = -1.0 * z;\n\
+    int instance = gl_InstanceID + first_instance;\n\
+    vec2 cell = vec2( instance % grid_width, instance / grid_width );\n\
+    vec2 ndc  = ( cell + corner ) * grid_wh_inv * 2.0 - 1.0;\n\
+\n\
+    gl_Position = vec4( ndc * w, proj_z.x * z + proj_z.y, w );\n\
+    position_vcs_z    = z;\n\
+    depth_params_vout = depth_params;\n\
 }\n\
 ";
 
-static constexpr const char* FRAG_STR_LOG_DEPTH_FN = "#version 330 core\n\
-\n\
-in float position_vcs_z;\n\
-\n\
-out vec4 color_fout;\n\
+// The parameters of the encoding come per instance in depth_params_vout,
+// in the order of PARAM_NAMES.
+template< class Encoding >
+std::string fragStrBatchOf()
+{
+    static const char* const COMPONENTS[2] = { "x", "y" };
+
+    std::string str = "#version 330 core\n\n";
+
+    if ( Encoding::GLSL_FRAG_DEPTH != nullptr ) {
+        str += "in float position_vcs_z;\n\
+flat in vec2 depth_params_vout;\n\
+\n";
+    }
+    str += "out vec4 color_fout;\n\
 \n\
-uniform float log_near;\n\
-uniform float log_far;\n\
 uniform vec4 fg_color;\n\
 \n\
 void main()\n\
-{\n\
-    float log_z  = log( max( 1.0e-20, -1.0 * position_vcs_z ) );\n\
-    gl_FragDepth = ( log_z - log_near ) / ( log_far - log_near );\n\
-    color_fout = fg_color;\n\
-}\n\
-";
+{\n";
+    for ( int i = 0; i < Encoding::NUM_PARAMS; i++ ) {
+        str += std::string( "    float " ) + Encoding::PARAM_NAMES[i]
+             + " = depth_params_vout." + COMPONENTS[i] + ";\n";
+    }
+    if ( Encoding::GLSL_FRAG_DEPTH != nullptr ) {
+        str += Encoding::GLSL_FRAG_DEPTH;
+    }
+    str += "    color_fout = fg_color;\n\
+}\n";
 
+    return str;
+}
 
-static constexpr const char* VERT_STR_LOG_DEPTH_CF = "#version 330 core\n\
+// Layered test shaders.
+// Each instance is one plane pair under one layer, i.e. camera
+// configuration, the layers of a pair next to each other. The geometry
+// shader routes the quad to its layer of the texture array, where it
+// covers the pixel of the pair as VERT_STR_BATCH. The projection and the
+// encoding parameters of the layers are in the uniform block Layers, and
+// the fragment shaders are the ones of fragStrBatchOf().
+// The size of layer_params is SquareRenderer::MAX_LAYERS.
+static constexpr const char* VERT_STR_LAYERED = "#version 330 core\n\
 \n\
-in  vec4 position_lcs;\n\
+in vec2  corner;\n\
+in float plane;\n\
 \n\
-out vec4  color_vout;\n\
-out float position_vcs_z;\n\
+out float position_vcs_z_gin;\n\
+flat out int  layer_gin;\n\
+flat out vec2 depth_params_gin;\n\
 \n\
-uniform mat4 P;\n\
-uniform mat4 V;\n\
-uniform mat4 M;\n\
+layout(std140) uniform Layers {\n\
+    vec4 layer_params[64]; // proj_z in xy, depth_params in zw\n\
+};\n\
+\n\
+uniform int num_layers;\n\
+uniform int grid_width;\n\
+uniform vec2 grid_wh_inv;\n\
 \n\
 void main() {\n\
 \n\
-    vec4 position_wcs = M * position_lcs;\n\
-    vec4 position_vcs = V * position_wcs;\n\
-    gl_Position  = P * position_vcs;\n\
-    position_vcs_z = position_vcs.z;\n\
+    float z = -1.0 * plane;\n\
+    float w = -1.0 * z;\n\
+    int  layer  = gl_InstanceID % num_layers;\n\
+    int  pair   = gl_InstanceID / num_layers;\n\
+    vec4 params = layer_params[ layer ];\n\
+    vec2 cell = vec2( pair % grid_width, pair / grid_width );\n\
+    vec2 ndc  = ( cell + corner ) * grid_wh_inv * 2.0 - 1.0;\n\
+\n\
+    gl_Position = vec4( ndc * w, params.x * z + params.y, w );\n\
+    position_vcs_z_gin = z;\n\
+    layer_gin          = layer;\n\
+    depth_params_gin   = params.zw;\n\
 }\n\
 ";
 
-static constexpr const char* FRAG_STR_LOG_DEPTH_CF = "#version 330 core\n\
+static constexpr const char* GEOM_STR_LAYERED = "#version 330 core\n\
 \n\
-in float position_vcs_z;\n\
+layout( triangles ) in;\n\
+layout( triangle_strip, max_vertices = 3 ) out;\n\
 \n\
-out vec4 color_fout;\n\
+in float position_vcs_z_gin[];\n\
+flat in int  layer_gin[];\n\
+flat in vec2 depth_params_gin[];\n\
 \n\
-uniform float param_c;\n\
-uniform float log_cf_plus_1_inv;\n\
-uniform vec4 fg_color;\n\
+out float position_vcs_z;\n\
+flat out vec2 depth_params_vout;\n\
 \n\
-void main()\n\
-{\n\
-    gl_FragDepth = log( -1.0 * param_c * position_vcs_z + 1.0 )\n\
-                 * log_cf_plus_1_inv;\n\
-    color_fout = fg_color;\n\
+void main() {\n\
+\n\
+    for ( int i = 0; i < 3; i++ ) {\n\
+\n\
+        gl_Layer          = layer_gin[0];\n\
+        gl_Position       = gl_in[i].gl_Position;\n\
+        position_vcs_z    = position_vcs_z_gin[i];\n\
+        depth_params_vout = depth_params_gin[0];\n\
+        EmitVertex();\n\
+    }\n\
+    EndPrimitive();\n\
 }\n\
 ";
 
-class SquareRenderer {
+class SquareRenderer : public DepthTester {
 
   public:
 
-    typedef enum _DepthTestType {
-        UNKNOWN,
-        PERSPECTIVE,
-        LOG_DEPTH_FN,
-        LOG_DEPTH_CF
-    } DepthTestType;
+    // how the batched test detects the visible plane.
+    typedef enum _DetectionMode {
+        COLOR_READBACK,  // reads back the color of each pixel.
+        OCCLUSION_QUERY  // GL_ANY_SAMPLES_PASSED query per plane draw.
+    } DetectionMode;
+
+    // number of asynchronous batches in flight.
+    static constexpr int READBACK_RING_SIZE = 4;
+
+    // the batch framebuffer is at most MAX_BATCH_GRID_WIDTH x MAX_BATCH_GRID_WIDTH.
+    // larger batches are split into multiple draws.
+    static constexpr int MAX_BATCH_GRID_WIDTH = 256;
 
-    explicit SquareRenderer( const DepthTestType depth_test_type );
+    // the IDs of the planes of a stack fit in the red channel.
+    static constexpr int MAX_STACK_PLANES = 255;
 
-    ~SquareRenderer();
+    // the layers of a draw of testLayers(). more are split into multiple draws.
+    static constexpr int MAX_LAYERS = 64;
+
+    // depth_format:    the depth buffers of test(), testBatch(),
+    //                  readDepthCodes(), testStacks() and testLayers().
+    // clip_convention: CLIP_REVERSED falls back to CLIP_REVERSED_DEPTH_RANGE
+    //                  without glClipControl(). the reversed ones are for
+    //                  PERSPECTIVE only, and not for testStacks().
+    explicit SquareRenderer(
+        const DepthTestType  depth_test_type,
+        const DepthFormat    depth_format    = DEPTH_D24,
+        const ClipConvention clip_convention = CLIP_STANDARD
+    );
+
+    ~SquareRenderer() override;
 
     void renderInteractive(
         const glm::ivec2& screen_pos,
@@ -152,9 +276,238 @@ class SquareRenderer {
         bool&       plane_2_detected
     );
 
+    // Same as test() for each of the test cases, but all the cases are drawn
+    // with two instanced draws into one pixel each, and the verdicts are
+    // read back at once. results is resized to test_cases.size().
+    void testBatch(
+        const std::vector< TestCase >& test_cases,
+        std::vector< TestResult >&     results
+    ) override;
+
+    // Each plane is drawn alone into its own pixel of a depth texture of
+    // the depth format, and the codes are read back. The codes of D32F are
+    // the bits of the float depth.
+    void readDepthCodes(
+        const float                 near,
+        const float                 far,
+        const float                 param_c,
+        const std::vector< float >& planes,
+        std::vector< uint32_t >&    codes
+    ) override;
+
+    // Each stack is drawn into its own pixel of the batch framebuffer with
+    // one instanced draw per plane, in the order of the stack. The i-th draw
+    // writes its ID i + 1 in red, and the IDs of the winners are read back
+    // at once. num_planes is at most MAX_STACK_PLANES.
+    void testStacks(
+        const float                 near,
+        const float                 far,
+        const float                 param_c,
+        const StackDepthFunc        depth_func,
+        const int                   num_planes,
+        const std::vector< float >& planes,
+        std::vector< int >&         winners
+    ) override;
+
+    // Each layer is a layer of a texture array, and each pair is drawn into
+    // its own pixel of all the layers with two instanced draws, as in
+    // testBatch(). The program is set up at the first call.
+    void testLayers(
+        const std::vector< Layer >&     layers,
+        const std::vector< PlanePair >& pairs,
+        std::vector< TestResult >&      results
+    ) override;
+
+    // Asynchronous version of testBatch().
+    // The verdicts are read into a ring of pixel buffer objects, and the
+    // completion is detected with a fence, or with the availability of the
+    // last query for OCCLUSION_QUERY. A batch of more than
+    // MAX_BATCH_GRID_WIDTH^2 test cases takes one slot of the ring per
+    // chunk of that size, and its callback is called once after the last
+    // chunk. If the ring is full, it waits for the oldest chunk first, and
+    // the batches completed meanwhile are delivered after the submitted
+    // batch is queued, so that the callbacks may submit the next batches.
+    void submitBatch(
+        const std::vector< TestCase >& test_cases,
+        Callback                       callback
+    ) override;
+
+    int pollCompleted( const bool wait ) override;
+
+    int numInFlight() const override;
+
+    // With OCCLUSION_QUERY each plane of each test case is drawn with its own
+    // query, and no framebuffer is read back. The verdicts are the same.
+    // Must not be changed while batches are in flight.
+    void setDetectionMode( const DetectionMode mode );
+
+    DetectionMode detectionMode() const
+    {
+        return m_detection_mode;
+    }
+
+    // times the stages of test(), testBatch() and submitBatch() into
+    // profiler. nullptr to stop. The profiler must outlive the renderer,
+    // which deletes its queries. Must not be changed while batches are in
+    // flight.
+    void setProfiler( StageProfiler* profiler );
+
+    DepthFormat depthFormat() const
+    {
+        return m_depth_format;
+    }
+
+    // the one in effect, after the fallback of CLIP_REVERSED.
+    ClipConvention clipConvention() const
+    {
+        return m_clip_convention;
+    }
+
+    // P of test() and of the proj_z of testBatch().
+    // glm::frustum(), or its reversed version for CLIP_REVERSED, which maps
+    // near to 1 and far to 0 of the clip z in [0, w].
+    static glm::mat4 testProjection(
+        const float          near,
+        const float          far,
+        const ClipConvention clip_convention = CLIP_STANDARD
+    );
+
 private:
 
-    const DepthTestType m_depth_test_type;
+    struct BatchInstance {
+        float m_plane_1;
+        float m_plane_2;
+        float m_proj_z[2];
+        float m_depth_params[2];
+    };
+
+    void setDepthParams( BatchInstance& instance, const TestCase& test_case ) const;
+
+    void setDepthParamUniforms( const float near, const float far, const float param_c ) const;
+
+    // the clip control, the depth range, the clear depth, and the depth
+    // function of the clip convention. set before each clear, as the
+    // renderers sharing the context may have the other conventions.
+    void applyClipConvention() const;
+
+    void resizeBatchFrameBuffer( const int width, const int height );
+
+    // one chunk of a batch of submitBatch().
+    struct ReadbackSlot {
+
+        ReadbackSlot() noexcept
+            :m_pixel_buffer   { 0 }
+            ,m_fence          { nullptr }
+            ,m_num_test_cases { 0 }
+            ,m_first_test_case{ 0 }
+        {
+        }
+
+        GLuint                m_pixel_buffer;
+        std::vector< GLuint > m_queries; // OCCLUSION_QUERY
+        GLsync                m_fence;   // COLOR_READBACK
+        int                   m_num_test_cases;
+        int                   m_first_test_case; // of the chunk in its batch
+
+        // the results of the whole batch, shared by its chunks, so that a
+        // callback submitting the next batch does not overwrite them.
+        std::shared_ptr< std::vector< TestResult > > m_results;
+
+        Callback              m_callback; // on the last chunk only
+    };
+
+    // a batch completed during submitBatch().
+    struct CompletedBatch {
+        Callback                                     m_callback;
+        std::shared_ptr< std::vector< TestResult > > m_results;
+    };
+
+    void submitChunk(
+        const TestCase*                                     test_cases,
+        const int                                           num_test_cases,
+        const std::shared_ptr< std::vector< TestResult > >& results,
+        const int                                           first_test_case,
+        Callback                                            callback
+    );
+
+    void testBatchChunk(
+        const TestCase* test_cases,
+        const int       num_test_cases,
+        TestResult*     results
+    );
+
+    // leaves the batch framebuffer bound.
+    // with OCCLUSION_QUERY, queries[2i] and queries[2i+1] receive the
+    // samples passed for plane_1 and plane_2 of the test case i.
+    void drawBatchChunk(
+        const TestCase* test_cases,
+        const int       num_test_cases,
+        const GLuint*   queries,
+        int&            width,
+        int&            height
+    );
+
+    void uploadBatchInstances( const TestCase* test_cases, const int num_test_cases );
+
+    void readDepthCodesChunk(
+        const TestCase* test_cases,
+        const int       num_test_cases,
+        uint32_t*       codes
+    );
+
+    void resizeDepthCodeFrameBuffer( const int width, const int height );
+
+    void testStacksChunk(
+        const float          near,
+        const float          far,
+        const float          param_c,
+        const StackDepthFunc depth_func,
+        const int            num_planes,
+        const float*         planes,
+        const int            num_stacks,
+        int*                 winners
+    );
+
+    void setUpLayers();
+
+    void testLayersChunk(
+        const Layer*     layers,
+        const int        num_layers,
+        const PlanePair* pairs,
+        const int        num_pairs,
+        const int        layer_stride,
+        TestResult*      results
+    );
+
+    void resizeLayeredFrameBuffer( const int width, const int height, const int num_layers );
+
+    void drawBatchQueries( const int num_test_cases, const GLuint* queries );
+
+    void pointBatchInstanceAttributes( const int instance, const size_t plane_offset );
+
+    static void reserveQueries( std::vector< GLuint >& queries, const int num_test_cases );
+
+    static void decodeBatchQueries(
+        const GLuint* queries,
+        const int     num_test_cases,
+        TestResult*   results
+    );
+
+    static void decodeBatchPixels(
+        const unsigned char* pixels,
+        const int            num_test_cases,
+        TestResult*          results
+    );
+
+    // returns false if !wait and the oldest chunk is not complete yet.
+    // delivered is set if it was the last chunk of its batch.
+    bool completeOldestReadback( const bool wait, bool& delivered );
+
+    const DepthTestType  m_depth_test_type;
+    const DepthFormat    m_depth_format;
+    ClipConvention       m_clip_convention;
+    bool                 m_clip_control_supported;
+    DetectionMode        m_detection_mode;
 
     glm::mat4  m_uniform_M_plane1;
     glm::mat4  m_uniform_M_plane2;
@@ -173,15 +526,92 @@ private:
     GLuint     m_uniform_location_V;
     GLuint     m_uniform_location_M;
     GLuint     m_uniform_location_fg_color;
-    GLuint     m_uniform_location_log_near;
-    GLuint     m_uniform_location_log_far;
-    GLuint     m_uniform_location_param_c;
-    GLuint     m_uniform_location_log_cf_plus_1_inv;
+
+    // the parameters of the depth encoding. see depth_encoding.hpp.
+    GLuint     m_uniform_location_depth_params[2];
+    int        m_num_depth_params;
+    DepthParamsFunction
+               m_depth_params_function;
 
     // test framebuffer of 1x1.
     GLuint     m_frame_buffer_tester;
     GLuint     m_render_buffer_color_tester;
     GLuint     m_render_buffer_depth_stencil_tester;
+
+    // batched test. the framebuffer grows on demand.
+    GLuint     m_gl_prog_id_batch;
+    GLuint     m_gl_vertex_array_batch;
+    GLuint     m_gl_vertex_buffer_batch_corners;
+    GLuint     m_gl_vertex_buffer_batch_instances;
+
+    GLuint     m_vertex_location_batch_corner;
+    GLuint     m_vertex_location_batch_plane;
+    GLuint     m_vertex_location_batch_proj_z;
+    GLuint     m_vertex_location_batch_depth_params;
+
+    GLuint     m_uniform_location_batch_grid_width;
+    GLuint     m_uniform_location_batch_grid_wh_inv;
+    GLuint     m_uniform_location_batch_fg_color;
+    GLuint     m_uniform_location_batch_first_instance;
+
+    GLuint     m_frame_buffer_batch;
+    GLuint     m_render_buffer_color_batch;
+    GLuint     m_render_buffer_depth_stencil_batch;
+    int        m_batch_width;
+    int        m_batch_height;
+
+    std::vector< BatchInstance > m_batch_instances;
+    std::vector< unsigned char > m_batch_pixels;
+    std::vector< GLuint >        m_batch_queries;
+
+    // depth code readback. the plane_1 of the cases is drawn.
+    GLuint     m_frame_buffer_depth_codes;
+    GLuint     m_texture_depth_codes;
+    int        m_depth_codes_width;
+    int        m_depth_codes_height;
+
+    std::vector< TestCase >      m_depth_code_cases;
+    std::vector< uint32_t >      m_depth_code_pixels;
+    std::vector< uint16_t >      m_depth_code_pixels_16; // D16
+
+    // stack test. the j-th planes of the stacks are the plane_1 of a row
+    // of cases.
+    std::vector< TestCase >      m_stack_cases;
+
+    // layered test. 0 until the first testLayers().
+    GLuint     m_gl_prog_id_layered;
+    GLuint     m_gl_vertex_array_layered;
+    GLuint     m_gl_vertex_buffer_layered_pairs;
+    GLuint     m_gl_uniform_buffer_layers;
+
+    GLuint     m_vertex_location_layered_corner;
+    GLuint     m_vertex_location_layered_plane;
+
+    GLuint     m_uniform_location_layered_num_layers;
+    GLuint     m_uniform_location_layered_grid_width;
+    GLuint     m_uniform_location_layered_grid_wh_inv;
+    GLuint     m_uniform_location_layered_fg_color;
+
+    // grows on demand. the whole array is read back.
+    GLuint     m_frame_buffer_layered;
+    GLuint     m_texture_color_layered;
+    GLuint     m_texture_depth_stencil_layered;
+    int        m_layered_width;
+    int        m_layered_height;
+    int        m_layered_num_layers;
+
+    std::vector< float >         m_layer_params;
+    std::vector< unsigned char > m_layered_pixels;
+
+    // asynchronous batched test.
+    std::vector< ReadbackSlot >  m_readback_slots;
+    int                          m_readback_head;
+    int                          m_num_readbacks_in_flight; // chunks
+    int                          m_num_batches_in_flight;
+    bool                         m_submitting;
+    std::deque< CompletedBatch > m_completed_while_submitting;
+
+    StageProfiler*               m_profiler;
 };
 
 } // namespace DepthTest
@@ -0,0 +1,267 @@
+#include <cmath>
+#include <iomanip>
+#include <algorithm>
+
+#include "stage_profiler.hpp"
+
+namespace DepthTest {
+
+int LatencyHistogram::bucketOf( const uint64_t nanoseconds )
+{
+    if ( nanoseconds < SUB_BUCKETS ) {
+        return static_cast<int>( nanoseconds );
+    }
+
+    int exponent = 63;
+
+    while ( ( nanoseconds >> exponent ) == 0 ) {
+        exponent--;
+    }
+
+    // the top bit and the next 3 bits.
+    const int sub = static_cast<int>( ( nanoseconds >> ( exponent - 3 ) ) & ( SUB_BUCKETS - 1 ) );
+
+    return ( exponent - 2 ) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucketLow( const int bucket )
+{
+    if ( bucket < SUB_BUCKETS ) {
+        return static_cast<uint64_t>( bucket );
+    }
+
+    const int exponent = bucket / SUB_BUCKETS + 2;
+    const int sub      = bucket % SUB_BUCKETS;
+
+    return ( static_cast<uint64_t>( SUB_BUCKETS + sub ) ) << ( exponent - 3 );
+}
+
+void LatencyHistogram::add( const uint64_t nanoseconds )
+{
+    m_buckets[ bucketOf( nanoseconds ) ]++;
+    m_count++;
+    m_sum += nanoseconds;
+}
+
+void LatencyHistogram::merge( const LatencyHistogram& other )
+{
+    for ( int i = 0; i < NUM_BUCKETS; i++ ) {
+        m_buckets[i] += other.m_buckets[i];
+    }
+    m_count += other.m_count;
+    m_sum   += other.m_sum;
+}
+
+double LatencyHistogram::percentile( const double p ) const
+{
+    if ( m_count == 0 ) {
+        return 0.0;
+    }
+
+    const auto rank = static_cast<uint64_t>( ceil( p * static_cast<double>( m_count ) ) );
+
+    uint64_t cumulative = 0;
+
+    for ( int i = 0; i < NUM_BUCKETS; i++ ) {
+
+        cumulative += m_buckets[i];
+
+        if ( cumulative >= std::max< uint64_t >( 1, rank ) ) {
+
+            const double low  = static_cast<double>( bucketLow( i ) );
+            const double high = ( i + 1 < NUM_BUCKETS ) ? static_cast<double>( bucketLow( i + 1 ) ) : low;
+
+            return 0.5 * ( low + high );
+        }
+    }
+
+    return static_cast<double>( bucketLow( NUM_BUCKETS - 1 ) );
+}
+
+void StageProfiler::releaseQueries()
+{
+    for ( auto& probe : m_pending ) {
+        m_free_queries.push_back( probe.m_queries );
+    }
+    m_pending.clear();
+
+    for ( auto& queries : m_free_queries ) {
+        glDeleteQueries( NUM_STAGES, queries.data() );
+    }
+    m_free_queries.clear();
+}
+
+void StageProfiler::beginProbe()
+{
+    Probe probe;
+
+    if ( m_free_queries.empty() ) {
+
+        glGenQueries( NUM_STAGES, probe.m_queries.data() );
+    }
+    else {
+        probe.m_queries = m_free_queries.back();
+        m_free_queries.pop_back();
+    }
+
+    probe.m_used.fill( false );
+    probe.m_cpu_times.fill( std::chrono::steady_clock::duration::zero() );
+    probe.m_start     = std::chrono::steady_clock::now();
+    probe.m_num_tests = 0;
+
+    m_pending.push_back( probe );
+}
+
+void StageProfiler::beginStage( const Stage stage )
+{
+    auto& probe = m_pending.back();
+
+    // GL_TIME_ELAPSED does not nest. a stage is timed once per probe.
+    if ( !probe.m_used[ stage ] ) {
+
+        glBeginQuery( GL_TIME_ELAPSED, probe.m_queries[ stage ] );
+    }
+
+    probe.m_stage_starts[ stage ] = std::chrono::steady_clock::now();
+}
+
+void StageProfiler::endStage( const Stage stage )
+{
+    auto& probe = m_pending.back();
+
+    probe.m_cpu_times[ stage ] += std::chrono::steady_clock::now() - probe.m_stage_starts[ stage ];
+
+    if ( !probe.m_used[ stage ] ) {
+
+        glEndQuery( GL_TIME_ELAPSED );
+        probe.m_used[ stage ] = true;
+    }
+}
+
+void StageProfiler::endProbe( const int num_tests )
+{
+    m_pending.back().m_num_tests = num_tests;
+}
+
+void StageProfiler::addCpuTime( const Stage stage, const std::chrono::steady_clock::duration duration )
+{
+    if ( m_pending.empty() ) {
+        return;
+    }
+    m_pending.front().m_cpu_times[ stage ] += duration;
+}
+
+void StageProfiler::resolveOldest()
+{
+    if ( m_pending.empty() ) {
+        return;
+    }
+
+    auto& probe = m_pending.front();
+
+    const std::chrono::nanoseconds latency = std::chrono::steady_clock::now() - probe.m_start;
+
+    m_probe_histogram.add( latency.count() );
+
+    for ( int i = 0; i < NUM_STAGES; i++ ) {
+
+        const std::chrono::nanoseconds cpu_time = probe.m_cpu_times[i];
+
+        if ( probe.m_used[i] ) {
+
+            GLuint64 gpu_time = 0;
+            glGetQueryObjectui64v( probe.m_queries[i], GL_QUERY_RESULT, &gpu_time );
+
+            m_gpu_histograms[i].add( gpu_time );
+            m_cpu_histograms[i].add( cpu_time.count() );
+        }
+        else if ( cpu_time.count() > 0 ) {
+
+            m_cpu_histograms[i].add( cpu_time.count() );
+        }
+    }
+
+    m_num_probes++;
+    m_num_tests += probe.m_num_tests;
+
+    m_free_queries.push_back( probe.m_queries );
+    m_pending.pop_front();
+}
+
+void StageProfiler::merge( const StageProfiler& other )
+{
+    for ( int i = 0; i < NUM_STAGES; i++ ) {
+
+        m_cpu_histograms[i].merge( other.m_cpu_histograms[i] );
+        m_gpu_histograms[i].merge( other.m_gpu_histograms[i] );
+    }
+    m_probe_histogram.merge( other.m_probe_histogram );
+
+    m_num_probes += other.m_num_probes;
+    m_num_tests  += other.m_num_tests;
+}
+
+void StageProfiler::printSummary( std::ostream& os, const double elapsed ) const
+{
+    const auto us = []( const double nanoseconds ) { return nanoseconds * 1.0e-3; };
+
+    os << "Profile:\n";
+    os << "    probes: " << m_num_probes << "\n";
+    os << "    tests: " << m_num_tests << " (" << m_num_tests / std::max( 1.0e-9, elapsed ) << " tests/sec)\n";
+    os << "    probe latency (us): p50 " << us( m_probe_histogram.percentile( 0.5 ) )
+       << " p99 " << us( m_probe_histogram.percentile( 0.99 ) )
+       << " mean " << us( m_probe_histogram.mean() ) << "\n";
+
+    os << "    stage (us)      cpu p50     cpu p99    gpu p50     gpu p99\n";
+
+    for ( int i = 0; i < NUM_STAGES; i++ ) {
+
+        const auto& cpu = m_cpu_histograms[i];
+        const auto& gpu = m_gpu_histograms[i];
+
+        if ( cpu.count() == 0 && gpu.count() == 0 ) {
+            continue;
+        }
+
+        os << "    " << std::left << std::setw( 12 ) << stageName( static_cast< Stage >( i ) ) << std::right
+           << std::fixed << std::setprecision( 1 )
+           << std::setw( 12 ) << us( cpu.percentile( 0.5  ) )
+           << std::setw( 12 ) << us( cpu.percentile( 0.99 ) );
+
+        // the stages taken after the submission have no GPU time.
+        if ( gpu.count() == 0 ) {
+            os << std::setw( 11 ) << "-" << std::setw( 12 ) << "-";
+        }
+        else {
+            os << std::setw( 11 ) << us( gpu.percentile( 0.5  ) )
+               << std::setw( 12 ) << us( gpu.percentile( 0.99 ) );
+        }
+        os << std::defaultfloat << "\n";
+    }
+}
+
+const char* StageProfiler::stageName( const Stage stage )
+{
+    switch ( stage ) {
+
+      case CLEAR:
+        return "clear";
+
+      case DRAW_PLANE_1:
+        return "draw 1";
+
+      case DRAW_PLANE_2:
+        return "draw 2";
+
+      case FINISH:
+        return "finish";
+
+      case READBACK:
+        return "readback";
+
+      default:
+        return "unknown";
+    }
+}
+
+} // namespace DepthTest
@@ -0,0 +1,166 @@
+#ifndef __DEPTH_TEST_STAGE_PROFILER_HPP__
+#define __DEPTH_TEST_STAGE_PROFILER_HPP__
+
+#include <cstdint>
+#include <array>
+#include <deque>
+#include <vector>
+#include <chrono>
+#include <iostream>
+
+#include <GL/glew.h>
+
+namespace DepthTest {
+
+// Histogram of durations in nanoseconds, with 8 buckets per power of two,
+// i.e. within about 9 percent.
+class LatencyHistogram {
+
+  public:
+
+    static constexpr int SUB_BUCKETS = 8;
+    static constexpr int NUM_BUCKETS = SUB_BUCKETS * 64;
+
+    LatencyHistogram() noexcept
+        :m_buckets{}
+        ,m_count  { 0 }
+        ,m_sum    { 0 }
+    {
+    }
+
+    void add( const uint64_t nanoseconds );
+
+    void merge( const LatencyHistogram& other );
+
+    uint64_t count() const
+    {
+        return m_count;
+    }
+
+    double mean() const
+    {
+        return m_count == 0 ? 0.0 : static_cast<double>( m_sum ) / static_cast<double>( m_count );
+    }
+
+    // p in [0, 1]. the middle of the bucket.
+    double percentile( const double p ) const;
+
+  private:
+
+    static int      bucketOf( const uint64_t nanoseconds );
+    static uint64_t bucketLow( const int bucket );
+
+    std::array< uint64_t, NUM_BUCKETS > m_buckets;
+    uint64_t                            m_count;
+    uint64_t                            m_sum;
+};
+
+// Opt-in instrumentation of the stages of SquareRenderer.
+// Each stage of a probe, i.e. a test() or a batch, is wrapped with a
+// GL_TIME_ELAPSED query for the GPU time and with the steady clock for the
+// CPU time. The queries of a probe are read when its results are read
+// back, so they do not stall the pipeline.
+// Must be used on the thread of the context of the renderer.
+class StageProfiler {
+
+  public:
+
+    typedef enum _Stage {
+        CLEAR,
+        DRAW_PLANE_1,
+        DRAW_PLANE_2,
+        FINISH,   // glFinish(), or the wait for the fence of a batch.
+        READBACK, // glReadPixels(), the occlusion queries, or the map of the pixel buffer.
+        NUM_STAGES
+    } Stage;
+
+    // times a stage in its scope. does nothing without a profiler.
+    class Scope {
+
+      public:
+
+        Scope( StageProfiler* profiler, const Stage stage )
+            :m_profiler{ profiler }
+            ,m_stage   { stage }
+        {
+            if ( m_profiler != nullptr ) {
+                m_profiler->beginStage( m_stage );
+            }
+        }
+
+        ~Scope()
+        {
+            if ( m_profiler != nullptr ) {
+                m_profiler->endStage( m_stage );
+            }
+        }
+
+      private:
+
+        StageProfiler* const m_profiler;
+        const Stage          m_stage;
+    };
+
+    StageProfiler() noexcept
+        :m_num_probes{ 0 }
+        ,m_num_tests { 0 }
+    {
+    }
+
+    // deletes the GL queries. called in the context by the renderer.
+    void releaseQueries();
+
+    void beginProbe();
+
+    void beginStage( const Stage stage );
+
+    void endStage( const Stage stage );
+
+    // num_tests: the test cases of the probe.
+    void endProbe( const int num_tests );
+
+    // the CPU time of a stage of the oldest probe not resolved yet,
+    // taken after endProbe(), e.g. while waiting for its fence.
+    void addCpuTime( const Stage stage, const std::chrono::steady_clock::duration duration );
+
+    // reads the GPU times of the oldest probe not resolved yet, whose
+    // commands must have completed, into the histograms.
+    void resolveOldest();
+
+    // the probes of the other profilers, e.g. of the other workers.
+    void merge( const StageProfiler& other );
+
+    // tests/sec over elapsed seconds, and the percentiles of the latencies.
+    void printSummary( std::ostream& os, const double elapsed ) const;
+
+    static const char* stageName( const Stage stage );
+
+  private:
+
+    struct Probe {
+        std::array< GLuint, NUM_STAGES >   m_queries;
+        std::array< bool, NUM_STAGES >     m_used;
+        std::array< std::chrono::steady_clock::duration, NUM_STAGES >
+                                           m_cpu_times;
+        std::array< std::chrono::steady_clock::time_point, NUM_STAGES >
+                                           m_stage_starts;
+        std::chrono::steady_clock::time_point
+                                           m_start;
+        int                                m_num_tests;
+    };
+
+    std::deque< Probe >  m_pending; // the last one is being recorded.
+    std::vector< std::array< GLuint, NUM_STAGES > >
+                         m_free_queries;
+
+    std::array< LatencyHistogram, NUM_STAGES > m_cpu_histograms;
+    std::array< LatencyHistogram, NUM_STAGES > m_gpu_histograms;
+    LatencyHistogram                           m_probe_histogram;
+
+    uint64_t             m_num_probes;
+    uint64_t             m_num_tests;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_STAGE_PROFILER_HPP__*/
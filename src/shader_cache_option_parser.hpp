@@ -0,0 +1,62 @@
+#ifndef __DEPTH_TEST_SHADER_CACHE_OPTION_PARSE_HPP__
+#define __DEPTH_TEST_SHADER_CACHE_OPTION_PARSE_HPP__
+
+#include <string>
+
+#include "opengl_util.hpp"
+
+namespace DepthTest {
+
+// -shader_cache, apart from CommonOptionParser so that the interactive tools
+// take it without the headers of the batch tools.
+class ShaderCacheOptionParser
+{
+
+public:
+
+    // the directory of the program binary cache. empty if off.
+    const std::string& shaderCache() const
+    {
+        return m_shader_cache;
+    }
+
+protected:
+
+    ShaderCacheOptionParser() noexcept
+        :m_shader_cache{ DEFAULT_PROGRAM_BINARY_CACHE }
+    {
+    }
+
+    // parses arg and its value arg2 if arg is -shader_cache.
+    // returns false if it is not.
+    bool parseShaderCacheOption( const std::string& arg, const std::string& arg2 )
+    {
+        if ( arg.compare ( SHADER_CACHE ) != 0 ) {
+            return false;
+        }
+
+        m_shader_cache = ( arg2.compare( SHADER_CACHE_OFF ) == 0 ) ? std::string() : arg2;
+
+        return true;
+    }
+
+private:
+
+    static const std::string SHADER_CACHE;
+    static const std::string SHADER_CACHE_OFF;
+
+    std::string m_shader_cache;
+};
+
+} // namespace DepthTest {
+
+///////////////////////
+
+namespace DepthTest {
+
+const std::string ShaderCacheOptionParser::SHADER_CACHE     = "-shader_cache";
+const std::string ShaderCacheOptionParser::SHADER_CACHE_OFF = "off";
+
+} // namespace DepthTest {
+
+#endif/*__DEPTH_TEST_SHADER_CACHE_OPTION_PARSE_HPP__*/
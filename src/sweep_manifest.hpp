@@ -0,0 +1,162 @@
+#ifndef __DEPTH_TEST_SWEEP_MANIFEST_HPP__
+#define __DEPTH_TEST_SWEEP_MANIFEST_HPP__
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "depth_tester.hpp"
+
+namespace DepthTest {
+
+// List of the configurations for depth_test_sweep.
+//
+// One configuration per line:
+//     <name> <depth_type> <near> <far> <c> <num_points> <num_perturbed_samples> [<depth_format> [<clip>]]
+// depth_type is one of perspective, logfn, and logcf.
+// depth_format is one of d16, d24 (default), and d32f, and clip is one of
+// standard (default), reversed, and reversed_range, see
+// DepthTester::ClipConvention. The reversed ones are for perspective only.
+// The results of a configuration go to results_<name>.txt.
+// Empty lines and the lines starting with '#' are ignored.
+class SweepManifest {
+
+  public:
+
+    struct Configuration {
+        std::string                m_name;
+        DepthTester::DepthTestType m_depth_test_type;
+        float                      m_near;
+        float                      m_far;
+        float                      m_param_c;
+        int                        m_num_points;
+        int                        m_num_perturbed_samples;
+        DepthTester::DepthFormat   m_depth_format;
+        DepthTester::ClipConvention
+                                   m_clip_convention;
+    };
+
+    explicit SweepManifest( const std::string& file_path )
+    {
+        std::ifstream is( file_path );
+
+        if ( !is ) {
+
+            throw std::runtime_error( "cannot open the manifest " + file_path );
+        }
+
+        std::string line;
+        int         line_number = 0;
+
+        while ( std::getline( is, line ) ) {
+
+            line_number++;
+
+            const auto first = line.find_first_not_of( " \t\r" );
+
+            if ( first == std::string::npos || line[ first ] == '#' ) {
+                continue;
+            }
+
+            std::istringstream fields( line );
+
+            Configuration config;
+            std::string   depth_type;
+
+            fields >> config.m_name
+                   >> depth_type
+                   >> config.m_near
+                   >> config.m_far
+                   >> config.m_param_c
+                   >> config.m_num_points
+                   >> config.m_num_perturbed_samples;
+
+            if ( !fields ) {
+
+                throw std::runtime_error( "malformed manifest line " + std::to_string( line_number ) );
+            }
+
+            config.m_depth_test_type = depthTestType( depth_type );
+
+            if ( config.m_depth_test_type == DepthTester::UNKNOWN ) {
+
+                throw std::runtime_error( "unknown depth type " + depth_type + " at line " + std::to_string( line_number ) );
+            }
+
+            std::string depth_format = DepthTester::depthFormatName( DepthTester::DEPTH_D24 );
+            std::string clip         = DepthTester::clipConventionName( DepthTester::CLIP_STANDARD );
+
+            if ( fields >> depth_format ) {
+                fields >> clip;
+            }
+
+            if ( !depthFormat( depth_format, config.m_depth_format ) ) {
+
+                throw std::runtime_error( "unknown depth format " + depth_format + " at line " + std::to_string( line_number ) );
+            }
+
+            if (    !clipConvention( clip, config.m_clip_convention )
+                 || ( config.m_clip_convention != DepthTester::CLIP_STANDARD && config.m_depth_test_type != DepthTester::PERSPECTIVE ) ) {
+
+                throw std::runtime_error( "invalid clip convention " + clip + " at line " + std::to_string( line_number ) );
+            }
+
+            m_configurations.push_back( config );
+        }
+    }
+
+    const std::vector< Configuration >& configurations() const
+    {
+        return m_configurations;
+    }
+
+  private:
+
+    static DepthTester::DepthTestType depthTestType( const std::string& name )
+    {
+        if ( name == "perspective" ) {
+            return DepthTester::PERSPECTIVE;
+        }
+        if ( name == "logfn" ) {
+            return DepthTester::LOG_DEPTH_FN;
+        }
+        if ( name == "logcf" ) {
+            return DepthTester::LOG_DEPTH_CF;
+        }
+        return DepthTester::UNKNOWN;
+    }
+
+    static bool depthFormat( const std::string& name, DepthTester::DepthFormat& depth_format )
+    {
+        for ( const auto f : { DepthTester::DEPTH_D16, DepthTester::DEPTH_D24, DepthTester::DEPTH_D32F } ) {
+
+            if ( name == DepthTester::depthFormatName( f ) ) {
+
+                depth_format = f;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool clipConvention( const std::string& name, DepthTester::ClipConvention& clip_convention )
+    {
+        for ( const auto c : { DepthTester::CLIP_STANDARD, DepthTester::CLIP_REVERSED, DepthTester::CLIP_REVERSED_DEPTH_RANGE } ) {
+
+            if ( name == DepthTester::clipConventionName( c ) ) {
+
+                clip_convention = c;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector< Configuration > m_configurations;
+};
+
+} // namespace DepthTest
+
+#endif/*__DEPTH_TEST_SWEEP_MANIFEST_HPP__*/
@@ -0,0 +1,139 @@
+#ifndef __DEPTH_TEST_SWEEP_OPTION_PARSE_HPP__
+#define __DEPTH_TEST_SWEEP_OPTION_PARSE_HPP__
+
+#include <string>
+#include <algorithm>
+#include <iostream>
+
+#include "common_option_parser.hpp"
+
+namespace DepthTest {
+
+class SweepOptionParser : public CommonOptionParser
+{
+
+public:
+
+    explicit SweepOptionParser( int argc, char* argv[] ) noexcept
+        :CommonOptionParser{
+             BACKEND_OPTION | CROSS_CHECK_OPTION | THREADS_OPTION | SEARCH_OPTIONS | SHADER_CACHE_OPTION,
+             OPENGL,
+             USAGE
+         }
+        ,m_manifest_path   {}
+        ,m_output_dir      { "." }
+        ,m_max_layers      { 1 }
+    {
+        for ( auto i = 1; i < argc ; i++ ) {
+
+            std::string arg( argv[i] );
+
+            if (    arg.compare ( HELP1 ) == 0
+                 || arg.compare ( HELP2 ) == 0
+                 || arg.compare ( HELP3 ) == 0
+                 || i + 1 == argc                ) {
+
+                std::cerr << USAGE;
+                exit(1);
+            }
+
+            std::string arg2( argv[++i] );
+
+            if ( parseCommonOption( arg, arg2 ) ) {
+
+                continue;
+            }
+            else if ( arg.compare ( MANIFEST ) == 0 ) {
+
+                m_manifest_path = arg2;
+            }
+            else if ( arg.compare ( OUTPUT_DIR ) == 0 ) {
+
+                m_output_dir = arg2;
+            }
+            else if ( arg.compare ( LAYERS ) == 0 ) {
+
+                m_max_layers = std::max( 1, std::stoi( arg2 ) );
+            }
+            else {
+                std::cerr << USAGE;
+                exit(1);
+            }
+        }
+
+        if ( m_manifest_path.empty() ) {
+
+            std::cerr << USAGE;
+            exit(1);
+        }
+
+        // LayeredBatchTester runs the log bisection from the blind gap over
+        // the uniform sample points, one sample point per worker at a time.
+        if (    m_max_layers > 1
+             && (    searchMode()          != BatchTester::LOG_BISECTION_SEARCH
+                  || pipelineDepth()       != 1
+                  || modelInitialGap()
+                  || earlyStopConfidence() >  0.0
+                  || refineTolerance()     >  0.0                              ) ) {
+
+            std::cerr << "-layers needs -search bisection and takes none of -pipeline, -initial_gap, -early_stop and -sampling adaptive.\n";
+            std::cerr << USAGE;
+            exit(1);
+        }
+    }
+
+    const std::string& manifestPath() const
+    {
+        return m_manifest_path;
+    }
+
+    const std::string& outputDir() const
+    {
+        return m_output_dir;
+    }
+
+    // the configurations that differ only in C are tested together by
+    // LayeredBatchTester, up to this many at once. 1 if off.
+    int maxLayers() const
+    {
+        return m_max_layers;
+    }
+
+    // whether to write the records of ResultWriter next to the text results.
+    bool writeRecords() const
+    {
+        return outputFormatGiven();
+    }
+
+private:
+
+    static const std::string MANIFEST;
+    static const std::string OUTPUT_DIR;
+    static const std::string LAYERS;
+    static const std::string HELP1;
+    static const std::string HELP2;
+    static const std::string HELP3;
+    static const std::string USAGE;
+
+    std::string m_manifest_path;
+    std::string m_output_dir;
+    int         m_max_layers;
+};
+
+} // namespace DepthTest {
+
+#endif/*__DEPTH_TEST_SWEEP_OPTION_PARSE_HPP__*/
+
+///////////////////////
+
+namespace DepthTest {
+
+const std::string SweepOptionParser::MANIFEST              = "-manifest";
+const std::string SweepOptionParser::OUTPUT_DIR            = "-output_dir";
+const std::string SweepOptionParser::LAYERS                = "-layers";
+const std::string SweepOptionParser::HELP1                 = "-h";
+const std::string SweepOptionParser::HELP2                 = "-help";
+const std::string SweepOptionParser::HELP3                 = "-H";
+const std::string SweepOptionParser::USAGE                 = "depth_test_sweep -h <for help> -manifest <manifest file> [-output_dir <directory for the result files, default .>] [-backend <\"gl\"(OpenGL, default)/\"cpu\"(CPU emulation)/\"check\"(OpenGL checked against CPU emulation)>] [-threads <num worker threads, 0 for all cores>] [-pipeline <num sample points in flight per thread, default 1>] [-detection <\"color\"(color readback, default)/\"query\"(occlusion queries)>] [-search <\"grid\"(pairs of planes, default)/\"bisection\"(log bisection)/\"bracketing\"(exponential bracketing and bisection)/\"ulp\"(walk over the floats)/\"stack\"(stacks of planes, many gaps per render)/\"codes\"(depth buffer codes)>] [-stack_planes <planes per stack of \"stack\", 3 to 255, default 8>] [-initial_gap <\"blind\"(default)/\"model\"(analytic minimum gap)>] [-early_stop <confidence in (0.5, 1) to stop the probes early, default 0(off)>] [-perturbation <\"random\"(default)/\"halton\"/\"sobol\">] [-seed <seed of the sample points, default 1>] [-sampling <\"uniform\"(default)/\"adaptive\"(bisects where the curve bends)>] [-refine_tolerance <relative deviation to bisect at, default 0.05>] [-shader_cache <directory of the program binaries, default shader_cache, \"off\" to always compile>] [-layers <max configurations differing only in C tested together in one draw, with -search bisection only, default 1(off)>] [-output_format <\"binary\"/\"csv\"/\"npy\", also writes results_<name>.bin/csv/npy>]\n";
+
+} // namespace DepthTest {
@@ -8,6 +8,13 @@
 
 namespace DepthTest {
 
+// the default directory of the program binary cache, under the working directory.
+static constexpr const char* DEFAULT_PROGRAM_BINARY_CACHE = "shader_cache";
+
+// If a program binary cache is set, the program is loaded from the binary
+// saved by a previous run with the same sources on the same driver, and
+// compiled and saved otherwise. Any failure of the cache falls back to the
+// compilation.
 GLuint compileAndLink(
 
     const std::string& vertex_str, 
@@ -16,6 +23,39 @@ GLuint compileAndLink(
 
 );
 
+// A program of a vertex shader alone, e.g. for GL_RASTERIZER_DISCARD, whose
+// outputs feedback_varyings are captured by transform feedback into one
+// buffer each, i.e. GL_SEPARATE_ATTRIBS. Not cached.
+GLuint compileAndLinkTransformFeedback(
+
+    const std::string&                vertex_str,
+    const std::vector< std::string >& feedback_varyings,
+    std::ostream&                     os
+
+);
+
+// A program with a geometry shader between the vertex and the fragment
+// shaders, e.g. to route the primitives to the layers with gl_Layer.
+// Not cached.
+GLuint compileAndLinkGeometry(
+
+    const std::string& vertex_str,
+    const std::string& geometry_str,
+    const std::string& fragment_str,
+    std::ostream&      os
+
+);
+
+// directory: where compileAndLink() keeps the program binaries, keyed by
+//            the hash of the sources and the vendor, renderer and version
+//            strings of the driver. created on the first save.
+//            empty to always compile, which it is until set. the tools
+//            set DEFAULT_PROGRAM_BINARY_CACHE unless "-shader_cache off".
+// Must be set before the programs are compiled on the other threads.
+void setProgramBinaryCache( const std::string& directory );
+
+const std::string& programBinaryCache();
+
 class OpenGLInfo {
 
 public:
@@ -1,11 +1,61 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <random>
+#include <filesystem>
+
 #include "opengl_util.hpp"
 
 namespace DepthTest {
 
+// the header of the files of the program binary cache.
+struct ProgramBinaryHeader {
+    char     m_magic[4];
+    uint32_t m_format;
+    uint64_t m_key;
+    uint64_t m_length;
+};
+
+static constexpr char PROGRAM_BINARY_MAGIC[4] = { 'Z', 'F', 'P', '1' };
+
+static std::string s_program_binary_cache;
 
 static void compile( const GLuint id, const std::string&str, std::ostream& os );
 
-static GLuint link( const GLuint vertex_id, const GLuint frag_id, std::ostream& os );
+static GLuint link(
+    const GLuint                      vertex_id,
+    const GLuint                      geom_id,
+    const GLuint                      frag_id,
+    const bool                        retrievable,
+    const std::vector< std::string >& feedback_varyings,
+    std::ostream&                     os
+);
+
+static bool programBinarySupported();
+
+static uint64_t programKey( const std::string& vertex_str, const std::string& fragment_str );
+
+static std::string programBinaryPath( const uint64_t key );
+
+static GLuint loadProgramBinary( const std::string& path, const uint64_t key );
+
+static void saveProgramBinary( const std::string& path, const uint64_t key, const GLuint prog_id );
+
+void setProgramBinaryCache( const std::string& directory )
+{
+    s_program_binary_cache = directory;
+}
+
+const std::string& programBinaryCache()
+{
+    return s_program_binary_cache;
+}
 
 GLuint compileAndLink(
 
@@ -14,6 +64,21 @@ GLuint compileAndLink(
     std::ostream&      os
 
 ) {
+    uint64_t    key = 0;
+    std::string path;
+
+    if ( !s_program_binary_cache.empty() && programBinarySupported() ) {
+
+        key  = programKey( vertex_str, fragment_str );
+        path = programBinaryPath( key );
+
+        const auto prog_id = loadProgramBinary( path, key );
+
+        if ( prog_id != 0 ) {
+            return prog_id;
+        }
+    }
+
     const auto vertex_id = glCreateShader( GL_VERTEX_SHADER );
 
     if ( vertex_id == 0 ) {
@@ -31,11 +96,70 @@ GLuint compileAndLink(
     compile( vertex_id, vertex_str,   os );
     compile( frag_id,   fragment_str, os );
 
-    const auto prog_id = link( vertex_id, frag_id, os );
+    const auto prog_id = link( vertex_id, 0, frag_id, !path.empty(), {}, os );
+
+    if ( !path.empty() ) {
+        saveProgramBinary( path, key, prog_id );
+    }
 
     return prog_id;
 }
 
+GLuint compileAndLinkTransformFeedback(
+
+    const std::string&                vertex_str,
+    const std::vector< std::string >& feedback_varyings,
+    std::ostream&                     os
+
+) {
+    const auto vertex_id = glCreateShader( GL_VERTEX_SHADER );
+
+    if ( vertex_id == 0 ) {
+
+        throw std::runtime_error("glCreateShader( GL_VERTEX_SHADER ) failed.");
+    }
+
+    compile( vertex_id, vertex_str, os );
+
+    return link( vertex_id, 0, 0, false, feedback_varyings, os );
+}
+
+GLuint compileAndLinkGeometry(
+
+    const std::string& vertex_str,
+    const std::string& geometry_str,
+    const std::string& fragment_str,
+    std::ostream&      os
+
+) {
+    const auto vertex_id = glCreateShader( GL_VERTEX_SHADER );
+
+    if ( vertex_id == 0 ) {
+
+        throw std::runtime_error("glCreateShader( GL_VERTEX_SHADER ) failed.");
+    }
+
+    const auto geom_id = glCreateShader( GL_GEOMETRY_SHADER );
+
+    if ( geom_id == 0 ) {
+
+        throw std::runtime_error("glCreateShader( GL_GEOMETRY_SHADER ) failed.");
+    }
+
+    const auto frag_id = glCreateShader( GL_FRAGMENT_SHADER );
+
+    if ( frag_id == 0 ) {
+
+        throw std::runtime_error("glCreateShader( GL_FRAGMENT_SHADER ) failed.");
+    }
+
+    compile( vertex_id, vertex_str,   os );
+    compile( geom_id,   geometry_str, os );
+    compile( frag_id,   fragment_str, os );
+
+    return link( vertex_id, geom_id, frag_id, false, {}, os );
+}
+
 void compile( const GLuint id, const std::string& str, std::ostream& os )
 {
     GLint result   = GL_FALSE;
@@ -60,8 +184,16 @@ void compile( const GLuint id, const std::string& str, std::ostream& os )
     }
 }
 
-GLuint link( const GLuint vertex_id, const GLuint frag_id, std::ostream& os )
-{
+// geom_id, frag_id: 0 for none.
+// feedback_varyings: captured into one buffer each.
+GLuint link(
+    const GLuint                      vertex_id,
+    const GLuint                      geom_id,
+    const GLuint                      frag_id,
+    const bool                        retrievable,
+    const std::vector< std::string >& feedback_varyings,
+    std::ostream&                     os
+) {
     GLint result   = GL_FALSE;
     int   info_len = 0;
 
@@ -73,7 +205,29 @@ GLuint link( const GLuint vertex_id, const GLuint frag_id, std::ostream& os )
     }
 
     glAttachShader( prog_id, vertex_id );
-    glAttachShader( prog_id, frag_id   );
+
+    if ( geom_id != 0 ) {
+        glAttachShader( prog_id, geom_id );
+    }
+
+    if ( frag_id != 0 ) {
+        glAttachShader( prog_id, frag_id );
+    }
+
+    if ( retrievable ) {
+        glProgramParameteri( prog_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+    }
+
+    if ( !feedback_varyings.empty() ) {
+
+        std::vector< const GLchar* > names;
+
+        for ( const auto& varying : feedback_varyings ) {
+            names.push_back( varying.c_str() );
+        }
+
+        glTransformFeedbackVaryings( prog_id, static_cast<GLsizei>( names.size() ), names.data(), GL_SEPARATE_ATTRIBS );
+    }
 
     glLinkProgram( prog_id );
 
@@ -91,12 +245,189 @@ GLuint link( const GLuint vertex_id, const GLuint frag_id, std::ostream& os )
     }
 
     glDetachShader( prog_id, vertex_id );
-    glDetachShader( prog_id, frag_id );
-
     glDeleteShader( vertex_id );
-    glDeleteShader( frag_id );
+
+    if ( geom_id != 0 ) {
+
+        glDetachShader( prog_id, geom_id );
+        glDeleteShader( geom_id );
+    }
+
+    if ( frag_id != 0 ) {
+
+        glDetachShader( prog_id, frag_id );
+        glDeleteShader( frag_id );
+    }
 
     return prog_id;
 }
 
+bool programBinarySupported()
+{
+    if ( !GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary ) {
+        return false;
+    }
+
+    GLint num_formats = 0;
+    glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats );
+
+    return num_formats > 0;
+}
+
+// FNV-1a over the sources and the driver strings.
+// the binaries are valid only for the same driver.
+uint64_t programKey( const std::string& vertex_str, const std::string& fragment_str )
+{
+    uint64_t key = 0xcbf29ce484222325ull;
+
+    auto add = [ &key ]( const char* str ) {
+
+        for ( const char* c = ( str != nullptr ? str : "" ); *c != '\0'; c++ ) {
+
+            key ^= static_cast< unsigned char >( *c );
+            key *= 0x100000001b3ull;
+        }
+
+        // the separator.
+        key ^= 0xff;
+        key *= 0x100000001b3ull;
+    };
+
+    add( vertex_str.c_str() );
+    add( fragment_str.c_str() );
+    add( reinterpret_cast< const char* >( glGetString( GL_VENDOR   ) ) );
+    add( reinterpret_cast< const char* >( glGetString( GL_RENDERER ) ) );
+    add( reinterpret_cast< const char* >( glGetString( GL_VERSION  ) ) );
+
+    return key;
+}
+
+std::string programBinaryPath( const uint64_t key )
+{
+    std::ostringstream name;
+
+    name << std::hex << std::setw( 16 ) << std::setfill( '0' ) << key << ".bin";
+
+    return ( std::filesystem::path( s_program_binary_cache ) / name.str() ).string();
+}
+
+// returns 0 if the binary is missing, or rejected by the driver.
+GLuint loadProgramBinary( const std::string& path, const uint64_t key )
+{
+    std::ifstream is( path, std::ios::binary );
+
+    if ( !is ) {
+        return 0;
+    }
+
+    ProgramBinaryHeader header;
+
+    if (    !is.read( reinterpret_cast< char* >( &header ), sizeof( header ) )
+         || memcmp( header.m_magic, PROGRAM_BINARY_MAGIC, sizeof( header.m_magic ) ) != 0
+         || header.m_key != key
+         || header.m_length == 0
+         || header.m_length > static_cast< uint64_t >( std::numeric_limits< GLsizei >::max() ) ) {
+
+        return 0;
+    }
+
+    std::vector< char > binary( header.m_length );
+
+    if ( !is.read( binary.data(), binary.size() ) ) {
+        return 0;
+    }
+
+    // glProgramBinary() raises GL_INVALID_ENUM on an unknown format, which
+    // would be left to the unrelated glGetError() of the caller.
+    GLint num_formats = 0;
+    glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats );
+
+    std::vector< GLint > formats( std::max( 0, num_formats ) );
+
+    if ( !formats.empty() ) {
+        glGetIntegerv( GL_PROGRAM_BINARY_FORMATS, formats.data() );
+    }
+
+    if ( std::find( formats.begin(), formats.end(), static_cast< GLint >( header.m_format ) ) == formats.end() ) {
+        return 0;
+    }
+
+    const auto prog_id = glCreateProgram();
+
+    if ( prog_id == 0 ) {
+        return 0;
+    }
+
+    glProgramBinary( prog_id, header.m_format, binary.data(), static_cast< GLsizei >( binary.size() ) );
+
+    // a rejected binary of a known format fails the link without an error.
+    GLint result = GL_FALSE;
+    glGetProgramiv( prog_id, GL_LINK_STATUS, &result );
+
+    if ( result != GL_TRUE ) {
+
+        // e.g. the driver was updated without changing its strings.
+        glDeleteProgram( prog_id );
+        return 0;
+    }
+
+    return prog_id;
+}
+
+// written to a temporary file and renamed, so that the other processes
+// never read a partial binary. the failures are ignored.
+void saveProgramBinary( const std::string& path, const uint64_t key, const GLuint prog_id )
+{
+    GLint length = 0;
+    glGetProgramiv( prog_id, GL_PROGRAM_BINARY_LENGTH, &length );
+
+    if ( length <= 0 ) {
+        return;
+    }
+
+    std::vector< char > binary( length );
+
+    GLenum format = 0;
+    glGetProgramBinary( prog_id, length, &length, &format, binary.data() );
+
+    if ( length <= 0 ) {
+        return;
+    }
+
+    ProgramBinaryHeader header;
+
+    memcpy( header.m_magic, PROGRAM_BINARY_MAGIC, sizeof( header.m_magic ) );
+    header.m_format = format;
+    header.m_key    = key;
+    header.m_length = static_cast< uint64_t >( length );
+
+    std::error_code error;
+    std::filesystem::create_directories( s_program_binary_cache, error );
+
+    std::ostringstream temp_path;
+    temp_path << path << ".tmp" << std::random_device{}();
+
+    {
+        std::ofstream os( temp_path.str(), std::ios::binary | std::ios::trunc );
+
+        if ( !os ) {
+            return;
+        }
+
+        os.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+        os.write( binary.data(), length );
+
+        if ( !os ) {
+            os.close();
+            std::remove( temp_path.str().c_str() );
+            return;
+        }
+    }
+
+    if ( std::rename( temp_path.str().c_str(), path.c_str() ) != 0 ) {
+
+        std::remove( temp_path.str().c_str() );
+    }
+}
+
 } // namespace DepthTest